@@ -0,0 +1,39 @@
+#include "KinKal/Detector/BFieldCache.hh"
+#include "KinKal/General/FitProfile.hh"
+#include <cmath>
+
+namespace KinKal {
+
+  BFieldCache::BFieldCache(BFieldMap const& bfield, double tol, double dt, std::pmr::memory_resource* mres) :
+    bfield_(bfield), tol_(tol), dt_(dt), tol2_(tol*tol), cache_(mres), nquery_(0), neval_(0) {}
+
+  VEC3 BFieldCache::fieldVect(VEC3 const& position, double time) const {
+    nquery_++;
+    if(caching()){
+      auto ientry = cache_.try_emplace(std::llround(time/dt_));
+      auto& entry = ientry.first->second;
+      // evaluate new entries, and re-evaluate if the reference moved out of tolerance
+      if(ientry.second || (position-entry.pos_).Mag2() > tol2_){
+	entry.pos_ = position;
+	entry.field_ = bfield_.fieldVect(position);
+	neval_++;
+	KINKAL_PROFILE_COUNT(FitProfile::bfieldQueries,1);
+      }
+      return entry.field_;
+    }
+    neval_++;
+    KINKAL_PROFILE_COUNT(FitProfile::bfieldQueries,1);
+    return bfield_.fieldVect(position);
+  }
+
+  VEC3 BFieldCache::fieldDeriv(VEC3 const& position, VEC3 const& velocity) const {
+    KINKAL_PROFILE_COUNT(FitProfile::bfieldQueries,1);
+    return bfield_.fieldDeriv(position,velocity);
+  }
+
+  std::ostream& operator <<(std::ostream& ost, BFieldCache const& fcache) {
+    ost << "BFieldCache tolerance " << fcache.tolerance() << " mm time bin " << fcache.timeBin() << " ns queries " << fcache.nQueries()
+      << " evaluations " << fcache.nEvaluations();
+    return ost;
+  }
+}
@@ -0,0 +1,47 @@
+#ifndef KinKal_BFieldCache_hh
+#define KinKal_BFieldCache_hh
+//
+//  Cache of BFieldMap values along a single particle trajectory, keyed by time.  Queries falling in the same time bin
+//  reuse the cached value as long as the query position is within tolerance of the position where the field was evaluated;
+//  otherwise (ie when the reference trajectory moved) the entry is re-evaluated.  A non-positive tolerance disables caching.
+//  Each Track owns its own cache, so no locking is needed; the cache must not be shared between threads.  The entries are allocated
+//  from the given memory resource, which must outlive the cache.
+//
+#include "KinKal/Detector/BFieldMap.hh"
+#include <unordered_map>
+#include <memory_resource>
+
+namespace KinKal {
+  class BFieldCache {
+    public:
+      // tolerance (mm) on the distance between query and cached positions, time binning (ns)
+      explicit BFieldCache(BFieldMap const& bfield, double tol=0.0, double dt=0.0, std::pmr::memory_resource* mres=std::pmr::get_default_resource());
+      // field at a position on the trajectory at the given time
+      VEC3 fieldVect(VEC3 const& position, double time) const;
+      // derivatives depend on the velocity; they are never cached
+      VEC3 fieldDeriv(VEC3 const& position, VEC3 const& velocity) const;
+      BFieldMap const& bfield() const { return bfield_; }
+      bool caching() const { return tol_ > 0.0 && dt_ > 0.0; }
+      double tolerance() const { return tol_; }
+      double timeBin() const { return dt_; }
+      unsigned long nQueries() const { return nquery_; }
+      unsigned long nEvaluations() const { return neval_; } // number of BFieldMap queries actually made
+      void clear() { cache_.clear(); }
+      // disallow copy and equivalence
+      BFieldCache(BFieldCache const& ) = delete; 
+      BFieldCache& operator =(BFieldCache const& ) = delete; 
+    private:
+      struct Entry {
+	VEC3 pos_; // position where the field was evaluated
+	VEC3 field_;
+      };
+      BFieldMap const& bfield_; // underlying field
+      double tol_; // position tolerance (mm)
+      double dt_; // time bin (ns)
+      double tol2_; // squared tolerance
+      mutable std::pmr::unordered_map<long long,Entry> cache_;
+      mutable unsigned long nquery_, neval_;
+  };
+  std::ostream& operator <<(std::ostream& ost, BFieldCache const& fcache);
+}
+#endif
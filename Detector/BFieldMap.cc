@@ -1,4 +1,5 @@
 #include "KinKal/Detector/BFieldMap.hh"
+#include <cmath>
 
 namespace KinKal {
 
@@ -42,4 +43,73 @@ namespace KinKal {
      return VEC3(-0.5*grad_*velocity.X(),-0.5*grad_*velocity.Y(),grad_*velocity.Z());
    }
 
+   CachedBFieldMap::CachedBFieldMap(BFieldMap const& field, double quantum, size_t csize) :
+     field_(field), quantum_(quantum), csize_(csize), nuse_(0) {
+       vcache_.reserve(csize_);
+       gcache_.reserve(csize_);
+     }
+
+   CachedBFieldMap::Key CachedBFieldMap::key(VEC3 const& position) const {
+     return Key{{std::llround(position.X()/quantum_), std::llround(position.Y()/quantum_), std::llround(position.Z()/quantum_)}};
+   }
+
+   template <class T> T const* CachedBFieldMap::find(std::vector<Entry<T>>& cache, Key const& key) const {
+     for(auto& entry : cache) {
+       if(entry.key_ == key){
+         entry.used_ = ++nuse_;
+         return &entry.value_;
+       }
+     }
+     return 0;
+   }
+
+   template <class T> void CachedBFieldMap::insert(std::vector<Entry<T>>& cache, Key const& key, T const& value) const {
+     if(cache.size() < csize_){
+       cache.push_back(Entry<T>{key,value,++nuse_});
+     } else if(csize_ > 0) {
+       // replace the least-recently used entry
+       auto lru = std::min_element(cache.begin(),cache.end(),[](Entry<T> const& a, Entry<T> const& b){ return a.used_ < b.used_; });
+       *lru = Entry<T>{key,value,++nuse_};
+     }
+   }
+
+   VEC3 CachedBFieldMap::fieldVect(VEC3 const& position) const {
+     stats_.nvect_++;
+     if(quantum_ <= 0.0) return field_.fieldVect(position);
+     auto pkey = key(position);
+     if(auto cached = find(vcache_,pkey)){
+       stats_.vecthits_++;
+       return *cached;
+     }
+     VEC3 fvec = field_.fieldVect(position);
+     insert(vcache_,pkey,fvec);
+     return fvec;
+   }
+
+   BFieldMap::Grad CachedBFieldMap::fieldGrad(VEC3 const& position) const {
+     stats_.ngrad_++;
+     if(quantum_ <= 0.0) return field_.fieldGrad(position);
+     auto pkey = key(position);
+     if(auto cached = find(gcache_,pkey)){
+       stats_.gradhits_++;
+       return *cached;
+     }
+     Grad fgrad = field_.fieldGrad(position);
+     insert(gcache_,pkey,fgrad);
+     return fgrad;
+   }
+
+   // the derivative depends on the velocity, so it is only counted, not cached
+   VEC3 CachedBFieldMap::fieldDeriv(VEC3 const& position, VEC3 const& velocity) const {
+     stats_.nderiv_++;
+     return field_.fieldDeriv(position,velocity);
+   }
+
+   std::ostream& operator <<(std::ostream& ost, CachedBFieldMap::Stats const& stats) {
+     ost << "BField queries: fieldVect " << stats.nvect_ << " hit rate " << stats.vectHitRate()
+       << " fieldGrad " << stats.ngrad_ << " hit rate " << stats.gradHitRate()
+       << " fieldDeriv " << stats.nderiv_;
+     return ost;
+   }
+
 }
@@ -6,6 +6,8 @@
 #include "KinKal/General/PhysicalConstants.h"
 #include "Math/SMatrix.h"
 #include <vector>
+#include <array>
+#include <ostream>
 #include <algorithm>
 #include <cstdarg>
 #include <cmath>
@@ -80,5 +82,51 @@ namespace KinKal {
       Grad fgrad_;
   };
 
+  // decorator to diagnose field query cost.  This counts the queries to the wrapped map, and optionally caches the field
+  // (and gradient) values for positions quantized to a given granularity (mm) in a small least-recently-used cache.
+  // Cached values have an error bounded by the field variation over the quantum.  quantum <= 0 disables the cache.
+  // This object is not thread-safe: use 1 instance per thread
+  class CachedBFieldMap : public BFieldMap {
+    public:
+      struct Stats {
+	unsigned long nvect_ = 0, ngrad_ = 0, nderiv_ = 0; // number of queries
+	unsigned long vecthits_ = 0, gradhits_ = 0; // number of queries answered from the cache
+	double vectHitRate() const { return nvect_ > 0 ? double(vecthits_)/double(nvect_) : 0.0; }
+	double gradHitRate() const { return ngrad_ > 0 ? double(gradhits_)/double(ngrad_) : 0.0; }
+      };
+      CachedBFieldMap(BFieldMap const& field, double quantum=0.0, size_t csize=16);
+      VEC3 fieldVect(VEC3 const& position) const override;
+      Grad fieldGrad(VEC3 const& position) const override;
+      VEC3 fieldDeriv(VEC3 const& position, VEC3 const& velocity) const override;
+      Stats const& stats() const { return stats_; }
+      void resetStats() { stats_ = Stats(); }
+      void clearCache() { vcache_.clear(); gcache_.clear(); }
+      BFieldMap const& field() const { return field_; }
+      double quantum() const { return quantum_; }
+      size_t cacheSize() const { return csize_; }
+      virtual ~CachedBFieldMap(){}
+      // disallow copy and equivalence
+      CachedBFieldMap(CachedBFieldMap const& ) = delete; 
+      CachedBFieldMap& operator =(CachedBFieldMap const& ) = delete; 
+    private:
+      using Key = std::array<long long,3>;
+      template <class T> struct Entry {
+	Key key_;
+	T value_;
+	unsigned long used_; // last use, for LRU replacement
+      };
+      Key key(VEC3 const& position) const;
+      template <class T> T const* find(std::vector<Entry<T>>& cache, Key const& key) const;
+      template <class T> void insert(std::vector<Entry<T>>& cache, Key const& key, T const& value) const;
+      BFieldMap const& field_; // wrapped field
+      double quantum_; // position granularity (mm)
+      size_t csize_; // maximum number of cache entries
+      mutable Stats stats_;
+      mutable unsigned long nuse_; // use counter for LRU
+      mutable std::vector<Entry<VEC3>> vcache_;
+      mutable std::vector<Entry<Grad>> gcache_;
+  };
+  std::ostream& operator <<(std::ostream& ost, CachedBFieldMap::Stats const& stats);
+
 }
 #endif
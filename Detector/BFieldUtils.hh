@@ -7,6 +7,8 @@
 #include "KinKal/General/TimeRange.hh"
 #include "KinKal/General/Vectors.hh"
 #include "KinKal/Detector/BFieldMap.hh"
+#include "KinKal/Detector/BFieldCache.hh"
+#include "KinKal/Trajectory/TrajectoryEval.hh"
 #include <algorithm>
 #include <cmath>
 #include <iostream>
@@ -18,7 +20,7 @@ namespace KinKal {
     // integrate the residual magentic force over the given KTRAJ and range, NOT described by the intrinsic bending, due to the DIFFERENCE
     // between the magnetic field and the nominal field used by the KTRAJ.  Returns the change in momentum
     // = integral of the 'external' force needed to keep the particle onto this trajectory over the specified range;
-    template<class KTRAJ> VEC3 integrate(BFieldMap const& bfield, KTRAJ const& ktraj, TimeRange const& trange) {
+    template<class KTRAJ> VEC3 integrate(BFieldCache const& bfield, KTRAJ const& ktraj, TimeRange const& trange) {
       // take a fixed number of steps.  This may fail for long ranges FIXME!
       unsigned nsteps(10);
       double dt = trange.range()/nsteps;
@@ -26,23 +28,27 @@ namespace KinKal {
       VEC3 dmom;
       for(unsigned istep=0; istep< nsteps; istep++){
 	double tstep = trange.begin() + (0.5+istep)*dt;
-	VEC3 vel = ktraj.velocity(tstep);
-	VEC3 db = bfield.fieldVect(ktraj.position3(tstep)) - ktraj.bnom(tstep);
-	dmom += cbar()*ktraj.charge()*dt*vel.Cross(db);
+	auto eval = ktraj.evaluate(tstep,TrajectoryEval::kinematics);
+	VEC3 db = bfield.fieldVect(eval.pos_,tstep) - ktraj.bnom(tstep);
+	dmom += cbar()*ktraj.charge()*dt*eval.velocity().Cross(db);
       }
       return dmom;
     }
+    template<class KTRAJ> VEC3 integrate(BFieldMap const& bfield, KTRAJ const& ktraj, TimeRange const& trange) {
+      return integrate(BFieldCache(bfield),ktraj,trange);
+    }
 
     // estimate how long in time from the given start time the trajectory position will stay within the given tolerance
     // compared to the true particle motion, given the true magnetic field.  This measures the impact of the KTRAJ nominal field being
     // different from the true field
-    template<class KTRAJ> double rangeInTolerance(double tstart, BFieldMap const& bfield, KTRAJ const& ktraj, double tol) {
+    template<class KTRAJ> double rangeInTolerance(double tstart, BFieldCache const& bfield, KTRAJ const& ktraj, double tol) {
       // compute scaling factor
-      double spd = ktraj.speed(tstart);
-      double sfac = fabs(cbar()*ktraj.charge()*spd*spd/ktraj.momentum(tstart));
+      auto eval = ktraj.evaluate(tstart,TrajectoryEval::kinematics);
+      double spd = eval.speed_;
+      double sfac = fabs(cbar()*ktraj.charge()*spd*spd/eval.mom_);
       // estimate step size from initial BFieldMap difference
-      VEC3 tpos = ktraj.position3(tstart);
-      VEC3 bvec = bfield.fieldVect(tpos);
+      VEC3 tpos = eval.pos_;
+      VEC3 bvec = bfield.fieldVect(tpos,tstart);
       auto db = (bvec - ktraj.bnom(tstart)).R();
       // estimate the step size for testing the position deviation.  This comes from 2 components:
       // the (static) difference in field, and the change in field along the trajectory
@@ -50,7 +56,7 @@ namespace KinKal {
       // step increment from static difference from nominal field.  0.2 comes from sagitta geometry
       // protect against nominal field = exact field
       if(db > 1e-4) tstep = std::min(tstep,0.2*sqrt(tol/(sfac*db))); 
-      VEC3 dBdt = bfield.fieldDeriv(tpos,ktraj.velocity(tstart));
+      VEC3 dBdt = bfield.fieldDeriv(tpos,eval.velocity());
       // the deviation goes as the cube root of the BFieldMap change.  0.5 comes from cosine expansion
       if(fabs(dBdt.R())>1e-6) tstep = std::min(tstep, 0.5*std::cbrt(tol/(sfac*dBdt.R()))); //
       // loop over the trajectory in fixed steps to compute integrals and domains.
@@ -62,7 +68,7 @@ namespace KinKal {
 	// increment the range
 	tend += tstep;
 	tpos = ktraj.position3(tend);
-	bvec = bfield.fieldVect(tpos);
+	bvec = bfield.fieldVect(tpos,tend);
 	// BFieldMap diff with nominal
 	auto db = (bvec - ktraj.bnom(tend)).R();
 	// spatial distortion accumulation; this goes as the square of the time times the field difference
@@ -71,6 +77,9 @@ namespace KinKal {
 //      std::cout << "tstep " << tstep << " tstart " << tstart << " tend " << tend  << std::endl;
       return tend;
     }
+    template<class KTRAJ> double rangeInTolerance(double tstart, BFieldMap const& bfield, KTRAJ const& ktraj, double tol) {
+      return rangeInTolerance(tstart,BFieldCache(bfield),ktraj,tol);
+    }
   }
 
 }
@@ -0,0 +1,78 @@
+#include "KinKal/Detector/DriftTable.hh"
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+namespace KinKal {
+  DriftTable::DriftTable(DriftModel const& model, double rmax, size_t nr, size_t nphi) :
+    rmax_(rmax), dr_(rmax/(nr-1)), dphi_(nphi > 1 ? M_PI/(nphi-1) : 0.0), nr_(nr), nphi_(nphi),
+    tdrift_(nr*nphi), dtdr_(nr*nphi), tvar_(nr*nphi) {
+      if(rmax <= 0.0 || nr < 2 || nphi < 1)throw std::invalid_argument("Invalid DriftTable range");
+      for(size_t iphi=0; iphi < nphi_; iphi++){
+	double phi = nphi_ > 1 ? -M_PI_2 + iphi*dphi_ : 0.0;
+	for(size_t ir=0; ir < nr_; ir++){
+	  DriftInfo dinfo;
+	  model(POL2(ir*dr_,phi),dinfo);
+	  if(dinfo.vdrift_ <= 0.0)throw std::invalid_argument("Invalid drift speed");
+	  tdrift_[index(ir,iphi)] = dinfo.tdrift_;
+	  dtdr_[index(ir,iphi)] = 1.0/dinfo.vdrift_;
+	  tvar_[index(ir,iphi)] = dinfo.tdriftvar_;
+	}
+      }
+    }
+
+  void DriftTable::distanceToTime(POL2 const& drift, DriftInfo& dinfo) const {
+    double rval = drift.R();
+    // angle bin and fraction; angles outside the table are clamped
+    size_t iphi(0);
+    double fphi(0.0);
+    if(nphi_ > 1){
+      double phibin = std::min(std::max((drift.Phi()+M_PI_2)/dphi_,0.0),double(nphi_-1));
+      iphi = std::min(size_t(phibin),nphi_-2);
+      fphi = phibin - iphi;
+    }
+    size_t jphi = nphi_ > 1 ? iphi+1 : iphi;
+    // distance bin and fraction.  Beyond the table the last bin is extrapolated using the end slope
+    double rbin = rval/dr_;
+    size_t ir = rbin < nr_-2 ? size_t(rbin) : nr_-2;
+    double sval = rbin - ir;
+    double tval[2], dtval[2];
+    size_t iphis[2] = {iphi,jphi};
+    for(size_t iside=0;iside<2;iside++){
+      size_t i0 = index(ir,iphis[iside]);
+      size_t i1 = index(ir+1,iphis[iside]);
+      if(sval <= 1.0){
+	// cubic Hermite interpolation using the tabulated derivatives
+	double s2 = sval*sval;
+	double s3 = s2*sval;
+	tval[iside] = (2*s3-3*s2+1)*tdrift_[i0] + (s3-2*s2+sval)*dr_*dtdr_[i0] + (-2*s3+3*s2)*tdrift_[i1] + (s3-s2)*dr_*dtdr_[i1];
+	dtval[iside] = ((6*s2-6*sval)*(tdrift_[i0]-tdrift_[i1]))/dr_ + (3*s2-4*sval+1)*dtdr_[i0] + (3*s2-2*sval)*dtdr_[i1];
+      } else {
+	tval[iside] = tdrift_[i1] + (sval-1.0)*dr_*dtdr_[i1];
+	dtval[iside] = dtdr_[i1];
+      }
+    }
+    double tvarval[2] = {
+      tvar_[index(ir,iphi)] + std::min(sval,1.0)*(tvar_[index(ir+1,iphi)]-tvar_[index(ir,iphi)]),
+      tvar_[index(ir,jphi)] + std::min(sval,1.0)*(tvar_[index(ir+1,jphi)]-tvar_[index(ir,jphi)]) };
+    dinfo.tdrift_ = tval[0] + fphi*(tval[1]-tval[0]);
+    dinfo.vdrift_ = 1.0/(dtval[0] + fphi*(dtval[1]-dtval[0]));
+    dinfo.tdriftvar_ = tvarval[0] + fphi*(tvarval[1]-tvarval[0]);
+  }
+
+  void DriftTable::print(std::ostream& ost, int detail) const {
+    ost << "DriftTable with " << nr_ << " distances up to " << rmax_ << " mm and " << nphi_ << " angles" << std::endl;
+    if(detail > 0){
+      for(size_t iphi=0; iphi < nphi_; iphi++){
+	ost << "angle " << (nphi_ > 1 ? -M_PI_2 + iphi*dphi_ : 0.0) << " times";
+	for(size_t ir=0; ir < nr_; ir++) ost << " " << tdrift_[index(ir,iphi)];
+	ost << std::endl;
+      }
+    }
+  }
+
+  std::ostream& operator <<(std::ostream& ost, DriftTable const& dtable) {
+    dtable.print(ost,0);
+    return ost;
+  }
+}
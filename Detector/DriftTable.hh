@@ -0,0 +1,37 @@
+#ifndef KinKal_DriftTable_hh
+#define KinKal_DriftTable_hh
+//
+//  Tabulated drift model for wire hits.  The drift time, its derivative WRT distance (the inverse drift speed) and the time
+//  variance are tabulated on a grid of drift distance and ExB angle, and interpolated (cubic Hermite in distance, linear in angle).
+//  A single table is meant to be shared by all the hits of a detector, replacing the per-hit distanceToTime calculation.
+//  The angle is that of the drift direction WRT the direction perpendicular to the wire and the BField, in [-pi/2,pi/2].
+//  Distances beyond the table are extrapolated linearly, angles are clamped to the table range.
+//
+#include "KinKal/General/Vectors.hh"
+#include "KinKal/Detector/WireHitStructs.hh"
+#include <functional>
+#include <vector>
+#include <iostream>
+
+namespace KinKal {
+  class DriftTable {
+    public:
+      // model to tabulate: given a drift distance and angle, fill the drift time, speed, and time variance
+      using DriftModel = std::function<void(POL2 const& drift, DriftInfo& dinfo)>;
+      // tabulate the model on nr distances in [0,rmax] and nphi angles
+      DriftTable(DriftModel const& model, double rmax, size_t nr, size_t nphi);
+      // interpolate the table.  The drift distance must be positive
+      void distanceToTime(POL2 const& drift, DriftInfo& dinfo) const;
+      double maxDistance() const { return rmax_; }
+      size_t nDistance() const { return nr_; }
+      size_t nAngle() const { return nphi_; }
+      void print(std::ostream& ost=std::cout, int detail=0) const;
+    private:
+      size_t index(size_t ir, size_t iphi) const { return iphi*nr_ + ir; }
+      double rmax_, dr_, dphi_; // range and grid spacing
+      size_t nr_, nphi_; // grid size
+      std::vector<double> tdrift_, dtdr_, tvar_; // tabulated time, its derivative WRT distance, and the time variance
+  };
+  std::ostream& operator <<(std::ostream& ost, DriftTable const& dtable);
+}
+#endif
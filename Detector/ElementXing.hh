@@ -11,6 +11,8 @@
 #include "KinKal/Detector/Hit.hh"
 #include "KinKal/Fit/Config.hh"
 #include <vector>
+#include <memory>
+#include <memory_resource>
 #include <stdexcept>
 #include <array>
 #include <limits>
@@ -20,29 +22,35 @@ namespace KinKal {
   template <class KTRAJ> class ElementXing {
     public:
       using PKTRAJ = ParticleTrajectory<KTRAJ>;
-      // construct from a time
-      ElementXing(double time=-std::numeric_limits<double>::max()) : xtime_(time) {}
+      // construct from a time.  The material crossings are allocated from the given resource, which must outlive this crossing
+      ElementXing(double time=-std::numeric_limits<double>::max(), std::pmr::memory_resource* mres=std::pmr::get_default_resource()) :
+	xtime_(time), mxings_(mres) {}
       virtual ~ElementXing() {}
       virtual void update(PKTRAJ const& pktraj,MetaIterConfig const& miconfig) =0;
       virtual void print(std::ostream& ost=std::cout,int detail=0) const =0;
+      // copy of this crossing with its own state, starting from the current state, so the same element can be used in fits
+      // of several hypotheses; crossing types which don't support it throw
+      virtual std::shared_ptr<ElementXing> clone() const { throw std::invalid_argument("ElementXing type can't be cloned"); }
+      // map the crossing time onto a particle covering the same path at a different speed, as t -> tref + (t-tref)*tscale
+      virtual void scaleTime(double tref, double tscale) { xtime_ = tref + (xtime_-tref)*tscale; }
       // crossings  without material are inactive
       bool active() const { return mxings_.size() > 0; }
       // accessors
       double crossingTime() const { return xtime_; }
       double& crossingTime() { return xtime_; }
-      std::vector<MaterialXing>const&  matXings() const { return mxings_; }
-      std::vector<MaterialXing>&  matXings() { return mxings_; }
-      // calculate the cumulative material effect from these crossings
-      void materialEffects(PKTRAJ const& pktraj, TimeDir tdir, std::array<double,3>& dmom, std::array<double,3>& momvar) const;
+      MaterialXingCol const&  matXings() const { return mxings_; }
+      MaterialXingCol&  matXings() { return mxings_; }
+      // calculate the cumulative material effect from these crossings.  This accepts either a single piece or a ParticleTrajectory
+      template <class TRAJ> void materialEffects(TRAJ const& traj, TimeDir tdir, std::array<double,3>& dmom, std::array<double,3>& momvar) const;
     private:
       double xtime_; // time on the reference trajectory when the xing occured
-      std::vector<MaterialXing> mxings_; // material crossings for this detector piece on this trajectory
+      MaterialXingCol mxings_; // material crossings for this detector piece on this trajectory
   };
 
-  template <class KTRAJ> void ElementXing<KTRAJ>::materialEffects(PKTRAJ const& pktraj, TimeDir tdir, std::array<double,3>& dmom, std::array<double,3>& momvar) const {
+  template <class KTRAJ> template <class TRAJ> void ElementXing<KTRAJ>::materialEffects(TRAJ const& traj, TimeDir tdir, std::array<double,3>& dmom, std::array<double,3>& momvar) const {
     // compute the derivative of momentum to energy
-    double mom = pktraj.momentum(xtime_);
-    double mass = pktraj.mass();
+    double mom = traj.momentum(xtime_);
+    double mass = traj.mass();
     double dmFdE = sqrt(mom*mom+mass*mass)/(mom*mom); // dimension of 1/E
     if(tdir == TimeDir::backwards)dmFdE *= -1.0;
     // loop over crossings for this detector piece
@@ -10,6 +10,9 @@
 #include "KinKal/General/Chisq.hh"
 #include "KinKal/Trajectory/ParticleTrajectory.hh"
 #include "KinKal/Fit/Config.hh"
+#include "KinKal/Detector/BFieldCache.hh"
+#include <memory>
+#include <stdexcept>
 #include <ostream>
 
 namespace KinKal {
@@ -19,8 +22,7 @@ namespace KinKal {
       // default
       Hit(){}
       virtual ~Hit(){}
-      // disallow copy and equivalence
-      Hit(Hit const& ) = delete; 
+      // disallow equivalence.  Hits are only copied through clone
       Hit& operator =(Hit const& ) = delete;
       // the constraint this hit implies WRT the current reference, expressed as a weight
       virtual Weights weight() const =0;
@@ -29,11 +31,19 @@ namespace KinKal {
       virtual Chisq chisq() const =0; // least-squares distance to reference parameters
       virtual Chisq chisq(Parameters const& params) const =0;  // least-squares distance to given parameters
       virtual double time() const = 0;  // time of this hit: this is WRT the reference trajectory
-      // update to a new reference, without changing state
-      virtual void update(PKTRAJ const& pktraj) = 0;
+      // update to a new reference, without changing state.  Hits needing the BField should query it through the field cache
+      // of the track being fit.  The cache belongs to the track, so it must not be kept beyond the call
+      virtual void update(PKTRAJ const& pktraj, BFieldCache const& fcache) = 0;
       // update the internals of the hit, specific to this meta-iteraion
-      virtual void updateState(PKTRAJ const& pktraj, MetaIterConfig const& config) = 0;
+      virtual void updateState(PKTRAJ const& pktraj, MetaIterConfig const& config, BFieldCache const& fcache) = 0;
       virtual void print(std::ostream& ost=std::cout,int detail=0) const = 0;
+      // copy of this hit with its own state, starting from the current state.  This allows the same measurement to be fit under
+      // several hypotheses; hit types which don't support it throw
+      virtual std::shared_ptr<Hit> clone() const { throw std::invalid_argument("Hit type can't be cloned"); }
+      // map the particle times of the state onto a particle covering the same path at a different speed, as t -> tref + (t-tref)*tscale
+      virtual void scaleTime(double tref, double tscale) {}
+    protected:
+      Hit(Hit const& ) = default;
   };
 
   template <class KTRAJ> std::ostream& operator <<(std::ostream& ost, Hit<KTRAJ> const& thit) {
@@ -5,13 +5,14 @@
 //
 #include "KinKal/MatEnv/DetMaterial.hh"
 #include <vector>
+#include <memory_resource>
 namespace KinKal {
   struct MaterialXing {
     MatEnv::DetMaterial const& dmat_; // material
     double plen_; // path length through this material
     MaterialXing(MatEnv::DetMaterial const& dmat,double plen) : dmat_(dmat), plen_(plen) {}
   };
-  typedef std::vector<MaterialXing> MaterialXingCol;
+  typedef std::pmr::vector<MaterialXing> MaterialXingCol;
 }
 #endif
 
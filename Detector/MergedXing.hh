@@ -0,0 +1,83 @@
+#ifndef KinKal_MergedXing_hh
+#define KinKal_MergedXing_hh
+//
+//  Describe the material effects of several consecutive thin crossings as a single crossing, so they can be processed as
+//  a single Material effect.  The constituent crossings are updated individually, their material crossings are combined and
+//  the combined effect is placed at their average time.  The Material effect transports each constituent at its own time.
+//  Track only merges crossings with no hits between them, so the fit is the same as without merging, except that the fit
+//  trajectory has a single piece for the group.
+//  Used in the kinematic Kalman fit
+//
+#include "KinKal/Detector/ElementXing.hh"
+#include <memory>
+#include <vector>
+#include <memory_resource>
+
+namespace KinKal {
+  template <class KTRAJ> class MergedXing : public ElementXing<KTRAJ> {
+    public:
+      using PKTRAJ = ParticleTrajectory<KTRAJ>;
+      using EXING = ElementXing<KTRAJ>;
+      using EXINGPTR = std::shared_ptr<EXING>;
+      using EXINGCOL = std::pmr::vector<EXINGPTR>;
+      // construct from the constituent crossings, which must already be updated.  The combined material crossings use the same memory resource
+      MergedXing(EXINGCOL xings) : EXING(-std::numeric_limits<double>::max(),xings.get_allocator().resource()), xings_(std::move(xings)) { combine(); }
+      virtual ~MergedXing() {}
+      // ElementXing interface
+      void update(PKTRAJ const& pktraj,MetaIterConfig const& miconfig) override;
+      void print(std::ostream& ost=std::cout,int detail=0) const override;
+      // the constituents are cloned as well
+      EXINGPTR clone() const override;
+      void scaleTime(double tref, double tscale) override;
+      // accessors
+      EXINGCOL const& xings() const { return xings_; }
+    private:
+      void combine(); // combine the constituent material crossings
+      EXINGCOL xings_; // constituent crossings
+  };
+
+  template <class KTRAJ> void MergedXing<KTRAJ>::update(PKTRAJ const& pktraj,MetaIterConfig const& miconfig) {
+    for(auto& xing : xings_) xing->update(pktraj,miconfig);
+    combine();
+  }
+
+  template <class KTRAJ> typename MergedXing<KTRAJ>::EXINGPTR MergedXing<KTRAJ>::clone() const {
+    // clones can outlive the resource of this crossing, so they use the default resource
+    EXINGCOL xings;
+    xings.reserve(xings_.size());
+    for(auto const& xing : xings_) xings.emplace_back(xing->clone());
+    return std::make_shared<MergedXing>(std::move(xings));
+  }
+
+  template <class KTRAJ> void MergedXing<KTRAJ>::scaleTime(double tref, double tscale) {
+    for(auto& xing : xings_) xing->scaleTime(tref,tscale);
+    combine();
+  }
+
+  template <class KTRAJ> void MergedXing<KTRAJ>::combine() {
+    EXING::matXings().clear();
+    double tsum(0.0), tall(0.0);
+    unsigned nactive(0);
+    for(auto const& xing : xings_){
+      tall += xing->crossingTime();
+      if(xing->active()){
+	tsum += xing->crossingTime();
+	nactive++;
+	for(auto const& mxing : xing->matXings()) EXING::matXings().emplace_back(mxing);
+      }
+    }
+    if(nactive > 0)
+      EXING::crossingTime() = tsum/nactive;
+    else if(xings_.size() > 0)
+      EXING::crossingTime() = tall/xings_.size();
+  }
+
+  template <class KTRAJ> void MergedXing<KTRAJ>::print(std::ostream& ost,int detail) const {
+    ost <<"Merged Xing time " << this->crossingTime() << " of " << xings_.size() << " crossings" << std::endl;
+    if(detail > 0){
+      for(auto const& xing : xings_) xing->print(ost,detail);
+    }
+  }
+
+}
+#endif
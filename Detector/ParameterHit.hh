@@ -22,9 +22,11 @@ namespace KinKal {
       Chisq chisq(Parameters const& pdata) const override;
       double time() const override { return time_; }
       // parameter constraints are absolute and can't be updated
-      void update(PKTRAJ const& pktraj) override { refparams_ = pktraj.nearestPiece(time()).params(); }
-      void updateState(PKTRAJ const& pktraj, MetaIterConfig const& config) override { update(pktraj); }
+      void update(PKTRAJ const& pktraj, BFieldCache const& fcache) override { refparams_ = pktraj.nearestPiece(time()).params(); }
+      void updateState(PKTRAJ const& pktraj, MetaIterConfig const& config, BFieldCache const& fcache) override { update(pktraj,fcache); }
       void print(std::ostream& ost=std::cout,int detail=0) const override;
+      // the constraint time is part of the measurement, so it isn't scaled
+      std::shared_ptr<HIT> clone() const override { return std::make_shared<ParameterHit>(*this); }
       // ParameterHit-specfic interface
       // construct from constraint values, time, and mask of which parameters to constrain
       ParameterHit(double time, Parameters const& params, PMASK const& pmask);
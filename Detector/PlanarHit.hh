@@ -0,0 +1,115 @@
+#ifndef KinKal_PlanarHit_hh
+#define KinKal_PlanarHit_hh
+//
+//  Hit measuring where the particle crosses a planar sensor (silicon strip or pixel, scintillator tile), as the position along 1 (strip)
+//  or 2 (pixel) directions in the sensor plane, and optionally the crossing time.
+//  The crossing is found with Newton steps from the previous crossing, so no TCA is needed
+//
+#include "KinKal/Detector/ResidualHit.hh"
+#include "KinKal/Trajectory/Surface.hh"
+#include <array>
+#include <stdexcept>
+namespace KinKal {
+
+  template <class KTRAJ> class PlanarHit : public ResidualHit<KTRAJ> {
+    public:
+      using PKTRAJ = ParticleTrajectory<KTRAJ>;
+      // Hit interface overrrides
+      unsigned nResid() const override { return timed() ? nmeas_+1 : nmeas_; } // position residuals, then the time residual
+      bool activeRes(unsigned ires=0) const override { return ires < nResid() && active_; }
+      Residual const& residual(unsigned ires=0) const override;
+      double time() const override { return ptime_; }
+      void update(PKTRAJ const& pktraj, BFieldCache const& fcache) override;
+      void updateState(PKTRAJ const& pktraj, MetaIterConfig const& config, BFieldCache const& fcache) override;
+      void print(std::ostream& ost=std::cout,int detail=0) const override;
+      std::shared_ptr<Hit<KTRAJ>> clone() const override { return std::make_shared<PlanarHit>(*this); }
+      void scaleTime(double tref, double tscale) override { ptime_ = tref + (ptime_-tref)*tscale; }
+      // strip sensor: the crossing position WRT the plane center is measured along udir with variance uvar.
+      // The time is an estimate of the crossing time, used to start the crossing search
+      PlanarHit(Plane const& plane, double time, VEC3 const& udir, double umeas, double uvar);
+      // pixel sensor: the position is also measured along vdir
+      PlanarHit(Plane const& plane, double time, VEC3 const& udir, double umeas, double uvar, VEC3 const& vdir, double vmeas, double vvar);
+      virtual ~PlanarHit(){}
+      // PlanarHit specific interface
+      // add a measurement of the crossing time, with variance tvar.  Without a time measurement t0 must be constrained by other hits
+      void setTimeMeasurement(double tmeas, double tvar) { tmeas_ = tmeas; tvar_ = tvar; }
+      bool timed() const { return tvar_ > 0.0; }
+      double timeMeasurement() const { return tmeas_; }
+      double timeVariance() const { return tvar_; }
+      Plane const& plane() const { return plane_; }
+      VEC3 const& measurementDirection(unsigned imeas) const { return mdirs_[imeas]; }
+      double measurement(unsigned imeas) const { return mvals_[imeas]; }
+      double measurementVariance(unsigned imeas) const { return mvars_[imeas]; }
+      VEC3 const& crossingPosition() const { return ppos_; }
+    private:
+      // measurement directions are projected into the plane
+      VEC3 planeDirection(VEC3 const& dir) const { return (dir - plane_.normal()*dir.Dot(plane_.normal())).Unit(); }
+      Plane plane_; // sensor plane
+      unsigned nmeas_; // number of measured directions
+      std::array<VEC3,2> mdirs_; // measurement directions
+      std::array<double,2> mvals_, mvars_; // measured positions and their variances
+      double tmeas_ = 0.0, tvar_ = -1.0; // measured time and its variance; negative variance means no time measurement
+      bool active_; // active or not
+      double ptime_; // crossing time on the reference trajectory
+      VEC3 ppos_; // crossing position on the reference trajectory
+      std::array<Residual,3> rresid_; // residuals WRT the most recent reference parameters
+      double precision_; // current time precision
+  };
+
+  template <class KTRAJ> PlanarHit<KTRAJ>::PlanarHit(Plane const& plane, double time, VEC3 const& udir, double umeas, double uvar) :
+    plane_(plane), nmeas_(1), mdirs_{planeDirection(udir),VEC3()}, mvals_{umeas,0.0}, mvars_{uvar,0.0},
+    active_(true), ptime_(time), precision_(1e-6) {}
+
+  template <class KTRAJ> PlanarHit<KTRAJ>::PlanarHit(Plane const& plane, double time, VEC3 const& udir, double umeas, double uvar,
+      VEC3 const& vdir, double vmeas, double vvar) :
+    plane_(plane), nmeas_(2), mdirs_{planeDirection(udir),planeDirection(vdir)}, mvals_{umeas,vmeas}, mvars_{uvar,vvar},
+    active_(true), ptime_(time), precision_(1e-6) {}
+
+  template <class KTRAJ> Residual const& PlanarHit<KTRAJ>::residual(unsigned ires) const {
+    if(ires >= nResid())throw std::invalid_argument("Invalid residual");
+    return rresid_[ires];
+  }
+
+  template <class KTRAJ> void PlanarHit<KTRAJ>::update(PKTRAJ const& pktraj, BFieldCache const& fcache) {
+    double ptime = ptime_;
+    size_t ipiece;
+    if(!pktraj.localCrossing(plane_,ptime,ipiece,precision_))throw std::runtime_error("Plane crossing failure");
+    ptime_ = ptime;
+    auto const& piece = pktraj.piece(ipiece);
+    auto teval = piece.evaluate(ptime_,TrajectoryEval::dXdPar);
+    ppos_ = teval.pos_;
+    // a parameter change also moves the crossing along the trajectory, which projects the position change onto the plane along the velocity
+    VEC3 vel = teval.velocity();
+    double ndv = plane_.normal().Dot(vel);
+    VEC3 dpos = ppos_ - plane_.center();
+    for(unsigned imeas=0; imeas < nmeas_; imeas++){
+      VEC3 pdir = mdirs_[imeas] - plane_.normal()*(mdirs_[imeas].Dot(vel)/ndv);
+      SVEC3 dv(pdir.X(),pdir.Y(),pdir.Z());
+      rresid_[imeas] = Residual(mvals_[imeas]-dpos.Dot(mdirs_[imeas]),mvars_[imeas],dv*teval.dXdP_);
+    }
+    if(timed()){
+      SVEC3 dn(plane_.normal().X(),plane_.normal().Y(),plane_.normal().Z());
+      rresid_[nmeas_] = Residual(tmeas_-ptime_,tvar_,-(dn*teval.dXdP_)/ndv);
+    }
+    this->setRefParams(piece);
+  }
+
+  template <class KTRAJ> void PlanarHit<KTRAJ>::updateState(PKTRAJ const& pktraj, MetaIterConfig const& miconfig, BFieldCache const& fcache) {
+    precision_ = miconfig.tprec_;
+    update(pktraj,fcache);
+  }
+
+  template<class KTRAJ> void PlanarHit<KTRAJ>::print(std::ostream& ost, int detail) const {
+    if(this->active())
+      ost<<"Active ";
+    else
+      ost<<"Inactive ";
+    ost << " PlanarHit time " << ptime_ << " measurements";
+    for(unsigned imeas=0; imeas < nmeas_; imeas++) ost << " " << mvals_[imeas] << " +- " << sqrt(mvars_[imeas]);
+    if(timed()) ost << " time " << tmeas_ << " +- " << sqrt(tvar_);
+    ost << std::endl;
+    if(detail > 0) ost << plane_ << std::endl;
+  }
+
+}
+#endif
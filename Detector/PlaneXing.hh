@@ -0,0 +1,63 @@
+#ifndef KinKal_PlaneXing_hh
+#define KinKal_PlaneXing_hh
+//
+//  Describe the material effects of a kinematic trajectory crossing a planar sensor of uniform thickness.
+//  The path length follows directly from the incidence angle at the crossing, which is found with Newton steps from the previous crossing
+//  Used in the kinematic Kalman fit
+//
+#include "KinKal/Detector/ElementXing.hh"
+#include "KinKal/Trajectory/Surface.hh"
+#include "KinKal/MatEnv/DetMaterial.hh"
+#include <algorithm>
+#include <stdexcept>
+
+namespace KinKal {
+  template <class KTRAJ> class PlaneXing : public ElementXing<KTRAJ> {
+    public:
+      using PKTRAJ = ParticleTrajectory<KTRAJ>;
+      using EXING = ElementXing<KTRAJ>;
+      // construct from a trajectory and an estimate of the crossing time
+      PlaneXing(PKTRAJ const& pktraj, double time, Plane const& plane, MatEnv::DetMaterial const& dmat, double thick, double precision=1e-6) :
+	EXING(time), plane_(plane), dmat_(dmat), thick_(thick) {
+	update(pktraj,precision); }
+      virtual ~PlaneXing() {}
+      // ElementXing interface
+      void update(PKTRAJ const& pktraj,MetaIterConfig const& miconfig) override { update(pktraj,miconfig.tprec_); }
+      void print(std::ostream& ost=std::cout,int detail=0) const override;
+      std::shared_ptr<EXING> clone() const override { return std::make_shared<PlaneXing>(*this); }
+      // specific interface
+      void update(PKTRAJ const& pktraj, double precision);
+      // accessors
+      Plane const& plane() const { return plane_; }
+      MatEnv::DetMaterial const& material() const { return dmat_; }
+      double thickness() const { return thick_; }
+    private:
+      Plane plane_; // mid-plane of the sensor
+      MatEnv::DetMaterial const& dmat_;
+      double thick_; // sensor thickness
+  };
+
+  template <class KTRAJ> void PlaneXing<KTRAJ>::update(PKTRAJ const& pktraj, double precision) {
+    static const double mincost(0.01); // limit the path length of grazing crossings
+    double xtime = EXING::crossingTime();
+    size_t ipiece;
+    if(!pktraj.localCrossing(plane_,xtime,ipiece,precision))throw std::runtime_error("Plane crossing failure");
+    EXING::crossingTime() = xtime;
+    double cost = fabs(plane_.normal().Dot(pktraj.piece(ipiece).direction(xtime)));
+    EXING::matXings().clear();
+    EXING::matXings().emplace_back(dmat_,thick_/std::max(cost,mincost));
+  }
+
+  template <class KTRAJ> void PlaneXing<KTRAJ>::print(std::ostream& ost,int detail) const {
+    ost <<"Plane Xing time " << this->crossingTime();
+    if(detail > 0){
+      for(auto const& mxing : this->matXings()){
+	ost << " " << mxing.dmat_.name() << " pathLen " << mxing.plen_;
+      }
+    }
+    if(detail > 1) ost << " " << plane_;
+    ost << std::endl;
+  }
+
+}
+#endif
@@ -36,7 +36,7 @@ namespace KinKal {
     // Model the wire as a diffuse gas, density constrained by DOCA TODO
   }
 
-  void StrawMaterial::findXings(ClosestApproachData const& cadata,StrawXingConfig const& caconfig, std::vector<MaterialXing>& mxings) const {
+  void StrawMaterial::findXings(ClosestApproachData const& cadata,StrawXingConfig const& caconfig, MaterialXingCol& mxings) const {
     mxings.clear();
     double wallpath, gaspath, wirepath;
     pathLengths(cadata,caconfig,wallpath, gaspath, wirepath);
@@ -33,7 +33,7 @@ namespace KinKal {
       // pathlength through straw components, given closest approach
       void pathLengths(ClosestApproachData const& cadata,StrawXingConfig const& caconfig, double& wallpath, double& gaspath, double& wirepath) const;
       // find the material crossings given doca and error on doca.  Should allow for straw and wire to have different axes TODO
-      void findXings(ClosestApproachData const& cadata,StrawXingConfig const& caconfig, std::vector<MaterialXing>& mxings) const;
+      void findXings(ClosestApproachData const& cadata,StrawXingConfig const& caconfig, MaterialXingCol& mxings) const;
       double strawRadius() const { return srad_; }
       double wallThickness() const { return thick_; }
       double wireRadius() const { return wrad_; }
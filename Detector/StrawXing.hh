@@ -27,6 +27,7 @@ namespace KinKal {
       // ElementXing interface
       void update(PKTRAJ const& pktraj,MetaIterConfig const& miconfig) override;
       void print(std::ostream& ost=std::cout,int detail=0) const override;
+      std::shared_ptr<EXING> clone() const override { return std::make_shared<StrawXing>(*this); }
      // specific interface: this xing is based on PTCA
       void update(PTCA const& tpoca);
       // accessors
@@ -61,7 +62,7 @@ namespace KinKal {
     if(sxconfig != 0) sxconfig_ = *sxconfig;
     // use current xing time create a hint to the CA calculation: this speeds it up
     CAHint tphint(EXING::crossingTime(), EXING::crossingTime());
-    PTCA tpoca(pktraj,axis_,tphint,miconfig.tprec_);
+    PTCA tpoca(pktraj,axis_,tphint,miconfig.tprec_,miconfig.tcanloops_,miconfig.tcamaxiter_,miconfig.ptcamaxiter_);
     update(tpoca);
   }
 
@@ -6,10 +6,13 @@
 //
 #include "KinKal/Detector/ResidualHit.hh"
 #include "KinKal/Detector/WireHitStructs.hh"
+#include "KinKal/Detector/DriftTable.hh"
 #include "KinKal/Trajectory/Line.hh"
 #include "KinKal/Trajectory/PiecewiseClosestApproach.hh"
 #include "KinKal/Detector/BFieldMap.hh"
 #include <array>
+#include <algorithm>
+#include <cmath>
 #include <stdexcept>
 namespace KinKal {
 
@@ -19,15 +22,20 @@ namespace KinKal {
       using PKTRAJ = ParticleTrajectory<KTRAJ>;
       using PTCA = PiecewiseClosestApproach<KTRAJ,Line>;
       
+      using RESIDHIT = ResidualHit<KTRAJ>;
+      static constexpr unsigned altTime = 2; // index of the opposite-ambiguity time residual, used in DAF mode
      // Hit interface overrrides; subclass still needs to implement state change update
-      unsigned nResid() const override { return 2; } // potentially 2 residuals
+      unsigned nResid() const override { return 3; } // potentially 3 residuals
       bool activeRes(unsigned ires) const override;
       Residual const& residual(unsigned ires=0) const override;
+      Chisq chisq() const override { return dafChisq(RESIDHIT::chisq()); }
+      Chisq chisq(Parameters const& params) const override { return dafChisq(RESIDHIT::chisq(params)); }
       double time() const override { return tpdata_.particleToca(); }
-      void update(PKTRAJ const& pktraj) override;
+      void update(PKTRAJ const& pktraj, BFieldCache const& fcache) override;
       void print(std::ostream& ost=std::cout,int detail=0) const override;
+      void scaleTime(double tref, double tscale) override { tpdata_.partCA_.SetE(tref + (tpdata_.particleToca()-tref)*tscale); }
       // virtual interface that must be implemented by concrete WireHit subclasses
-      // given a drift DOCA and direction in the cell, compute drift time and velocity
+      // given a drift DOCA and direction in the cell, compute drift time and velocity.  If a shared DriftTable is set, it is used instead
       virtual void distanceToTime(POL2 const& drift, DriftInfo& dinfo) const = 0;
       // WireHit specific functions
       ClosestApproachData const& closestApproach() const { return tpdata_; }
@@ -35,24 +43,43 @@ namespace KinKal {
       WireHitState& hitState() { return wstate_; }
       Residual const& timeResidual() const { return rresid_[WireHitState::time]; }
       Residual const& spaceResidual() const { return rresid_[WireHitState::distance]; }
+      Residual const& altTimeResidual() const { return rresid_[altTime]; }
       Line const& wire() const { return wire_; }
       BFieldMap const& bfield() const { return bfield_; }
+      // drift model shared by the hits of a detector
+      void setDriftTable(std::shared_ptr<DriftTable const> const& dtable) { dtable_ = dtable; }
+      DriftTable const* driftTable() const { return dtable_.get(); }
+      // take the ExB direction from the nominal BField of the reference trajectory, instead of querying the field at the hit.
+      // This is appropriate when the field is uniform on the scale of the BField domains
+      void setNominalField(bool nomfield) { nomfield_ = nomfield; }
+      bool nominalField() const { return nomfield_; }
       // constructor
       WireHit(BFieldMap const& bfield, Line const& wire, WireHitState const&);
       WireHit(BFieldMap const& bfield, PTCA const& ptca, WireHitState const&);
       virtual ~WireHit(){}
     protected:
       void setHitState(WireHitState const& newstate) { wstate_ = newstate; }
-      virtual void setResiduals(PTCA const& tpoca); // compute the Residuals; TPOCA must be already calculated
+      virtual void setResiduals(PTCA const& tpoca, BFieldCache const& fcache); // compute the Residuals; TPOCA must be already calculated
       void setPrecision(double precision) { precision_ = precision; }
+      void setIterationLimits(unsigned maxiter, unsigned maxpiter, unsigned nloops=0) { maxiter_ = maxiter; maxpiter_ = maxpiter; nloops_ = nloops; }
+      // if a WireHitDAFUpdater is configured, re-weight the ambiguities at the current temperature.  Returns true if DAF was applied
+      bool updateDAF(PKTRAJ const& pktraj, MetaIterConfig const& miconfig, BFieldCache const& fcache);
     private:
-      BFieldMap const& bfield_; // drift calculation requires the BField for ExB effects
+      // the 2 ambiguity residuals of a DAF hit measure the same quantity, so together they count as 1 DOF
+      Chisq dafChisq(Chisq const& chisq) const { return wstate_.daf() ? Chisq(chisq.chisq(),chisq.nDOF()-1) : chisq; }
+      BFieldMap const& bfield_; // field the hit was created in.  The fit queries the field through the cache of its track
+      std::shared_ptr<DriftTable const> dtable_; // shared drift model; if set, this replaces distanceToTime
+      bool nomfield_ = false; // use the nominal field for the ExB direction
+      VEC3 exbfield_; // field used to compute the cached ExB direction
+      VEC3 exbdir_; // cached direction perpendicular to the wire and the field
       Line wire_; // local linear approximation to the wire of this hit.  The range describes the active wire length
       WireHitState wstate_; // current state
       // caches used in processing
       ClosestApproachData tpdata_; // reference time and distance of closest approach to the wire
-      std::array<Residual,2> rresid_; // residuals WRT most recent reference
+      std::array<Residual,3> rresid_; // residuals WRT most recent reference
       double precision_; // precision for PTCA calculation; can change during processing schedule
+      unsigned maxiter_ = 100, maxpiter_ = 10; // PTCA iteration limits; can change during processing schedule
+      unsigned nloops_ = 0; // PTCA loop search; can change during processing schedule
   };
 
   template <class KTRAJ> WireHit<KTRAJ>::WireHit(BFieldMap const& bfield, Line const& wire, WireHitState const& wstate) : 
@@ -63,16 +90,16 @@ namespace KinKal {
       tpdata_ = ptca.tpData();
     }
 
-  template <class KTRAJ> void WireHit<KTRAJ>::update(PKTRAJ const& pktraj) {
+  template <class KTRAJ> void WireHit<KTRAJ>::update(PKTRAJ const& pktraj, BFieldCache const& fcache) {
     // compute PTCA.  Default hint is the wire middle
     CAHint tphint(wire_.range().mid(),wire_.range().mid());
     // if we already computed PTCA in the previous iteration, use that to set the hint.  This speeds convergence
     if(tpdata_.usable()) tphint = CAHint(tpdata_.particleToca(),tpdata_.sensorToca());
     // re-compute the time point of closest approache
-    PTCA tpoca(pktraj,wire_,tphint,precision_);
+    PTCA tpoca(pktraj,wire_,tphint,precision_,nloops_,maxiter_,maxpiter_);
     if(tpoca.usable()){
       tpdata_ = tpoca.tpData();
-      setResiduals(tpoca);
+      setResiduals(tpoca,fcache);
       this->setRefParams(pktraj.nearestPiece(tpoca.particleToca()));
     } else
       throw std::runtime_error("PTCA failure");
@@ -83,29 +110,48 @@ namespace KinKal {
       return true;
     else if(ires ==1 && (wstate_.dimension_ == WireHitState::distance || wstate_.dimension_ == WireHitState::both))
       return true;
+    else if(ires == altTime && wstate_.dimension_ == WireHitState::time && wstate_.daf())
+      return true;
     else
       return false;
   }
 
-  template <class KTRAJ> void WireHit<KTRAJ>::setResiduals(PTCA const& tpoca) {
+  template <class KTRAJ> void WireHit<KTRAJ>::setResiduals(PTCA const& tpoca, BFieldCache const& fcache) {
   // if we're using drift, convert DOCA into time
     if(wstate_.lrambig_ != WireHitState::null){
       // compute the precise drift
       // translate PTCA to residual
-      VEC3 bvec = bfield_.fieldVect(tpoca.particlePoca().Vect());
-      auto pdir = bvec.Cross(wire_.direction()).Unit(); // direction perp to wire and BFieldMap
+      VEC3 bvec;
+      if(nomfield_)
+	bvec = tpoca.particleTraj().piece(tpoca.particleTrajIndex()).bnom();
+      else
+	bvec = fcache.fieldVect(tpoca.particlePoca().Vect(),tpoca.particleToca());
+      // direction perp to wire and BFieldMap.  This only changes with the field, so it is cached
+      if(bvec != exbfield_){
+	exbfield_ = bvec;
+	exbdir_ = bvec.Cross(wire_.direction()).Unit();
+      }
       VEC3 dvec = tpoca.delta().Vect();
-      double phi = asin(double(dvec.Unit().Dot(pdir)));
+      double phi = asin(double(dvec.Unit().Dot(exbdir_)));
       // must use absolute DOCA to call distanceToTime
       POL2 drift(fabs(tpoca.doca()), phi);
       DriftInfo dinfo;
-      distanceToTime(drift, dinfo);
+      if(dtable_)
+	dtable_->distanceToTime(drift, dinfo);
+      else
+	distanceToTime(drift, dinfo);
       // Use ambiguity to convert drift time to a time difference.   null ambiguity means ignore drift time
       double dsign = wstate_.lrambig_*tpoca.lSign(); // overall sign is the product of ambiguity and doca sign
       double dt = tpoca.deltaT()-dinfo.tdrift_*dsign;
       // residual is in time, so unit dependendence on time, distance dependence is the local drift velocity
       DVEC dRdP = tpoca.dDdP()*dsign/dinfo.vdrift_ - tpoca.dTdP(); 
-      rresid_[WireHitState::time] = Residual(dt,dinfo.tdriftvar_,dRdP);
+      // DAF weights scale the variance
+      rresid_[WireHitState::time] = Residual(dt,dinfo.tdriftvar_/wstate_.lrweight_,dRdP);
+      // residual for the opposite ambiguity.  This is only used in DAF mode, but is always computed to allow testing the ambiguity
+      double altdt = tpoca.deltaT()+dinfo.tdrift_*dsign;
+      DVEC altdRdP = -tpoca.dDdP()*dsign/dinfo.vdrift_ - tpoca.dTdP(); 
+      double altvar = wstate_.altweight_ > 0.0 ? dinfo.tdriftvar_/wstate_.altweight_ : dinfo.tdriftvar_;
+      rresid_[altTime] = Residual(altdt,altvar,altdRdP);
     } else {
       // interpret DOCA against the wire directly as the residual.  We have to take the sign out of DOCA
       DVEC dRdP = -tpoca.lSign()*tpoca.dDdP();
@@ -122,10 +168,55 @@ namespace KinKal {
   }
 
   template <class KTRAJ> Residual const& WireHit<KTRAJ>::residual(unsigned ires) const {
-    if(ires >=2)throw std::invalid_argument("Invalid residual");
+    if(ires >=3)throw std::invalid_argument("Invalid residual");
     return rresid_[ires];
   }
 
+  template <class KTRAJ> bool WireHit<KTRAJ>::updateDAF(PKTRAJ const& pktraj, MetaIterConfig const& miconfig, BFieldCache const& fcache) {
+    // find the DAF updater in the update params.  There should be 0 or 1
+    const WireHitDAFUpdater* dafupdater(0);
+    for(auto const& uparams : miconfig.updaters_){
+      auto const* dafu = std::any_cast<WireHitDAFUpdater>(&uparams);
+      if(dafu != 0){
+	if(dafupdater !=0) throw std::invalid_argument("Multiple WireHitDAFUpdaters found");
+	dafupdater = dafu;
+      }
+    }
+    if(dafupdater == 0 || wstate_.dimension_ == WireHitState::none) return false;
+    // null ambiguity hits are only resolved if requested; start from the side of the reference
+    if(wstate_.lrambig_ == WireHitState::null){
+      if(!dafupdater->resolvenull_) return false;
+      wstate_.lrambig_ = tpdata_.doca() < 0.0 ? WireHitState::left : WireHitState::right;
+      wstate_.dimension_ = WireHitState::time;
+      wstate_.lrweight_ = 1.0;
+      wstate_.altweight_ = 0.0;
+      update(pktraj,fcache);
+    }
+    // probabilities of the 2 ambiguities at the current temperature, relative to the most probable.  The measurement
+    // variance is recovered by removing the current weight
+    auto const& tresid = rresid_[WireHitState::time];
+    auto const& altresid = rresid_[altTime];
+    double tvar = tresid.variance()*wstate_.lrweight_;
+    double temp = miconfig.varianceScale();
+    double chisq = tresid.value()*tresid.value()/tvar;
+    double altchisq = altresid.value()*altresid.value()/tvar;
+    double minchisq = std::min(chisq,altchisq);
+    double prob = exp(-0.5*(chisq-minchisq)/temp);
+    double altprob = exp(-0.5*(altchisq-minchisq)/temp);
+    double psum = prob + altprob;
+    if(dafupdater->chicut_ > 0.0) psum += exp(-0.5*(dafupdater->chicut_-minchisq)/temp);
+    // the most probable ambiguity becomes the assigned one
+    if(altprob > prob){
+      wstate_.lrambig_ = wstate_.lrambig_ == WireHitState::left ? WireHitState::right : WireHitState::left;
+      std::swap(prob,altprob);
+    }
+    wstate_.lrweight_ = std::max(prob/psum,dafupdater->minweight_);
+    wstate_.altweight_ = altprob/psum > dafupdater->minweight_ ? altprob/psum : 0.0;
+    // update the residuals to the new weights
+    update(pktraj,fcache);
+    return true;
+  }
+
   template<class KTRAJ> void WireHit<KTRAJ>::print(std::ostream& ost, int detail) const {
     ost << " WireHit constraining ";
     switch(wstate_.dimension_) {
@@ -154,11 +245,14 @@ namespace KinKal {
 	ost << "null";
 	break;
     }
+    if(wstate_.daf()) ost << " DAF weights " << wstate_.lrweight_ << " " << wstate_.altweight_;
     if(detail > 0){
       if(activeRes(WireHitState::time))
 	ost << " Time Residual " << rresid_[WireHitState::time];
       if(activeRes(WireHitState::distance))
 	ost << " Distance Residual " << rresid_[WireHitState::distance];
+      if(activeRes(altTime))
+	ost << " Opposite Ambiguity Time Residual " << rresid_[altTime];
       ost << std::endl;
     }
     if(detail > 1) {
@@ -17,10 +17,23 @@ namespace KinKal {
     LRAmbig lrambig_; // left-right ambiguity
     Dimension dimension_; // physical dimensions being constrained
     double nullvar_, nulldt_ ; // spatial variance and offset for null ambiguity hits
-    WireHitState(LRAmbig lrambig, Dimension dim,double nvar, double ndt) : lrambig_(lrambig), dimension_(dim), nullvar_(nvar), nulldt_(ndt) {
+    double lrweight_, altweight_; // DAF weights of the assigned and opposite ambiguities.  The default (1,0) is a hard assignment
+    WireHitState(LRAmbig lrambig, Dimension dim,double nvar, double ndt) : lrambig_(lrambig), dimension_(dim), nullvar_(nvar), nulldt_(ndt),
+    lrweight_(1.0), altweight_(0.0) {
       if(dimension_ > time && (lrambig_ != null)) throw std::invalid_argument("Inconsistant wire hit state");
     }
     WireHitState() : WireHitState(null,none,1.0,0.0) {}
+    bool daf() const { return lrambig_ != null && altweight_ > 0.0; } // both ambiguities contribute
+  };
+
+  // configuration of deterministic annealing (DAF) ambiguity resolution.  When present in the MetaIterConfig updaters, both
+  // ambiguities of every active drift hit contribute, weighted by their probability at the meta-iteration temperature.
+  // Hits with null ambiguity are left as they are unless resolvenull_ is set
+  struct WireHitDAFUpdater {
+    double chicut_; // chisquared of the outlier (neither ambiguity) hypothesis; <= 0 disables it
+    double minweight_; // smaller opposite-ambiguity weights are dropped, smaller assigned weights are clamped
+    bool resolvenull_; // also resolve the ambiguity of null ambiguity hits, starting from the side of the reference
+    WireHitDAFUpdater(double chicut=0.0, double minweight=1.0e-3, bool resolvenull=false) : chicut_(chicut), minweight_(minweight), resolvenull_(resolvenull) {}
   };
 }
 #endif
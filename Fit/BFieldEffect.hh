@@ -6,7 +6,7 @@
 //
 #include "KinKal/Fit/Effect.hh"
 #include "KinKal/General/TimeDir.hh"
-#include "KinKal/Detector/BFieldMap.hh"
+#include "KinKal/Detector/BFieldCache.hh"
 #include "KinKal/Detector/BFieldUtils.hh"
 #include "KinKal/Fit/Config.hh"
 #include <iostream>
@@ -26,6 +26,8 @@ namespace KinKal {
       void update(PKTRAJ const& ref, MetaIterConfig const& miconfig) override;
       void print(std::ostream& ost=std::cout,int detail=0) const override;
       void process(FitState& kkdata,TimeDir tdir) override;
+      FitState::Space processSpace(TimeDir tdir) const override { return this->active() ? FitState::parameterSpace : FitState::noSpace; }
+      bool increment(TimeDir tdir, StateIncrement& incr) const override;
       void append(PKTRAJ& fit) override;
       Parameters const& effect() const { return dbeff_; }
       virtual ~BFieldEffect(){}
@@ -33,13 +35,13 @@ namespace KinKal {
       BFieldEffect(BFieldEffect const& ) = delete; 
       BFieldEffect& operator =(BFieldEffect const& ) = delete; 
       // create from the domain range, the effect, and the
-      BFieldEffect(Config const& config, BFieldMap const& bfield, PKTRAJ const& pktraj,TimeRange const& drange) : 
+      BFieldEffect(Config const& config, BFieldCache const& bfield, PKTRAJ const& pktraj,TimeRange const& drange) : 
 	bfield_(bfield), drange_(drange), bfcorr_(config.bfcorr_) {}
       VEC3 deltaP() const { return VEC3(dp_[0], dp_[1], dp_[2]); } // translate to spatial vector
       TimeRange const& range() const { return drange_; }
 
     private:
-      BFieldMap const& bfield_; // bfield
+      BFieldCache const& bfield_; // bfield, cached along the track
       SVEC3 dp_; // change in momentum due to BFieldMap approximation
       TimeRange drange_; // extent of this effect.  The middle is at the transition point between 2 bfield domains (domain transition)
       DVEC dbint_; // integral effect of using bnom vs the full field over this effects range 
@@ -51,18 +53,20 @@ namespace KinKal {
   template<class KTRAJ> double BFieldEffect<KTRAJ>::tbuff_ = 1.0e-5;
 
   template<class KTRAJ> void BFieldEffect<KTRAJ>::process(FitState& kkdata,TimeDir tdir) {
+    StateIncrement incr;
+    increment(tdir,incr);
+    KKEFF::processIncrement(kkdata,tdir,incr);
+  }
+
+  template<class KTRAJ> bool BFieldEffect<KTRAJ>::increment(TimeDir tdir, StateIncrement& incr) const {
     if(this->active()){
       // forwards; just append the effect's parameter change
-      if(tdir == TimeDir::forwards) {
-	kkdata.append(dbeff_);
-      } else {
-	// SUBTRACT the effect going backwards: covariance change is sign-independent
-	Parameters reverse(dbeff_);
-	reverse.parameters() *= -1.0;
-      	kkdata.append(reverse);
-      }
+      incr.space_ = FitState::parameterSpace;
+      incr.data_ = dbeff_.fitData();
+      // SUBTRACT the effect going backwards: covariance change is sign-independent
+      if(tdir == TimeDir::backwards) incr.data_.vec() *= -1.0;
     }
-    KKEFF::setState(tdir,KKEFF::processed);
+    return true;
   }
 
   template<class KTRAJ> void BFieldEffect<KTRAJ>::update(PKTRAJ const& ref) {
@@ -106,13 +110,13 @@ namespace KinKal {
       newpiece.range() = newrange;
       // if we are using variable BFieldMap, update the parameters accordingly
       if(bfcorr_ == Config::variable || bfcorr_ == Config::both){
-	VEC3 newbnom = bfield_.fieldVect(fit.position3(drange_.end()));
+	VEC3 newbnom = bfield_.fieldVect(fit.position3(drange_.end()),drange_.end());
 	newpiece.setBNom(time,newbnom);
       }
       // adjust for the residual parameter change due to difference in bnom
       // don't double-count the effect due to bnom change; here we want just
       // the effect of the approximation of (piecewise) bnom vs the full field
-      newpiece.params().parameters() += dbint_;
+      newpiece.setParameters(newpiece.params().parameters() + dbint_);
       fit.append(newpiece);
     }
   }
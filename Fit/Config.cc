@@ -4,6 +4,10 @@ namespace KinKal {
       ost << "Meta-Iteration " << miconfig.miter_ << " temp " << miconfig.temp_;
       ost << " time precision " << miconfig.tprec_;
       ost << " converge, diverge delta-chisq," << miconfig.convdchisq_ << " "<< miconfig.divdchisq_ << " ";
+      ost << "converge delta-parameter " << miconfig.convdpar_ << " ";
+      ost << "TOCA max iterations " << miconfig.tcamaxiter_ << " max pieces " << miconfig.ptcamaxiter_ << " ";
+      ost << "BField domain tolerance " << miconfig.bftol_ << " ";
+      ost << "TOCA loop search " << miconfig.tcanloops_ << " ";
       ost << miconfig.updaters_.size() << " Dedicated Updaters" << std::endl;
       return ost;
   }
@@ -11,6 +15,9 @@ namespace KinKal {
   std::ostream& operator <<(std::ostream& ost, Config const& kkconfig ) {
     ost << "Config maxniter " << kkconfig.maxniter_ << " dweight " << kkconfig.dwt_
       << " min NDOF " << kkconfig.minndof_ << " BField correction " << kkconfig.bfcorr_
+      << " BField cache tolerance " << kkconfig.bfcachetol_
+      << " material merging time span " << kkconfig.matmergedt_ << " momentum change " << kkconfig.matmergedp_
+      << " square-root inversion " << kkconfig.sqrtinv_
       << " with " << kkconfig.schedule().size() << " Meta-iterations:" << std::endl;
     for(auto const& miconfig : kkconfig.schedule() ) {
       ost << miconfig << std::endl;
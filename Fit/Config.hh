@@ -15,6 +15,7 @@
 #include <ostream>
 #include <istream>
 #include "KinKal/General/Vectors.hh"
+#include "KinKal/General/FitData.hh"
 
 namespace KinKal {
   struct MetaIterConfig {
@@ -22,12 +23,33 @@ namespace KinKal {
     double tprec_; // time precision for TOCA calculations
     double convdchisq_; // maximum change in chisquared/dof for convergence
     double divdchisq_; // minimum change in chisquared/dof for divergence
+    double convdpar_; // maximum parameter change (units of chisquared) of the fit WRT the reference for early convergence; 0 disables
+    unsigned tcamaxiter_; // maximum number of TOCA iterations on a single trajectory piece
+    unsigned ptcamaxiter_; // maximum number of trajectory pieces tried when searching for the TOCA piece
+    double bftol_; // tolerance (mm) for (re)deriving the BField domains at the start of this meta-iteration; 0 keeps the current domains
+    unsigned tcanloops_; // number of trajectory loops either side of the TOCA solution searched for a smaller DOCA; 0 disables the search
     int miter_; // count of meta-iteration
     // payload for effects needing special updating; specific Effect subclasses can find their particular updater inside the vector
     std::vector<std::any> updaters_;
-    MetaIterConfig() : temp_(0.0), tprec_(1e-6), convdchisq_(0.01), divdchisq_(10.0), miter_(-1) {}
-    MetaIterConfig(std::istream& is) : miter_(-1) {
+    MetaIterConfig() : temp_(0.0), tprec_(1e-6), convdchisq_(0.01), divdchisq_(10.0), convdpar_(0.0), tcamaxiter_(100), ptcamaxiter_(10), bftol_(0.0),
+    tcanloops_(0), miter_(-1) {}
+    MetaIterConfig(std::istream& is) : tcamaxiter_(100), ptcamaxiter_(10), bftol_(0.0), tcanloops_(0), miter_(-1) {
       is >> temp_ >> tprec_ >> convdchisq_ >> divdchisq_ ;
+      // optional
+      if(!(is >> convdpar_))convdpar_ = 0.0;
+      unsigned maxiter;
+      if(is >> maxiter){
+	tcamaxiter_ = maxiter;
+	if(is >> maxiter){
+	  ptcamaxiter_ = maxiter;
+	  double bftol;
+	  if(is >> bftol){
+	    bftol_ = bftol;
+	    unsigned nloops;
+	    if(is >> nloops) tcanloops_ = nloops;
+	  }
+	}
+      }
     }
     double varianceScale() const { return (1.0+temp_)*(1.0+temp_); } // variance scale so that temp=0 means no additional variance
   };
@@ -37,19 +59,24 @@ namespace KinKal {
     enum BFCorr {nocorr=0, fixed, variable, both };
     typedef std::vector<MetaIterConfig> MetaIterConfigCol;
     Config(std::vector<MetaIterConfig>const& schedule) : Config() { schedule_ = schedule; }
-    Config() : maxniter_(10), dwt_(1.0e6),  pdchi2_(1.0e4), tbuff_(1.0), tol_(0.1), minndof_(5), bfcorr_(fixed), plevel_(none) {} 
+    Config() : maxniter_(10), dwt_(1.0e6),  pdchi2_(1.0e4), tbuff_(1.0), tol_(0.1), bfcachetol_(0.0), matmergedt_(0.0), matmergedp_(1.0e-3), minndof_(5), bfcorr_(fixed), sqrtinv_(false), plevel_(none) {} 
     MetaIterConfigCol& schedule() { return schedule_; }
     MetaIterConfigCol const& schedule() const { return schedule_; }
     static bool localBFieldCorrection(BFCorr corr) { return (corr == variable || corr == both); }
     bool localBFieldCorr() const { return localBFieldCorrection(bfcorr_); }
+    FitData::InvMethod invMethod() const { return sqrtinv_ ? FitData::cholesky : FitData::direct; }
     // algebraic iteration parameters
     int maxniter_; // maximum number of algebraic iterations for this config
     double dwt_; // dweighting of initial seed covariance
     double pdchi2_; // maximum allowed parameter change (units of chisqred) WRT initial seed
     double tbuff_; // time buffer for final fit (ns)
     double tol_; // tolerance on position change in BFieldMap integration (mm)
+    double bfcachetol_; // tolerance on reference position change for reusing cached BFieldMap values along the track (mm); 0 disables the cache
+    double matmergedt_; // maximum time span (ns) of consecutive material crossings without hits between them merged into a single effect; 0 disables merging
+    double matmergedp_; // maximum fractional momentum change of merged material crossings
     unsigned minndof_; // minimum number of DOFs to continue fit
     BFCorr bfcorr_; // how to make BFieldMap corrections in the fit
+    bool sqrtinv_; // invert the fit state and end constraints through a square-root (Cholesky) factorization
     printLevel plevel_; // print level
     // schedule of meta-iterations.  These will be executed sequentially until completion or failure
     MetaIterConfigCol schedule_; 
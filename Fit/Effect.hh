@@ -13,8 +13,22 @@
 #include <array>
 #include <memory>
 #include <ostream>
+#include <stdexcept>
 
 namespace KinKal {
+  // lightweight view of the fit result at an effect: the smoothed parameters, combining the information from both processing directions
+  struct SmoothedState {
+    double time_; // time of the effect
+    Parameters pars_; // smoothed parameters and covariance
+  };
+
+  // description of processing an effect as an increment of the fit state.  This lets the effects of a batch of fits be processed
+  // together (see TrackBatch).  The effect may cache the weight representation of the state before and/or after the increment
+  struct StateIncrement {
+    FitState::Space space_ = FitState::noSpace; // representation of the increment; noSpace if the state isn't changed
+    FitData data_; // the increment
+    bool cacheBefore_ = false, cacheAfter_ = false;
+  };
  
   template<class KTRAJ> class Effect {
     public:
@@ -27,6 +41,15 @@ namespace KinKal {
       virtual bool active() const = 0; // whether this effect is/was used in the fit
       // Add this effect to the ongoing fit in the given direction.
       virtual void process(FitState& kkdata,TimeDir tdir) = 0;
+      // representation of the fit state first accessed when processing in the given direction.  This lets a batch of fits
+      // prepare the states before processing
+      virtual FitState::Space processSpace(TimeDir tdir) const { return FitState::noSpace; }
+      // describe processing in the given direction as a state increment.  Effects returning false can only be processed through process()
+      virtual bool increment(TimeDir tdir, StateIncrement& incr) const { return false; }
+      // cache the weight representation of the state, as requested by the increment
+      virtual void cacheState(Weights const& wdata, TimeDir tdir) {}
+      // process by applying an increment.  Effects describing their processing as an increment use this to implement process()
+      void processIncrement(FitState& kkdata, TimeDir tdir, StateIncrement const& incr);
       // update this effect for a new reference trajectory within the existing algebraic iteration sequence
       virtual void update(PKTRAJ const& ref) = 0;
       // update this effect to start a new algebraic iteration squence using the new reference trajectory and configuration
@@ -41,6 +64,10 @@ namespace KinKal {
       virtual Chisq chisq(Parameters const& pdata) const { return Chisq();} // chisq contribution WRT parameters 
       // The following only has a non-trivial implemetation for effects which (potentially) alter the physical particle trajectory
       virtual void append(PKTRAJ& fit) {};
+      // The following only has a non-trivial implementation for effects which cache the processing state in both directions.
+      // The smoothed state is much cheaper than building the fit trajectory, but is only available after processing in both directions
+      virtual bool hasSmoothedState() const { return false; }
+      virtual SmoothedState smoothedState() const { throw std::invalid_argument("Effect has no smoothed state"); }
       // disallow copy and equivalence
       Effect(Effect const& ) = delete; 
       Effect& operator =(Effect const& ) = delete; 
@@ -61,6 +88,16 @@ namespace KinKal {
     return ost;
   }
 
+  template <class KTRAJ> void Effect<KTRAJ>::processIncrement(FitState& kkdata, TimeDir tdir, StateIncrement const& incr) {
+    if(incr.cacheBefore_)cacheState(kkdata.wData(),tdir);
+    if(incr.space_ == FitState::parameterSpace)
+      kkdata.append(Parameters(incr.data_.vec(),incr.data_.mat()));
+    else if(incr.space_ == FitState::weightSpace)
+      kkdata.append(Weights(incr.data_.vec(),incr.data_.mat()));
+    if(incr.cacheAfter_)cacheState(kkdata.wData(),tdir);
+    setState(tdir,processed);
+  }
+
   template <class KTRAJ> std::string const& Effect<KTRAJ>::stateName(Effect::State state) {
     const static std::vector<std::string> stateNames_ = { "Unprocessed", "Processed", "Updated", "Failed" };
     switch (state) {
@@ -10,12 +10,20 @@
 namespace KinKal {
   class FitState {
     public:
-      FitState() : hasParameters_(false), hasWeights_(false) {}
-      FitState(Parameters const& pdata) : pdata_(pdata), hasParameters_(true), hasWeights_(false) {}
-      FitState(Weights const& wdata) : wdata_(wdata), hasParameters_(false), hasWeights_(true) {}
+      enum Space {noSpace=0, parameterSpace, weightSpace}; // representation of the fit data
+      FitState() : hasParameters_(false), hasWeights_(false), invmethod_(FitData::direct) {}
+      FitState(FitData::InvMethod method) : hasParameters_(false), hasWeights_(false), invmethod_(method) {}
+      FitState(Parameters const& pdata) : pdata_(pdata), hasParameters_(true), hasWeights_(false), invmethod_(FitData::direct) {}
+      FitState(Weights const& wdata) : wdata_(wdata), hasParameters_(false), hasWeights_(true), invmethod_(FitData::direct) {}
       // accessors
       bool hasParameters() const { return hasParameters_; }
       bool hasWeights() const { return hasWeights_; }
+      // whether accessing the given representation requires an inversion
+      bool needsInversion(Space space) const {
+	return (space == parameterSpace && hasWeights_ && !hasParameters_) || (space == weightSpace && hasParameters_ && !hasWeights_); }
+      // set the missing representation from an external (ie batched) inversion of the valid one
+      void setInverted(Parameters const& pdata) { pdata_ = pdata; hasParameters_ = true; }
+      void setInverted(Weights const& wdata) { wdata_ = wdata; hasWeights_ = true; }
       // add to either parameters or weights
       void append(Parameters const& pdata) {
 	pData() += pdata;
@@ -32,7 +40,7 @@ namespace KinKal {
       Parameters& pData() { 
 	if(!hasParameters_ && hasWeights_ ){
 	  // invert the weight
-	  pdata_ = Parameters(wdata_);
+	  pdata_ = Parameters(wdata_,invmethod_);
 	  hasParameters_ = true;
 	}
 	return pdata_;
@@ -40,7 +48,7 @@ namespace KinKal {
       Weights& wData() { 
 	if(!hasWeights_ && hasParameters_ ){
 	  // invert the parameters
-	  wdata_ = Weights(pdata_);
+	  wdata_ = Weights(pdata_,invmethod_);
 	  hasWeights_ = true;
 	}
 	return wdata_;
@@ -49,6 +57,7 @@ namespace KinKal {
       Parameters pdata_; // parameters space representation of (intermediate) fit data
       Weights wdata_; // weight space representation of fit data
       bool hasParameters_, hasWeights_;  // keep track of validity for lazy evaluation (cache coherence)
+      FitData::InvMethod invmethod_; // how to invert between the representations
   };
 }
 #endif
@@ -0,0 +1,66 @@
+#include "KinKal/Fit/FitStateBatch.hh"
+namespace KinKal {
+  void FitStateBatch::reset() {
+    // empty lanes are zero, so the first increment can be added to them
+    pdata_.zero();
+    wdata_.zero();
+    hasParameters_.fill(false);
+    hasWeights_.fill(false);
+  }
+
+  FitStateBatch::Mask FitStateBatch::invert(Mask const& pmask, Mask const& wmask, FitData::InvMethod method) {
+    // gather the representation to invert from each lane
+    FitDataLanes source, inverse;
+    Mask mask;
+    for(size_t lane=0;lane<nlanes_;lane++) mask[lane] = pmask[lane] || wmask[lane];
+    source.select(wdata_,pdata_,pmask);
+    auto failed = method == FitData::cholesky ? source.invert(inverse,mask) : source.invertDirect(inverse,mask);
+    Mask pdone, wdone;
+    for(size_t lane=0;lane<nlanes_;lane++){
+      pdone[lane] = pmask[lane] && !failed[lane];
+      wdone[lane] = wmask[lane] && !failed[lane];
+      hasParameters_[lane] |= pdone[lane];
+      hasWeights_[lane] |= wdone[lane];
+    }
+    pdata_.copy(inverse,pdone);
+    wdata_.copy(inverse,wdone);
+    return failed;
+  }
+
+  void FitStateBatch::append(FitState::Space space, FitDataLanes const& incr, Mask const& mask) {
+    bool isparams = space == FitState::parameterSpace;
+    (isparams ? pdata_ : wdata_).add(incr,mask);
+    for(size_t lane=0;lane<nlanes_;lane++){
+      if(mask[lane]){
+	hasParameters_[lane] = isparams;
+	hasWeights_[lane] = !isparams;
+      }
+    }
+  }
+
+  Parameters FitStateBatch::parameters(size_t lane) const {
+    Parameters pdata;
+    pdata_.get(lane,pdata.fitData());
+    return pdata;
+  }
+
+  Weights FitStateBatch::weights(size_t lane) const {
+    Weights wdata;
+    wdata_.get(lane,wdata.fitData());
+    return wdata;
+  }
+
+  FitState FitStateBatch::state(size_t lane, FitData::InvMethod method) const {
+    FitState state(method);
+    if(hasParameters_[lane])state.setInverted(parameters(lane));
+    if(hasWeights_[lane])state.setInverted(weights(lane));
+    return state;
+  }
+
+  void FitStateBatch::setState(size_t lane, FitState& state) {
+    hasParameters_[lane] = state.hasParameters();
+    hasWeights_[lane] = state.hasWeights();
+    if(hasParameters_[lane])pdata_.set(lane,state.pData().fitData());
+    if(hasWeights_[lane])wdata_.set(lane,state.wData().fitData());
+  }
+}
@@ -0,0 +1,39 @@
+#ifndef KinKal_FitStateBatch_hh
+#define KinKal_FitStateBatch_hh
+//
+//  The FitStates of a batch of fits, stored in structure-of-arrays layout so that the inversions between the parameter and
+//  weight representations, and the additions of the effect increments, vectorize over the fits.  As in FitState, each lane
+//  keeps track of which representations are valid, and the other is only computed when requested.
+//  Used by TrackBatch
+//
+#include "KinKal/Fit/FitState.hh"
+#include "KinKal/General/FitDataBatch.hh"
+namespace KinKal {
+  class FitStateBatch {
+    public:
+      static constexpr size_t nlanes_ = FitDataLanes::nlanes_;
+      using Mask = FitDataLanes::Mask;
+      FitStateBatch() { reset(); }
+      // empty all the lanes, as at the start of a sweep
+      void reset();
+      bool needsInversion(size_t lane, FitState::Space space) const {
+	return (space == FitState::parameterSpace && hasWeights_[lane] && !hasParameters_[lane]) ||
+	  (space == FitState::weightSpace && hasParameters_[lane] && !hasWeights_[lane]); }
+      // compute the parameters of the lanes selected by pmask and the weights of those selected by wmask, in a single batch, with
+      // the given inversion method.  The lanes whose inversion failed are returned, and left unchanged
+      Mask invert(Mask const& pmask, Mask const& wmask, FitData::InvMethod method);
+      // add increments in the given representation to the selected lanes, invalidating their other representation.
+      // The selected lanes must have a valid representation in that space, or be empty
+      void append(FitState::Space space, FitDataLanes const& incr, Mask const& mask);
+      // the valid representations of a lane
+      Parameters parameters(size_t lane) const;
+      Weights weights(size_t lane) const;
+      // copy a lane to and from an individual FitState, to process effects which can't be batched
+      FitState state(size_t lane, FitData::InvMethod method) const;
+      void setState(size_t lane, FitState& state);
+    private:
+      FitDataLanes pdata_, wdata_; // parameter and weight representations
+      Mask hasParameters_, hasWeights_;
+  };
+}
+#endif
@@ -7,6 +7,7 @@
 #include "KinKal/Fit/Effect.hh"
 #include "KinKal/Trajectory/ParticleTrajectory.hh"
 #include "KinKal/Detector/Hit.hh"
+#include "KinKal/General/FitCache.hh"
 #include <ostream>
 #include <memory>
 
@@ -23,52 +24,68 @@ namespace KinKal {
       void update(PKTRAJ const& pktraj) override;
       void update(PKTRAJ const& pktraj, MetaIterConfig const& miconfig) override;
       void process(FitState& kkdata,TimeDir tdir) override;
+      FitState::Space processSpace(TimeDir tdir) const override { return this->active() ? FitState::weightSpace : FitState::noSpace; }
+      bool increment(TimeDir tdir, StateIncrement& incr) const override;
+      void cacheState(Weights const& wdata, TimeDir tdir) override { wcache_ += wdata; }
       bool active() const override { return hit_->active(); }
       double time() const override { return hit_->time(); }
       void print(std::ostream& ost=std::cout,int detail=0) const override;
+      bool hasSmoothedState() const override { return this->active() && KKEFF::wasProcessed(TimeDir::forwards) && KKEFF::wasProcessed(TimeDir::backwards); }
+      SmoothedState smoothedState() const override;
       virtual ~HitConstraint(){}
       // local functions
-      // construct from a hit and reference trajectory
-      HitConstraint(HITPTR const& hit, PKTRAJ const& reftraj,double precision=1e-6);
+      // construct from a hit and reference trajectory.  The hit queries the BField through the cache of the track being fit
+      HitConstraint(HITPTR const& hit, PKTRAJ const& reftraj, BFieldCache const& fcache, double precision=1e-6);
       // the unbiased parameters are the fit parameters not including the information content of this effect
       Parameters unbiasedParameters() const;
       // access the contents
       HITPTR const& hit() const { return hit_; }
-      Weights const& weightCache() const { return wcache_; }
-      Weights const& hitWeight() const { return hitwt_; }
+      // the caches may be stored in reduced precision, so they are returned by value
+      Weights weightCache() const { return wcache_.get(); }
+      Weights hitWeight() const { return hitwt_.get(); }
       double precision() const { return precision_; }
     private:
       HITPTR hit_ ; // hit used for this constraint
-      Weights wcache_; // sum of processing weights in opposite directions, excluding this hit's information. used to compute unbiased parameters and chisquared
-      Weights hitwt_; // weight representation of the hits constraint
+      BFieldCache const& fcache_; // field cache of the track, passed to the hit on update
+      FitCache<Weights> wcache_; // sum of processing weights in opposite directions, excluding this hit's information. used to compute unbiased parameters and chisquared
+      FitCache<Weights> hitwt_; // weight representation of the hits constraint
       double vscale_; // variance factor due to annealing 'temperature'
       double precision_; // precision used in TCA calcuation
   };
 
-  template<class KTRAJ> HitConstraint<KTRAJ>::HitConstraint(HITPTR const& hit, PKTRAJ const& reftraj,double precision) : hit_(hit), vscale_(1.0), precision_(precision) {
+  template<class KTRAJ> HitConstraint<KTRAJ>::HitConstraint(HITPTR const& hit, PKTRAJ const& reftraj, BFieldCache const& fcache, double precision) :
+    hit_(hit), fcache_(fcache), vscale_(1.0), precision_(precision) {
     update(reftraj);
   }
  
   template<class KTRAJ> void HitConstraint<KTRAJ>::process(FitState& kkdata,TimeDir tdir) {
+    StateIncrement incr;
+    increment(tdir,incr);
+    KKEFF::processIncrement(kkdata,tdir,incr);
+  }
+
+  template<class KTRAJ> bool HitConstraint<KTRAJ>::increment(TimeDir tdir, StateIncrement& incr) const {
     // direction is irrelevant for processing hits 
     if(this->active()){
       // cache the processing weights, adding both processing directions
-      wcache_ += kkdata.wData();
+      incr.cacheBefore_ = true;
       // add this effect's information
-      kkdata.append(hitwt_);
+      incr.space_ = FitState::weightSpace;
+      incr.data_ = hitwt_.get().fitData();
     }
-    KKEFF::setState(tdir,KKEFF::processed);
+    return true;
   }
 
   template<class KTRAJ> void HitConstraint<KTRAJ>::update(PKTRAJ const& pktraj) {
     // reset the processing cache
     wcache_ = Weights();
     // update the hit
-    hit_->update(pktraj);
+    hit_->update(pktraj,fcache_);
     // get the weight from the hit 
-    hitwt_ = hit_->weight();
+    Weights hitwt = hit_->weight();
     // scale weight for the temp
-    hitwt_ *= 1.0/vscale_;
+    hitwt *= 1.0/vscale_;
+    hitwt_ = hitwt;
     // ready for processing!
     KKEFF::updateState();
   }
@@ -78,7 +95,7 @@ namespace KinKal {
     vscale_ = miconfig.varianceScale();
     precision_ = miconfig.tprec_;
     // update the hit's internal state; the actual update depends on the hit
-    hit_->updateState(pktraj,miconfig );
+    hit_->updateState(pktraj,miconfig,fcache_);
     // update the state of this object
     update(pktraj);
   }
@@ -100,14 +117,23 @@ namespace KinKal {
     if( !KKEFF::wasProcessed(TimeDir::forwards) || !KKEFF::wasProcessed(TimeDir::backwards))
       throw  std::invalid_argument("Can't compute unbiased parameters for unprocessed constraint");
     // Invert the cache to get unbiased parameters at this constraint
-    return Parameters(wcache_);
+    return Parameters(wcache_.get());
+  }
+
+  template<class KTRAJ> SmoothedState HitConstraint<KTRAJ>::smoothedState() const {
+    if(!hasSmoothedState())
+      throw  std::invalid_argument("Can't compute smoothed parameters for unprocessed constraint");
+    // the cache excludes this hit's information: add it back
+    Weights smoothed(wcache_.get());
+    smoothed += hitwt_.get();
+    return SmoothedState{time(),Parameters(smoothed)};
   }
 
   template <class KTRAJ> void HitConstraint<KTRAJ>::print(std::ostream& ost, int detail) const {
     ost << "HitConstraint " << static_cast<Effect<KTRAJ> const&>(*this) << std::endl;
     if(detail > 0){
       hit_->print(ost,detail);    
-      ost << " HitConstraint Weight " << hitwt_ << std::endl;
+      ost << " HitConstraint Weight " << hitwt_.get() << std::endl;
     }
   }
 
@@ -6,7 +6,10 @@
 //
 #include "KinKal/Fit/Effect.hh"
 #include "KinKal/Detector/ElementXing.hh"
+#include "KinKal/Detector/MergedXing.hh"
 #include "KinKal/General/TimeDir.hh"
+#include "KinKal/General/FitCache.hh"
+#include "KinKal/Trajectory/TrajectoryEval.hh"
 #include <iostream>
 #include <stdexcept>
 #include <array>
@@ -25,22 +28,31 @@ namespace KinKal {
       void update(PKTRAJ const& ref, MetaIterConfig const& miconfig) override;
       void print(std::ostream& ost=std::cout,int detail=0) const override;
       void process(FitState& kkdata,TimeDir tdir) override;
+      FitState::Space processSpace(TimeDir tdir) const override {
+	return dxing_->active() ? (tdir == TimeDir::forwards ? FitState::parameterSpace : FitState::weightSpace) : FitState::noSpace; }
+      bool increment(TimeDir tdir, StateIncrement& incr) const override;
+      void cacheState(Weights const& wdata, TimeDir tdir) override { cache_ += wdata; }
       void append(PKTRAJ& fit) override;
+      bool hasSmoothedState() const override { return dxing_->active() && KKEFF::wasProcessed(TimeDir::forwards) && KKEFF::wasProcessed(TimeDir::backwards); }
+      // the cache describes the fit just after this effect; this is also used to build the fit trajectory
+      SmoothedState smoothedState() const override { return SmoothedState{time(),Parameters(cache_.get())}; }
       virtual ~Material(){}
       // create from the material and a trajectory 
       Material(EXINGPTR const& dxing, PKTRAJ const& pktraj);
       // accessors
       Parameters const& effect() const { return mateff_; }
-      Weights const& cache() const { return cache_; }
+      Weights cache() const { return cache_.get(); } // returned by value, as it may be stored in reduced precision
       EXING const& detXing() const { return *dxing_; }
       KTRAJ const& refKTraj() const { return ref_; }
+      static double timeBuffer() { return tbuff_; } // offset of the effect time from the crossing time
     private:
       // update the local cache
       void updateCache();
+      void addEffect(EXING const& dxing, double time); // add the effect of a crossing at the given time
       EXINGPTR dxing_; // detector piece crossing for this effect
       KTRAJ ref_; // reference to local trajectory
       Parameters mateff_; // parameter space description of this effect
-      Weights cache_; // cache of weight processing in opposite directions, used to build the fit trajectory
+      FitCache<Weights> cache_; // cache of weight processing in opposite directions, used to build the fit trajectory
       double vscale_; // variance factor due to annealing 'temperature'
       static double tbuff_; // small time buffer to avoid ambiguity
   };
@@ -53,21 +65,26 @@ namespace KinKal {
   }
 
   template<class KTRAJ> void Material<KTRAJ>::process(FitState& kkdata,TimeDir tdir) {
+    StateIncrement incr;
+    increment(tdir,incr);
+    KKEFF::processIncrement(kkdata,tdir,incr);
+  }
+
+  template<class KTRAJ> bool Material<KTRAJ>::increment(TimeDir tdir, StateIncrement& incr) const {
     if(dxing_->active()){
+      incr.space_ = FitState::parameterSpace;
+      incr.data_ = mateff_.fitData();
       // forwards, set the cache AFTER processing this effect
       if(tdir == TimeDir::forwards) {
-	kkdata.append(mateff_);
-	cache_ += kkdata.wData();
+	incr.cacheAfter_ = true;
       } else {
 	// backwards, set the cache BEFORE processing this effect, to avoid double-counting it
-	cache_ += kkdata.wData();
+	incr.cacheBefore_ = true;
 	// SUBTRACT the effect going backwards: covariance change is sign-independent
-	Parameters reverse(mateff_);
-	reverse.parameters() *= -1.0;
-	kkdata.append(reverse);
+	incr.data_.vec() *= -1.0;
       }
     }
-    KKEFF::setState(tdir,KKEFF::processed);
+    return true;
   }
 
   template<class KTRAJ> void Material<KTRAJ>::update(PKTRAJ const& ref) {
@@ -87,27 +104,36 @@ namespace KinKal {
   template<class KTRAJ> void Material<KTRAJ>::updateCache() {
     mateff_ = Parameters();
     if(dxing_->active()){
-      // loop over the momentum change basis directions, adding up the effects on parameters from each
-      std::array<double,3> dmom = {0.0,0.0,0.0}, momvar = {0.0,0.0,0.0};
-      dxing_->materialEffects(ref_,TimeDir::forwards, dmom, momvar);
-      // get the parameter derivative WRT momentum
-      DPDV dPdM = ref_.dPardM(time());
-      double mommag = ref_.momentum(time());
-      for(int idir=0;idir<MomBasis::ndir; idir++) {
-	auto mdir = static_cast<MomBasis::Direction>(idir);
-	auto dir = ref_.direction(time(),mdir);
-	// project the momentum derivatives onto this direction
-	DVEC pder = mommag*(dPdM*SVEC3(dir.X(), dir.Y(), dir.Z()));
-	// convert derivative vector to a Nx1 matrix
-	ROOT::Math::SMatrix<double,NParams(),1> dPdm;
-	dPdm.Place_in_col(pder,0,0);
-	// update the transport for this effect; first the parameters.  Note these are for forwards time propagation (ie energy loss)
-	mateff_.parameters() += pder*dmom[idir];
-	// now the variance: this doesn't depend on time direction
-	ROOT::Math::SMatrix<double, 1,1, ROOT::Math::MatRepSym<double,1>> MVar;
-	MVar(0,0) = momvar[idir]*vscale_;
-	mateff_.covariance() += ROOT::Math::Similarity(dPdm,MVar);
-      }
+      // the constituents of merged crossings are transported at their own times.  As there are no measurements between them,
+      // the sum of their effects is the same as processing them individually
+      auto mxing = dynamic_cast<MergedXing<KTRAJ> const*>(dxing_.get());
+      if(mxing != 0){
+	for(auto const& xing : mxing->xings())
+	  if(xing->active())addEffect(*xing,xing->crossingTime()+tbuff_);
+      } else
+	addEffect(*dxing_,time());
+    }
+  }
+
+  template<class KTRAJ> void Material<KTRAJ>::addEffect(EXING const& dxing, double time) {
+    // loop over the momentum change basis directions, adding up the effects on parameters from each
+    std::array<double,3> dmom = {0.0,0.0,0.0}, momvar = {0.0,0.0,0.0};
+    dxing.materialEffects(ref_,TimeDir::forwards, dmom, momvar);
+    // get the direction basis and parameter derivative WRT momentum together
+    auto eval = ref_.evaluate(time,TrajectoryEval::basis|TrajectoryEval::dPardM);
+    for(int idir=0;idir<MomBasis::ndir; idir++) {
+      auto mdir = static_cast<MomBasis::Direction>(idir);
+      // project the momentum derivatives onto this direction
+      DVEC pder = eval.momDeriv(mdir);
+      // convert derivative vector to a Nx1 matrix
+      ROOT::Math::SMatrix<double,NParams(),1> dPdm;
+      dPdm.Place_in_col(pder,0,0);
+      // update the transport for this effect; first the parameters.  Note these are for forwards time propagation (ie energy loss)
+      mateff_.parameters() += pder*dmom[idir];
+      // now the variance: this doesn't depend on time direction
+      ROOT::Math::SMatrix<double, 1,1, ROOT::Math::MatRepSym<double,1>> MVar;
+      MVar(0,0) = momvar[idir]*vscale_;
+      mateff_.covariance() += ROOT::Math::Similarity(dPdm,MVar);
     }
   }
 
@@ -116,7 +142,7 @@ namespace KinKal {
       // create a trajectory piece from the cached weight
       double time = this->time();
       KTRAJ newpiece(ref_);
-      newpiece.params() = Parameters(cache_);
+      newpiece.setParams(Parameters(cache_.get()));
       // extend as necessary: absolute time can shift during iterations
       newpiece.range() = TimeRange(time,std::max(time+tbuff_,fit.range().end()));
       // make sure the piece is appendable; if not, adjust
@@ -0,0 +1,174 @@
+#ifndef KinKal_MultiHypothesisTrack_hh
+#define KinKal_MultiHypothesisTrack_hh
+//
+//  Fit the same particle under several mass hypotheses.  The primary (1st) hypothesis is fit with the hits and material crossings
+//  supplied.  Each subsequent hypothesis is fit with its own copies (clones) of them, so every hypothesis has its own hit and crossing state.
+//  The copies start from the converged state of the primary fit, including the hit ambiguity states, with the closest approach
+//  and crossing times mapped to the new speed, so their closest approach (hit and straw path length) calculations start from the
+//  primary results.  The subsequent hypotheses start from the primary fit trajectory and its BField domains, with the mass changed
+//  and the time scaled by the ratio of speeds, so only the mass-dependent effects (energy loss, scattering, kinematics) need to converge.
+//  By default the subsequent hypotheses only run the last meta-iteration of the schedule; if that fails, the hypothesis is refit
+//  from the same reference using the full schedule.  The hits and crossings must support cloning.
+//
+//  The subsequent hypotheses are approximations of independent fits.  Their hit states and crossings are not re-annealed for the
+//  new mass, and the last meta-iteration updates them from the primary fit instead of from an annealed fit of the same hypothesis,
+//  so with material the results differ from independent fits by a fraction of the parameter errors.  Each hypothesis repeats the
+//  closest approach calculations of its own hits and crossings (starting from the primary results), and a refit costs the full
+//  schedule on top of the abbreviated fit, so events needing refits can cost more than independent fits.
+//
+#include "KinKal/Fit/Track.hh"
+#include "KinKal/General/PhysicalConstants.h"
+#include <vector>
+#include <memory>
+#include <iterator>
+#include <cmath>
+#include <stdexcept>
+
+namespace KinKal {
+  template<class KTRAJ> class MultiHypothesisTrack {
+    public:
+      using TRACK = Track<KTRAJ>;
+      using PKTRAJ = ParticleTrajectory<KTRAJ>;
+      using HITCOL = typename TRACK::HITCOL;
+      using EXINGCOL = typename TRACK::EXINGCOL;
+      // construct from the seed and the mass of each hypothesis; the first is the primary.
+      // The subsequent hypotheses use the last meta-iteration of the configuration schedule
+      MultiHypothesisTrack(Config const& config, BFieldMap const& bfield, KTRAJ const& seedtraj, std::vector<double> const& masses,
+	  HITCOL& thits, EXINGCOL& dxings);
+      // same, using a separate configuration for the subsequent hypotheses
+      MultiHypothesisTrack(Config const& config, Config const& hypconfig, BFieldMap const& bfield, KTRAJ const& seedtraj, std::vector<double> const& masses,
+	  HITCOL& thits, EXINGCOL& dxings);
+      // accessors
+      size_t nHypotheses() const { return tracks_.size(); }
+      double mass(size_t ihyp) const { return masses_.at(ihyp); }
+      TRACK const& track(size_t ihyp) const { return *tracks_.at(ihyp); }
+      Status const& fitStatus(size_t ihyp) const { return track(ihyp).fitStatus(); }
+      bool refit(size_t ihyp) const { return refit_.at(ihyp); } // true if the abbreviated fit failed and the full schedule was used
+      PKTRAJ const& fitTraj(size_t ihyp) const { return track(ihyp).fitTraj(); }
+      // the hits and crossings of each hypothesis; those of the primary are the ones supplied on construction
+      HITCOL const& hits(size_t ihyp) const { return hits_.at(ihyp); }
+      EXINGCOL const& xings(size_t ihyp) const { return xings_.at(ihyp); }
+      Config const& hypothesisConfig() const { return hypconfig_; }
+      void print(std::ostream& ost=std::cout,int detail=0) const;
+      // the tracks reference the configuration, so disallow copy and move
+      MultiHypothesisTrack(MultiHypothesisTrack const& ) = delete;
+      MultiHypothesisTrack& operator =(MultiHypothesisTrack const& ) = delete;
+    private:
+      static Config lastMetaIteration(Config const& config);
+      // copy of a trajectory with a different mass, with times scaled around tref
+      static KTRAJ changeMass(KTRAJ const& ktraj, double mass, double tref, double tscale);
+      // add a hypothesis with copies of the primary hits and crossings, with times scaled around tref
+      void addClones(double tref, double tscale);
+      Config hypconfig_; // configuration of the subsequent hypotheses
+      std::vector<double> masses_; // mass of each hypothesis
+      std::vector<HITCOL> hits_; // hits of each hypothesis
+      std::vector<EXINGCOL> xings_; // crossings of each hypothesis
+      std::vector<std::unique_ptr<TRACK>> tracks_; // fit of each hypothesis
+      std::vector<bool> refit_; // which hypotheses were refit with the full schedule
+  };
+
+  template <class KTRAJ> MultiHypothesisTrack<KTRAJ>::MultiHypothesisTrack(Config const& config, BFieldMap const& bfield, KTRAJ const& seedtraj,
+      std::vector<double> const& masses, HITCOL& thits, EXINGCOL& dxings) :
+    MultiHypothesisTrack(config,lastMetaIteration(config),bfield,seedtraj,masses,thits,dxings) {}
+
+  template <class KTRAJ> MultiHypothesisTrack<KTRAJ>::MultiHypothesisTrack(Config const& config, Config const& hypconfig, BFieldMap const& bfield,
+      KTRAJ const& seedtraj, std::vector<double> const& masses, HITCOL& thits, EXINGCOL& dxings) : hypconfig_(hypconfig), masses_(masses) {
+    if(masses_.size() == 0) throw std::invalid_argument("MultiHypothesisTrack: no hypotheses");
+    tracks_.reserve(masses_.size());
+    refit_.assign(masses_.size(),false);
+    hits_.reserve(masses_.size());
+    xings_.reserve(masses_.size());
+    hits_.push_back(thits);
+    xings_.push_back(dxings);
+    double tref = seedtraj.range().mid();
+    // primary hypothesis; this defines the domains
+    if(seedtraj.mass() == masses_.front())
+      tracks_.emplace_back(std::make_unique<TRACK>(config,bfield,seedtraj,thits,dxings));
+    else
+      tracks_.emplace_back(std::make_unique<TRACK>(config,bfield,changeMass(seedtraj,masses_.front(),tref,1.0),thits,dxings));
+    auto const& primary = *tracks_.front();
+    auto domains = primary.domains();
+    for(size_t ihyp=1; ihyp < masses_.size(); ihyp++){
+      double mass = masses_[ihyp];
+      if(primary.fitStatus().usable()){
+	// the particle covers the same path at a different speed; scale the times around the middle of the fit
+	auto const& fittraj = primary.fitTraj();
+	double tmid = fittraj.range().mid();
+	auto const& midtraj = fittraj.nearestPiece(tmid);
+	double mom = midtraj.momentum(tmid);
+	double tscale = midtraj.speed(tmid)*sqrt(mom*mom + mass*mass)/(mom*CLHEP::c_light);
+	PKTRAJ reftraj(changeMass(fittraj.front(),mass,tmid,tscale));
+	for(auto ipiece = std::next(fittraj.pieces().begin()); ipiece != fittraj.pieces().end(); ++ipiece)
+	  reftraj.append(changeMass(*ipiece,mass,tmid,tscale));
+	std::vector<TimeRange> hypdomains;
+	hypdomains.reserve(domains.size());
+	for(auto const& domain : domains)
+	  hypdomains.emplace_back(tmid + (domain.begin()-tmid)*tscale,tmid + (domain.end()-tmid)*tscale);
+	// the seed must be scaled consistently, as the fit parameter change is tested against it
+	auto hypseed = changeMass(seedtraj,mass,tmid,tscale);
+	addClones(tmid,tscale);
+	tracks_.emplace_back(std::make_unique<TRACK>(hypconfig_,bfield,hypseed,reftraj,hypdomains,hits_.back(),xings_.back()));
+	// if the abbreviated fit fails, refit from the same reference with the full schedule, starting again from the primary state
+	if(!tracks_.back()->fitStatus().usable()){
+	  refit_[ihyp] = true;
+	  hits_.pop_back();
+	  xings_.pop_back();
+	  addClones(tmid,tscale);
+	  tracks_.back() = std::make_unique<TRACK>(config,bfield,hypseed,reftraj,hypdomains,hits_.back(),xings_.back());
+	}
+      } else {
+	// the primary failed: fit this hypothesis from scratch
+	addClones(tref,1.0);
+	tracks_.emplace_back(std::make_unique<TRACK>(config,bfield,changeMass(seedtraj,mass,tref,1.0),hits_.back(),xings_.back()));
+      }
+    }
+  }
+
+  template <class KTRAJ> void MultiHypothesisTrack<KTRAJ>::addClones(double tref, double tscale) {
+    HITCOL hits;
+    hits.reserve(hits_.front().size());
+    for(auto const& hit : hits_.front()){
+      hits.emplace_back(hit->clone());
+      hits.back()->scaleTime(tref,tscale);
+    }
+    EXINGCOL xings;
+    xings.reserve(xings_.front().size());
+    for(auto const& xing : xings_.front()){
+      xings.emplace_back(xing->clone());
+      xings.back()->scaleTime(tref,tscale);
+    }
+    hits_.push_back(std::move(hits));
+    xings_.push_back(std::move(xings));
+  }
+
+  template <class KTRAJ> Config MultiHypothesisTrack<KTRAJ>::lastMetaIteration(Config const& config) {
+    Config hypconfig(config);
+    if(config.schedule().size() > 0){
+      hypconfig.schedule() = Config::MetaIterConfigCol(1,config.schedule().back());
+      hypconfig.schedule().front().miter_ = 0;
+    }
+    return hypconfig;
+  }
+
+  template <class KTRAJ> KTRAJ MultiHypothesisTrack<KTRAJ>::changeMass(KTRAJ const& ktraj, double mass, double tref, double tscale) {
+    // evaluate at the middle of the range, which is assumed finite
+    double tmid = ktraj.range().mid();
+    auto pos = ktraj.position4(tmid);
+    pos.SetE(tref + (tmid-tref)*tscale);
+    auto mom = ktraj.momentum4(tmid);
+    mom.SetM(mass);
+    TimeRange range(tref + (ktraj.range().begin()-tref)*tscale,tref + (ktraj.range().end()-tref)*tscale);
+    KTRAJ newtraj(pos,mom,ktraj.charge(),ktraj.bnom(),range);
+    // keep the covariance; the parameters describe the same geometry
+    newtraj.setCovariance(ktraj.params().covariance());
+    return newtraj;
+  }
+
+  template <class KTRAJ> void MultiHypothesisTrack<KTRAJ>::print(std::ostream& ost, int detail) const {
+    for(size_t ihyp=0; ihyp < tracks_.size(); ihyp++){
+      ost << "Mass hypothesis " << masses_[ihyp] << " ";
+      tracks_[ihyp]->print(ost,detail);
+    }
+  }
+}
+#endif
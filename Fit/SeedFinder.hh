@@ -0,0 +1,461 @@
+#ifndef KinKal_SeedFinder_hh
+#define KinKal_SeedFinder_hh
+//
+//  Estimate a helical seed trajectory directly from hits, without any prior trajectory.  The hits are reduced to space points and
+//  lines (wires, strips, sensor axes) measuring the position transverse to the nominal BField.  For a fixed turning rate (radians per
+//  mm along the field) the transverse position of a helix is linear in the circle center and the radius vector at a reference
+//  position, so each measurement at a known longitudinal position gives a linear constraint.  The turning rate is found by scanning
+//  the algebraic fit over a window of measurements around the middle, which is then widened to include all of them.
+//  Measurements along the field (eg scintillator axes) only constrain the transverse position, and are added once the helix
+//  phase at their position is known.  The time origin is then fit to the timed measurements, and the drift wire hits are
+//  constrained to be tangent to their drift radius (circle-tangent fit), with the ambiguity from the current estimate.
+//  The measurements must follow the particle monotonically along the field, with less than half a turn between consecutive ones.
+//  Used to seed the kinematic Kalman fit
+//
+#include "KinKal/Detector/Hit.hh"
+#include "KinKal/Detector/WireHit.hh"
+#include "KinKal/Detector/PlanarHit.hh"
+#include "KinKal/Detector/BFieldUtils.hh"
+#include "KinKal/General/Vectors.hh"
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <stdexcept>
+
+namespace KinKal {
+  template <class KTRAJ> class SeedFinder {
+    public:
+      using HIT = Hit<KTRAJ>;
+      using HITPTR = std::shared_ptr<HIT>;
+      using HITCOL = std::vector<HITPTR>;
+      using WIREHIT = WireHit<KTRAJ>;
+      using PLANARHIT = PlanarHit<KTRAJ>;
+      // handler for hit types the SeedFinder doesn't know (eg detector-specific); returns true if the hit was added
+      using HITHANDLER = std::function<bool(HIT const& hit, SeedFinder& sfinder)>;
+      // a position measurement.  Lines measure the position transverse to their direction only
+      struct Measurement {
+	VEC3 pos_; // measured position, or a reference position on the line
+	VEC3 dir_; // line direction; null for a space point
+	double var_; // transverse position variance
+	double time_; // particle time at pos_; for a drift wire, the signal time including the drift
+	double dtds_; // change of time with distance along the line
+	double tvar_; // time variance; <= 0 if the time is not measured
+	WIREHIT const* whit_; // drift wire hit providing the drift model, if any
+	bool line() const { return dir_.R() > 0.0; }
+	bool timed() const { return tvar_ > 0.0; }
+	bool drift() const { return whit_ != 0; }
+      };
+      // the seed describes a particle of the given mass and charge in the nominal BField, with niter iterations of the time origin
+      // and drift fits.  The seed range covers the measurements, extended by tbuff
+      SeedFinder(VEC3 const& bnom, double mass, int charge, unsigned niter=3, double tbuff=0.5);
+      // add the hits measuring positions: wire hits and planar hits, and those accepted by the handler.  Other hits are ignored.
+      // Wire hits must stay alive until the seed is constructed.  Returns the number of hits used
+      unsigned addHits(HITCOL const& hits, HITHANDLER const& handler=HITHANDLER());
+      // add a space point with transverse variance var and optional time
+      void addPoint(VEC3 const& pos, double var, double time=0.0, double tvar=-1.0);
+      // add a line measurement through pos; the time at pos changes by dtds per mm along dir
+      void addLine(VEC3 const& pos, VEC3 const& dir, double var, double time=0.0, double dtds=0.0, double tvar=-1.0);
+      // add a drift wire hit.  Until the time origin is known, the wire is used as a line with the given variance
+      void addWire(WIREHIT const& whit, double var);
+      std::vector<Measurement> const& measurements() const { return meas_; }
+      // fit the measurements and construct the seed, with diagonal parameter covariance given by sigmas.  This throws
+      // if the measurements don't describe a helix
+      KTRAJ seed(DVEC const& sigmas) const;
+    private:
+      // helix estimate: turning rate, and the circle center and radius vector at zref_ in the transverse basis
+      struct Helix {
+	double omega_ = 0.0;
+	double xc_ = 0.0, yc_ = 0.0, ax_ = 0.0, ay_ = 0.0;
+	double chisq_ = -1.0; // < 0 if the fit failed
+	bool valid() const { return chisq_ >= 0.0; }
+      };
+      // linear constraint on the transverse position at longitudinal position z: (ux,uy).P(z) = val
+      struct Constraint { double ux_, uy_, z_, val_, wt_; };
+      // the local position and crossing of a measurement WRT a helix
+      struct Crossing {
+	double z_; // longitudinal position
+	double dist_; // distance along the line
+	double time_; // measured time at the crossing, corrected for the drift if a wire
+	double tvar_; // variance of that
+      };
+      double xpos(VEC3 const& pos) const { return pos.Dot(xdir_); }
+      double ypos(VEC3 const& pos) const { return pos.Dot(ydir_); }
+      double zpos(VEC3 const& pos) const { return pos.Dot(zdir_); }
+      bool axial(Measurement const& meas) const { return meas.line() && fabs(meas.dir_.Dot(zdir_)) > 0.999; }
+      VEC3 position(Helix const& helix, double zref, double z) const;
+      VEC3 direction(Helix const& helix, double zref, double z) const; // unit tangent for increasing z
+      // fit the transverse helix parameters to the constraints at a fixed turning rate, given the turning angle at each constraint
+      void fit(std::vector<Constraint> const& cons, std::vector<double> const& cost, std::vector<double> const& sint, Helix& helix) const;
+      void fit(std::vector<Constraint> const& cons, double zref, Helix& helix) const;
+      // scan nstep turning rates between omin and omax, optionally refining the best
+      Helix scan(std::vector<Constraint> const& cons, double zref, double omin, double omax, unsigned nstep, bool refine) const;
+      // constraints of a measurement, given the current helix estimate (if any) and time origin
+      void constraints(Measurement const& meas, Helix const& helix, double zref, double t0, double dtdz, bool hast0, std::vector<Constraint>& cons) const;
+      // crossing of a measurement with the current helix
+      Crossing crossing(Measurement const& meas, Helix const& helix, double zref) const;
+      VEC3 bnom_; // nominal BField
+      VEC3 xdir_, ydir_, zdir_; // basis with z along the BField
+      double mass_;
+      int charge_;
+      unsigned niter_; // time and drift fit iterations
+      double tbuff_; // range extension
+      std::vector<Measurement> meas_;
+      static constexpr unsigned nwindow_ = 12; // constraints in the initial scan window
+      static constexpr double dtheta_ = 0.1; // turning angle across the window between scan steps
+  };
+
+  template <class KTRAJ> SeedFinder<KTRAJ>::SeedFinder(VEC3 const& bnom, double mass, int charge, unsigned niter, double tbuff) :
+    bnom_(bnom), zdir_(bnom.Unit()), mass_(mass), charge_(charge), niter_(std::max(niter,1u)), tbuff_(tbuff) {
+      if(bnom.R() <= 0.0 || charge == 0)throw std::invalid_argument("Seed requires a charged particle in a BField");
+      VEC3 xref = fabs(zdir_.X()) < 0.9 ? VEC3(1.0,0.0,0.0) : VEC3(0.0,1.0,0.0);
+      xdir_ = (xref - zdir_*xref.Dot(zdir_)).Unit();
+      ydir_ = zdir_.Cross(xdir_);
+    }
+
+  template <class KTRAJ> unsigned SeedFinder<KTRAJ>::addHits(HITCOL const& hits, HITHANDLER const& handler) {
+    unsigned nused(0);
+    for(auto const& hit : hits) {
+      if(!hit->active())continue;
+      auto const* whit = dynamic_cast<WIREHIT const*>(hit.get());
+      if(whit != 0){
+	// the drift distance is unknown until the time origin is, so use the spread over the cell if there's a drift table
+	double var = whit->driftTable() != 0 ? whit->driftTable()->maxDistance()*whit->driftTable()->maxDistance()/3.0 : whit->hitState().nullvar_;
+	addWire(*whit,var);
+	nused++;
+	continue;
+      }
+      auto const* phit = dynamic_cast<PLANARHIT const*>(hit.get());
+      if(phit != 0){
+	unsigned nmeas = phit->timed() ? phit->nResid()-1 : phit->nResid();
+	VEC3 pos = phit->plane().center();
+	double var(0.0);
+	for(unsigned imeas=0; imeas < nmeas; imeas++){
+	  pos += phit->measurementDirection(imeas)*phit->measurement(imeas);
+	  var += phit->measurementVariance(imeas)/nmeas;
+	}
+	double time = phit->timed() ? phit->timeMeasurement() : phit->time();
+	double tvar = phit->timed() ? phit->timeVariance() : -1.0;
+	if(nmeas > 1)
+	  addPoint(pos,var,time,tvar);
+	else // a strip measures along the line in the plane perpendicular to the measurement direction
+	  addLine(pos,phit->plane().normal().Cross(phit->measurementDirection(0)).Unit(),var,time,0.0,tvar);
+	nused++;
+	continue;
+      }
+      if(handler && handler(*hit,*this))nused++;
+    }
+    return nused;
+  }
+
+  template <class KTRAJ> void SeedFinder<KTRAJ>::addPoint(VEC3 const& pos, double var, double time, double tvar) {
+    meas_.push_back(Measurement{pos,VEC3(),var,time,0.0,tvar,0});
+  }
+
+  template <class KTRAJ> void SeedFinder<KTRAJ>::addLine(VEC3 const& pos, VEC3 const& dir, double var, double time, double dtds, double tvar) {
+    meas_.push_back(Measurement{pos,dir.Unit(),var,time,dtds,tvar,0});
+  }
+
+  template <class KTRAJ> void SeedFinder<KTRAJ>::addWire(WIREHIT const& whit, double var) {
+    // start from the middle of the wire
+    auto const& wire = whit.wire();
+    double tmid = wire.range().mid();
+    meas_.push_back(Measurement{wire.position3(tmid),wire.direction(),var,tmid,1.0/wire.speed(),-1.0,&whit});
+  }
+
+  template <class KTRAJ> VEC3 SeedFinder<KTRAJ>::position(Helix const& helix, double zref, double z) const {
+    double theta = helix.omega_*(z-zref);
+    double ct = cos(theta), st = sin(theta);
+    return xdir_*(helix.xc_ + helix.ax_*ct - helix.ay_*st) + ydir_*(helix.yc_ + helix.ax_*st + helix.ay_*ct) + zdir_*z;
+  }
+
+  template <class KTRAJ> VEC3 SeedFinder<KTRAJ>::direction(Helix const& helix, double zref, double z) const {
+    double theta = helix.omega_*(z-zref);
+    double ct = cos(theta), st = sin(theta);
+    return (helix.omega_*(xdir_*(-helix.ax_*st - helix.ay_*ct) + ydir_*(helix.ax_*ct - helix.ay_*st)) + zdir_).Unit();
+  }
+
+  template <class KTRAJ> void SeedFinder<KTRAJ>::fit(std::vector<Constraint> const& cons, double zref, Helix& helix) const {
+    std::vector<double> cost(cons.size()), sint(cons.size());
+    for(size_t icon=0; icon < cons.size(); icon++){
+      double theta = helix.omega_*(cons[icon].z_-zref);
+      cost[icon] = cos(theta);
+      sint[icon] = sin(theta);
+    }
+    fit(cons,cost,sint,helix);
+  }
+
+  template <class KTRAJ> void SeedFinder<KTRAJ>::fit(std::vector<Constraint> const& cons, std::vector<double> const& cost, std::vector<double> const& sint,
+      Helix& helix) const {
+    // normal equations of the linear fit for (xc, yc, ax, ay)
+    double mat[4][4] = {}, vec[4] = {}, sumsq(0.0);
+    for(size_t icon=0; icon < cons.size(); icon++){
+      auto const& con = cons[icon];
+      double ct = cost[icon], st = sint[icon];
+      double deriv[4] = {con.ux_, con.uy_, con.ux_*ct + con.uy_*st, con.uy_*ct - con.ux_*st};
+      for(unsigned irow=0; irow < 4; irow++){
+	vec[irow] += con.wt_*deriv[irow]*con.val_;
+	for(unsigned icol=0; icol <= irow; icol++) mat[irow][icol] += con.wt_*deriv[irow]*deriv[icol];
+      }
+      sumsq += con.wt_*con.val_*con.val_;
+    }
+    // solve by Cholesky decomposition.  Small pivots mean the turning rate doesn't separate the center from the radius vector
+    double lfac[4][4] = {};
+    for(unsigned jcol=0; jcol < 4; jcol++){
+      double diag = mat[jcol][jcol];
+      for(unsigned kcol=0; kcol < jcol; kcol++) diag -= lfac[jcol][kcol]*lfac[jcol][kcol];
+      if(!(diag > 1.0e-9*mat[jcol][jcol])){
+	helix.chisq_ = -1.0;
+	return;
+      }
+      lfac[jcol][jcol] = sqrt(diag);
+      for(unsigned irow=jcol+1; irow < 4; irow++){
+	double sum = mat[irow][jcol];
+	for(unsigned kcol=0; kcol < jcol; kcol++) sum -= lfac[irow][kcol]*lfac[jcol][kcol];
+	lfac[irow][jcol] = sum/lfac[jcol][jcol];
+      }
+    }
+    double yvec[4], par[4];
+    for(unsigned irow=0; irow < 4; irow++){
+      double sum = vec[irow];
+      for(unsigned kcol=0; kcol < irow; kcol++) sum -= lfac[irow][kcol]*yvec[kcol];
+      yvec[irow] = sum/lfac[irow][irow];
+    }
+    for(int irow=3; irow >= 0; irow--){
+      double sum = yvec[irow];
+      for(unsigned kcol=irow+1; kcol < 4; kcol++) sum -= lfac[kcol][irow]*par[kcol];
+      par[irow] = sum/lfac[irow][irow];
+    }
+    helix.xc_ = par[0]; helix.yc_ = par[1]; helix.ax_ = par[2]; helix.ay_ = par[3];
+    // the minimum chisquared is the weighted sum of squares less the fitted part
+    double fitsq(0.0);
+    for(unsigned irow=0; irow < 4; irow++) fitsq += yvec[irow]*yvec[irow];
+    helix.chisq_ = std::max(sumsq - fitsq,0.0);
+  }
+
+  template <class KTRAJ> typename SeedFinder<KTRAJ>::Helix SeedFinder<KTRAJ>::scan(std::vector<Constraint> const& cons, double zref,
+      double omin, double omax, unsigned nstep, bool refine) const {
+    Helix best, test;
+    double ostep = (omax-omin)/nstep;
+    // step the turning angles by rotation
+    std::vector<double> cost(cons.size()), sint(cons.size()), dcos(cons.size()), dsin(cons.size());
+    for(size_t icon=0; icon < cons.size(); icon++){
+      double dz = cons[icon].z_-zref;
+      cost[icon] = cos(omin*dz); sint[icon] = sin(omin*dz);
+      dcos[icon] = cos(ostep*dz); dsin[icon] = sin(ostep*dz);
+    }
+    for(unsigned istep=0; istep <= nstep; istep++){
+      test.omega_ = omin + istep*ostep;
+      fit(cons,cost,sint,test);
+      if(test.valid() && (!best.valid() || test.chisq_ < best.chisq_)) best = test;
+      for(size_t icon=0; icon < cons.size(); icon++){
+	double ct = cost[icon]*dcos[icon] - sint[icon]*dsin[icon];
+	sint[icon] = sint[icon]*dcos[icon] + cost[icon]*dsin[icon];
+	cost[icon] = ct;
+      }
+    }
+    if(!best.valid() || !refine)return best;
+    // golden section search around the best step
+    static const double gratio = 0.5*(sqrt(5.0)-1.0);
+    double oa = best.omega_ - ostep, ob = best.omega_ + ostep;
+    Helix h1, h2;
+    h1.omega_ = ob - gratio*(ob-oa); fit(cons,zref,h1);
+    h2.omega_ = oa + gratio*(ob-oa); fit(cons,zref,h2);
+    for(unsigned iter=0; iter < 20 && (ob-oa) > 1.0e-3*ostep; iter++){
+      if(!h2.valid() || (h1.valid() && h1.chisq_ < h2.chisq_)){
+	ob = h2.omega_; h2 = h1;
+	h1.omega_ = ob - gratio*(ob-oa); fit(cons,zref,h1);
+      } else {
+	oa = h1.omega_; h1 = h2;
+	h2.omega_ = oa + gratio*(ob-oa); fit(cons,zref,h2);
+      }
+    }
+    for(auto const& helix : {h1,h2}) if(helix.valid() && helix.chisq_ < best.chisq_) best = helix;
+    return best;
+  }
+
+  template <class KTRAJ> typename SeedFinder<KTRAJ>::Crossing SeedFinder<KTRAJ>::crossing(Measurement const& meas, Helix const& helix, double zref) const {
+    Crossing xing{zpos(meas.pos_),0.0,meas.time_,meas.tvar_};
+    if(axial(meas)){
+      // the phase is given by the transverse position, the turn by the position along the line
+      double phi = atan2(helix.ay_,helix.ax_) + helix.omega_*(xing.z_-zref);
+      double dphi = remainder(atan2(ypos(meas.pos_)-helix.yc_,xpos(meas.pos_)-helix.xc_) - phi,2.0*M_PI);
+      xing.z_ += dphi/helix.omega_;
+      xing.dist_ = (xing.z_ - zpos(meas.pos_))/meas.dir_.Dot(zdir_);
+    } else if(meas.line()){
+      // point on the line at the helix position with the same longitudinal position; iterate for stereo lines
+      for(unsigned iter=0; iter < 3; iter++){
+	xing.dist_ = (position(helix,zref,xing.z_) - meas.pos_).Dot(meas.dir_);
+	xing.z_ = zpos(meas.pos_ + xing.dist_*meas.dir_);
+	if(fabs(meas.dir_.Dot(zdir_)) < 1.0e-6)break;
+      }
+    }
+    xing.time_ += xing.dist_*meas.dtds_;
+    return xing;
+  }
+
+  template <class KTRAJ> void SeedFinder<KTRAJ>::constraints(Measurement const& meas, Helix const& helix, double zref, double t0, double dtdz,
+      bool hast0, std::vector<Constraint>& cons) const {
+    if(!meas.line() || axial(meas)){
+      // space points and lines along the field constrain both transverse coordinates.  Lines along the field need the helix
+      double z = zpos(meas.pos_);
+      if(axial(meas)){
+	if(!helix.valid())return;
+	z = crossing(meas,helix,zref).z_;
+      }
+      cons.push_back(Constraint{1.0,0.0,z,xpos(meas.pos_),1.0/meas.var_});
+      cons.push_back(Constraint{0.0,1.0,z,ypos(meas.pos_),1.0/meas.var_});
+      return;
+    }
+    // lines constrain the position perpendicular to them in the transverse plane
+    double dx = meas.dir_.Dot(xdir_), dy = meas.dir_.Dot(ydir_);
+    double dnorm = sqrt(dx*dx + dy*dy);
+    double ux = -dy/dnorm, uy = dx/dnorm;
+    double val = ux*xpos(meas.pos_) + uy*ypos(meas.pos_);
+    double wt = 1.0/meas.var_;
+    double z = zpos(meas.pos_);
+    if(helix.valid()){
+      auto xing = crossing(meas,helix,zref);
+      z = xing.z_;
+      if(meas.drift()){
+	// constrain the helix to be tangent to the drift radius.  The DOCA is measured perpendicular to the wire and the particle,
+	// so the transverse offset is the DOCA divided by the projection of that direction on the transverse constraint direction
+	VEC3 pdir = direction(helix,zref,z);
+	VEC3 ddir = meas.dir_.Cross(pdir).Unit();
+	VEC3 delta = position(helix,zref,z) - (meas.pos_ + xing.dist_*meas.dir_);
+	double udot = ux*ddir.Dot(xdir_) + uy*ddir.Dot(ydir_);
+	double doca = delta.Dot(ddir);
+	if(doca < 0.0){
+	  ddir *= -1.0;
+	  udot *= -1.0;
+	}
+	if(fabs(udot) > 0.1){
+	  // drift radius from the drift time, inverting the drift model
+	  double tdrift = hast0 ? xing.time_ - (t0 + dtdz*(z-zref)) : 0.0;
+	  VEC3 exbdir = bnom_.Cross(meas.dir_).Unit();
+	  POL2 drift(fabs(doca),asin(std::max(-1.0,std::min(1.0,ddir.Dot(exbdir)))));
+	  DriftInfo dinfo;
+	  double rdrift(0.0);
+	  for(unsigned iter=0; iter < 3; iter++){
+	    drift.SetR(rdrift);
+	    if(meas.whit_->driftTable() != 0)
+	      meas.whit_->driftTable()->distanceToTime(drift,dinfo);
+	    else
+	      meas.whit_->distanceToTime(drift,dinfo);
+	    rdrift = std::max(0.0,rdrift + (tdrift - dinfo.tdrift_)*dinfo.vdrift_);
+	  }
+	  double rvar = dinfo.tdriftvar_*dinfo.vdrift_*dinfo.vdrift_;
+	  // resolve the ambiguity from the current estimate unless the radius is too small to tell
+	  if(hast0 && rdrift*rdrift > 4.0*rvar){
+	    val += rdrift/udot;
+	    wt = udot*udot/rvar;
+	  } else if(hast0)
+	    wt = udot*udot/(rdrift*rdrift + rvar);
+	}
+      }
+    }
+    cons.push_back(Constraint{ux,uy,z,val,wt});
+  }
+
+  template <class KTRAJ> KTRAJ SeedFinder<KTRAJ>::seed(DVEC const& sigmas) const {
+    // constraints of the measurements which don't need a helix estimate, in order along the field
+    Helix helix;
+    std::vector<Constraint> cons;
+    for(auto const& meas : meas_) constraints(meas,helix,0.0,0.0,0.0,false,cons);
+    if(cons.size() < 5)throw std::invalid_argument("Insufficient measurements for seed");
+    std::sort(cons.begin(),cons.end(),[](Constraint const& a, Constraint const& b){ return a.z_ < b.z_; });
+    double zref = cons[cons.size()/2].z_;
+    // the turning rate is limited by the largest longitudinal gap between measurements
+    double maxgap(0.0);
+    for(size_t icon=1; icon < cons.size(); icon++) maxgap = std::max(maxgap,cons[icon].z_-cons[icon-1].z_);
+    if(maxgap <= 0.0)throw std::runtime_error("Seed measurements have no longitudinal extent");
+    double omax = M_PI/maxgap;
+    // scan a window around the middle, then widen it, searching around the previous estimate
+    size_t imid = cons.size()/2;
+    size_t nwin = std::min(cons.size(),size_t(nwindow_));
+    size_t ilow = std::min(imid - std::min(imid,nwin/2),cons.size()-nwin);
+    std::vector<Constraint> wcons(cons.begin()+ilow,cons.begin()+ilow+nwin);
+    double width = std::max(wcons.back().z_ - wcons.front().z_,maxgap);
+    double ostep = dtheta_/width;
+    helix = scan(wcons,zref,-omax,omax,std::max(2u,unsigned(ceil(2.0*omax/ostep))),false);
+    while(helix.valid() && wcons.size() < cons.size()){
+      nwin = std::min(cons.size(),2*nwin);
+      ilow = std::min(imid - std::min(imid,nwin/2),cons.size()-nwin);
+      wcons.assign(cons.begin()+ilow,cons.begin()+ilow+nwin);
+      double owidth = width;
+      width = std::max(wcons.back().z_ - wcons.front().z_,maxgap);
+      helix = scan(wcons,zref,helix.omega_ - dtheta_/owidth,helix.omega_ + dtheta_/owidth,std::max(4u,unsigned(ceil(2.0*width/owidth))),
+	  wcons.size() == cons.size());
+    }
+    if(!helix.valid() || fabs(helix.omega_) < 1.0e-12)throw std::runtime_error("Seed helix fit failure");
+    // the particle turns clockwise (decreasing phi) for positive charge along the field
+    double sense = charge_ > 0 ? -1.0 : 1.0;
+    double pt(0.0), pz(0.0), dtdz(0.0), t0(0.0);
+    bool hastime = std::any_of(meas_.begin(),meas_.end(),[](Measurement const& meas){ return meas.timed(); });
+    bool hasdrift = std::any_of(meas_.begin(),meas_.end(),[](Measurement const& meas){ return meas.drift(); });
+    for(unsigned iter=0; iter <= niter_; iter++){
+      double rad = sqrt(helix.ax_*helix.ax_ + helix.ay_*helix.ay_);
+      pt = BFieldUtils::cbar()*fabs(charge_)*bnom_.R()*rad;
+      pz = pt*sense/(rad*helix.omega_);
+      double mom = sqrt(pt*pt + pz*pz);
+      double speed = CLHEP::c_light*mom/sqrt(mom*mom + mass_*mass_);
+      dtdz = mom/(pz*speed);
+      // time origin from the timed measurements.  Otherwise use the drift wires, correcting for the drift, or all the measurements
+      double swt(0.0), st(0.0);
+      for(auto const& meas : meas_){
+	if(hastime && !meas.timed())continue;
+	auto xing = crossing(meas,helix,zref);
+	double wt = hastime ? 1.0/meas.tvar_ : 1.0;
+	if(!hastime && hasdrift){
+	  if(!meas.drift())continue;
+	  // drift time from the DOCA to the current estimate
+	  VEC3 delta = position(helix,zref,xing.z_) - (meas.pos_ + xing.dist_*meas.dir_);
+	  VEC3 ddir = meas.dir_.Cross(direction(helix,zref,xing.z_)).Unit();
+	  VEC3 exbdir = bnom_.Cross(meas.dir_).Unit();
+	  double doca = delta.Dot(ddir);
+	  if(doca < 0.0) ddir *= -1.0;
+	  POL2 drift(fabs(doca),asin(std::max(-1.0,std::min(1.0,ddir.Dot(exbdir)))));
+	  DriftInfo dinfo;
+	  if(meas.whit_->driftTable() != 0)
+	    meas.whit_->driftTable()->distanceToTime(drift,dinfo);
+	  else
+	    meas.whit_->distanceToTime(drift,dinfo);
+	  xing.time_ -= dinfo.tdrift_;
+	}
+	st += wt*(xing.time_ - dtdz*(xing.z_-zref));
+	swt += wt;
+      }
+      if(swt <= 0.0)throw std::runtime_error("Seed time fit failure");
+      t0 = st/swt;
+      if(iter == niter_)break;
+      // refit with the measurements along the field and the drift radii, around the current turning rate
+      cons.clear();
+      for(auto const& meas : meas_) constraints(meas,helix,zref,t0,dtdz,hastime || hasdrift,cons);
+      auto refit = scan(cons,zref,helix.omega_ - dtheta_/width,helix.omega_ + dtheta_/width,4,true);
+      if(!refit.valid())throw std::runtime_error("Seed helix fit failure");
+      helix = refit;
+    }
+    // construct the seed at the reference position
+    double phiref = atan2(helix.ay_,helix.ax_);
+    VEC3 pos = position(helix,zref,zref);
+    VEC3 momvec = (sense*pt)*(-sin(phiref)*xdir_ + cos(phiref)*ydir_) + pz*zdir_;
+    double zmin(zref), zmax(zref);
+    for(auto const& meas : meas_){
+      double z = crossing(meas,helix,zref).z_;
+      zmin = std::min(zmin,z);
+      zmax = std::max(zmax,z);
+    }
+    double t1 = t0 + dtdz*(zmin-zref), t2 = t0 + dtdz*(zmax-zref);
+    TimeRange range(std::min(t1,t2)-tbuff_,std::max(t1,t2)+tbuff_);
+    KTRAJ seedtraj(VEC4(pos.X(),pos.Y(),pos.Z(),t0),MOM4(momvec.X(),momvec.Y(),momvec.Z(),mass_),charge_,bnom_,range);
+    auto seedpar = seedtraj.params();
+    seedpar.covariance() = DMAT();
+    for(size_t ipar=0; ipar < NParams(); ipar++) seedpar.covariance()[ipar][ipar] = sigmas[ipar]*sigmas[ipar];
+    seedtraj.setParams(seedpar);
+    return seedtraj;
+  }
+
+}
+#endif
@@ -45,18 +45,25 @@
 #include "KinKal/Fit/Config.hh"
 #include "KinKal/Fit/Status.hh"
 #include "KinKal/Detector/BFieldMap.hh"
+#include "KinKal/Detector/BFieldCache.hh"
 #include "KinKal/Detector/BFieldUtils.hh"
+#include "KinKal/Detector/MergedXing.hh"
+#include "KinKal/General/FitProfile.hh"
 #include "TMath.h"
 #include <set>
+#include <algorithm>
 #include <vector>
 #include <iterator>
 #include <memory>
+#include <memory_resource>
 #include <cmath>
 #include <limits>
 #include <stdexcept>
 #include <ostream>
 
 namespace KinKal {
+  template<class KTRAJ> class TrackBatch;
+  template<class KTRAJ> class TrackFilter;
   template<class KTRAJ> class Track {
     public:
       using KKEFF = Effect<KTRAJ>;
@@ -71,80 +78,253 @@ namespace KinKal {
       using EXING = ElementXing<KTRAJ>;
       using EXINGPTR = std::shared_ptr<EXING>;
       using EXINGCOL = std::vector<EXINGPTR>;
+      using MXING = MergedXing<KTRAJ>;
+      struct KKEFFDelete { // effects are allocated from this track's memory resource
+	std::pmr::memory_resource* mres_;
+	size_t size_, align_;
+	void operator()(KKEFF* eff) const { eff->~KKEFF(); mres_->deallocate(eff,size_,align_); }
+      };
+      using KKEFFPTR = std::unique_ptr<KKEFF,KKEFFDelete>;
       struct KKEFFComp { // comparator to sort effects by time
-	bool operator()(std::unique_ptr<KKEFF> const& a, std::unique_ptr<KKEFF> const&  b) const {
+	bool operator()(KKEFFPTR const& a, KKEFFPTR const&  b) const {
 	  if(a.get() != b.get())
 	    return a->time() < b->time();
 	  else
 	    return false;
 	}
       };
-      typedef std::vector<std::unique_ptr<KKEFF>> KKEFFCOL; // container type for effects
-      // construct from a set of hits and passive material crossings
-      Track(Config const& config, BFieldMap const& bfield, KTRAJ const& seedtraj, HITCOL& thits, EXINGCOL& dxings );
+      typedef std::pmr::vector<KKEFFPTR> KKEFFCOL; // container type for effects
+      // construct from a set of hits and passive material crossings.  The effects and other per-track objects are allocated
+      // from the memory resource, which can be an arena (ie std::pmr::monotonic_buffer_resource) shared by all the tracks of
+      // an event.  The Track must be destroyed before the resource is released.  Nothing allocated from it is kept by the hits or crossings.
+      // The Status comments and the collections returned by value (smoothedStates, domains) use the default heap
+      Track(Config const& config, BFieldMap const& bfield, KTRAJ const& seedtraj, HITCOL& thits, EXINGCOL& dxings,
+	  std::pmr::memory_resource* mres=std::pmr::get_default_resource());
+      // same, starting from an existing reference trajectory and BField domains instead of building them from the seed.
+      // This allows re-using the result of a fit of the same particle under a different (ie mass) hypothesis
+      Track(Config const& config, BFieldMap const& bfield, KTRAJ const& seedtraj, PKTRAJ const& reftraj, std::vector<TimeRange> const& domains,
+	  HITCOL& thits, EXINGCOL& dxings, std::pmr::memory_resource* mres=std::pmr::get_default_resource());
       void fit(); // process the effects.  This creates the fit
       // accessors
-      std::vector<Status> const& history() const { return history_; }
+      std::pmr::vector<Status> const& history() const { return history_; }
       Status const& fitStatus() const { return history_.back(); } // most recent status
       KTRAJ const& seedTraj() const { return seedtraj_; }
       PKTRAJ const& refTraj() const { return reftraj_; }
+      // the fit trajectory is built from the effect caches when needed as the next reference, and at the end of the fit
       PKTRAJ const& fitTraj() const { return fittraj_; }
+      unsigned nFitTrajBuilds() const { return nbuilds_; } // number of times the fit trajectory was built
+      // smoothed fit state at every effect which caches it.  This is much cheaper than building the fit trajectory.  Note that with
+      // BField corrections the fit trajectory pieces are chained through the domain transitions, so can differ slightly from these
+      std::vector<SmoothedState> smoothedStates() const;
       KKEFFCOL const& effects() const { return effects_; }
+      std::vector<TimeRange> domains() const; // time ranges of the BField domains
       Config const& config() const { return config_; }
       BFieldMap const& bfield() const { return bfield_; }
+      BFieldCache const& bfieldCache() const { return fcache_; }
+      FitProfile const& profile() const { return profile_; } // only filled if compiled with KINKAL_PROFILE
       void print(std::ostream& ost=std::cout,int detail=0) const;
     private:
+      friend class TrackBatch<KTRAJ>; // batch fits drive the iterations of their tracks directly
+      friend class TrackFilter<KTRAJ>; // filters sweep the effects of their tracks directly
+      struct NoFit {}; // tag for constructing without fitting
+      Track(NoFit, Config const& config, BFieldMap const& bfield, KTRAJ const& seedtraj, HITCOL& thits, EXINGCOL& dxings,
+	  std::pmr::memory_resource* mres);
+      Track(NoFit, Config const& config, BFieldMap const& bfield, KTRAJ const& seedtraj, PKTRAJ const& reftraj, std::vector<TimeRange> const& domains,
+	  HITCOL& thits, EXINGCOL& dxings, std::pmr::memory_resource* mres);
       // helper functions
       void update(Status const& fstat, MetaIterConfig const& miconfig);
       void fitIteration(Status& status, MetaIterConfig const& miconfig);
+      // the steps of a fit iteration: start, process each effect in both directions, then test convergence
+      void startIteration(Status& fstat) const;
+      void processEffect(KKEFF& eff, FitState& state, TimeDir tdir, Status& fstat) const;
+      void finishIteration(Status& fstat, MetaIterConfig const& miconfig);
       bool canIterate() const;
+      void buildFitTraj();
+      void finishFit(); // build the final fit trajectory
+      void checkSeed();
       void createRefTraj(KTRAJ const& seedtraj);
+      double domainEnd(double tstart, KTRAJ const& ktraj, VEC3 const& bf, double tol) const; // end of the BField domain starting at tstart
+      void updateDomains(double tol); // re-derive the BField domains from the current reference
+      void createEffects(HITCOL& thits, EXINGCOL& dxings);
+      std::pmr::vector<unsigned> groupMaterials(); // sort the merged crossings and group them; returns the group sizes
+      void createMaterials(std::pmr::vector<unsigned> const& groups); // create a material effect for each group
+      void updateMaterials(); // regroup the merged crossings using the current reference
+      template <class EFF, class ... ARGS> KKEFFPTR makeEffect(ARGS&& ... args);
+#ifdef KINKAL_PROFILE
+      static FitProfile::Phase updatePhase(KKEFF const& eff);
+#endif
       // payload
       Config const& config_; // configuration
       BFieldMap const& bfield_; // magnetic field map
-      std::vector<Status> history_; // fit status history; records the current iteration
+      std::pmr::memory_resource* mres_; // source of memory for the per-track objects
+      BFieldCache fcache_; // field values along this track, used by the effects and passed to the hits when updating them
+      std::pmr::vector<Status> history_; // fit status history; records the current iteration
       KTRAJ seedtraj_; // seed for the fit
       DMAT seedwt_; // weight matrix from seed fit, used in convergence testing 
       PKTRAJ reftraj_; // reference against which the derivatives were evaluated and the current fit performed
       PKTRAJ fittraj_; // result of the current fit, becomes the reference when the fit is algebraically iterated
+      bool fitstale_ = false; // fittraj_ doesn't yet reflect the latest fit iteration
+      unsigned nbuilds_ = 0; // count of fit trajectory builds
       KKEFFCOL effects_; // effects used in this fit, sorted by time
+      std::pmr::vector<EXINGPTR> mergexings_; // crossings grouped into merged material effects, regrouped each meta-iteration
+      std::pmr::vector<unsigned> mergegroups_; // sizes of the current groups of mergexings_
+      FitProfile profile_; // timing and operation counts of this fit
   };
 
 // construct from configuration, reference (seed) fit, hits,and materials specific to this fit.  Note that hits
 // can contain associated materials.
-  template <class KTRAJ> Track<KTRAJ>::Track(Config const& cfg, BFieldMap const& bfield, KTRAJ const& seedtraj,  HITCOL& thits, EXINGCOL& dxings) : 
-    config_(cfg), bfield_(bfield), seedtraj_(seedtraj) {
-      // configuation check
-      if(config_.schedule().size() ==0)throw std::invalid_argument("Invalid configuration: no schedule");
-      // check seed covariance is invertible
-      seedwt_ = seedtraj_.params().covariance();
-      if(!seedwt_.Invert())throw std::runtime_error("Seed covariance uninvertible");
+  template <class KTRAJ> Track<KTRAJ>::Track(Config const& cfg, BFieldMap const& bfield, KTRAJ const& seedtraj,  HITCOL& thits, EXINGCOL& dxings,
+      std::pmr::memory_resource* mres) : Track(NoFit(),cfg,bfield,seedtraj,thits,dxings,mres) {
+      // now fit the track
+      fit();
+      KINKAL_PROFILE_GLOBAL(profile_);
+      if(config_.plevel_ > Config::none)print(std::cout, config_.plevel_);
+    }
+
+  template <class KTRAJ> Track<KTRAJ>::Track(Config const& cfg, BFieldMap const& bfield, KTRAJ const& seedtraj, PKTRAJ const& reftraj,
+      std::vector<TimeRange> const& domains, HITCOL& thits, EXINGCOL& dxings, std::pmr::memory_resource* mres) :
+    Track(NoFit(),cfg,bfield,seedtraj,reftraj,domains,thits,dxings,mres) {
+      // now fit the track
+      fit();
+      KINKAL_PROFILE_GLOBAL(profile_);
+      if(config_.plevel_ > Config::none)print(std::cout, config_.plevel_);
+    }
+
+  template <class KTRAJ> Track<KTRAJ>::Track(NoFit, Config const& cfg, BFieldMap const& bfield, KTRAJ const& seedtraj,  HITCOL& thits, EXINGCOL& dxings,
+      std::pmr::memory_resource* mres) : 
+    config_(cfg), bfield_(bfield), mres_(mres),
+    fcache_(bfield,cfg.bfcachetol_,cfg.bfcachetol_/seedtraj.speed(seedtraj.range().mid()),mres), history_(mres),
+    seedtraj_(seedtraj), reftraj_(mres), fittraj_(mres), effects_(mres), mergexings_(mres), mergegroups_(mres) {
+      KINKAL_PROFILE_SCOPE(profile_);
+      checkSeed();
       // Create the initial reference traj.  This also divides the range into domains of ~constant BField and creates correction effects for inhomogeneity
-      createRefTraj(seedtraj);
-      // create the effects.  First, loop over the hits
-      for(auto& thit : thits ) {
-	// create the hit effects and insert them in the set
-	effects_.emplace_back(std::make_unique<KKHIT>(thit,reftraj_));
+      {
+	KINKAL_PROFILE_TIMER(FitProfile::createRefTraj);
+	createRefTraj(seedtraj);
       }
-      //add material effects
+      createEffects(thits,dxings);
+    }
+
+  template <class KTRAJ> Track<KTRAJ>::Track(NoFit, Config const& cfg, BFieldMap const& bfield, KTRAJ const& seedtraj, PKTRAJ const& reftraj,
+      std::vector<TimeRange> const& domains, HITCOL& thits, EXINGCOL& dxings, std::pmr::memory_resource* mres) :
+    config_(cfg), bfield_(bfield), mres_(mres),
+    fcache_(bfield,cfg.bfcachetol_,cfg.bfcachetol_/seedtraj.speed(seedtraj.range().mid()),mres), history_(mres),
+    seedtraj_(seedtraj), reftraj_(mres), fittraj_(mres), effects_(mres), mergexings_(mres), mergegroups_(mres) {
+      KINKAL_PROFILE_SCOPE(profile_);
+      reftraj_ = reftraj;
+      checkSeed();
+      // the reference already has pieces for the local BField; just create the correction effects
+      if(config_.bfcorr_ != Config::nocorr) {
+	KINKAL_PROFILE_TIMER(FitProfile::createRefTraj);
+	for(auto const& domain : domains)
+	  effects_.emplace_back(makeEffect<KKBFIELD>(config_,fcache_,reftraj_,domain));
+      }
+      createEffects(thits,dxings);
+    }
+
+  template <class KTRAJ> void Track<KTRAJ>::checkSeed() {
+    // configuation check
+    if(config_.schedule().size() ==0)throw std::invalid_argument("Invalid configuration: no schedule");
+    // check seed covariance is invertible
+    seedwt_ = seedtraj_.params().covariance();
+    if(!seedwt_.Invert())throw std::runtime_error("Seed covariance uninvertible");
+  }
+
+  template <class KTRAJ> void Track<KTRAJ>::createEffects(HITCOL& thits, EXINGCOL& dxings) {
+    // create the effects.  First, loop over the hits
+    for(auto& thit : thits ) {
+      // create the hit effects and insert them in the set.  Hits query the field through this track's cache
+      effects_.emplace_back(makeEffect<KKHIT>(thit,reftraj_,fcache_));
+    }
+    //add material effects
+    if(config_.matmergedt_ > 0.0){
+      mergexings_.assign(dxings.begin(),dxings.end());
+      createMaterials(groupMaterials());
+    } else {
       for(auto& dxing : dxings) {
-	effects_.emplace_back(std::make_unique<KKMAT>(dxing,reftraj_));
+	effects_.emplace_back(makeEffect<KKMAT>(dxing,reftraj_));
       }
-      // preliminary sort; this makes sure the range is accurate when computing BField corrections
-      std::sort(effects_.begin(),effects_.end(),KKEFFComp ());
-      // reset the range 
-      reftraj_.setRange(TimeRange(std::min(reftraj_.range().begin(),effects_.begin()->get()->time() - config_.tbuff_),
-	    std::max(reftraj_.range().end(),effects_.rbegin()->get()->time() + config_.tbuff_)));
-      // create the end effects: these help manage the fit
-      effects_.emplace_back(std::make_unique<KKEND>(config_, bfield_, reftraj_,TimeDir::forwards));
-      effects_.emplace_back(std::make_unique<KKEND>(config_, bfield_, reftraj_,TimeDir::backwards));
-      // now fit the track
-      fit();
-      if(config_.plevel_ > Config::none)print(std::cout, config_.plevel_);
     }
+    // preliminary sort; this makes sure the range is accurate when computing BField corrections
+    std::sort(effects_.begin(),effects_.end(),KKEFFComp ());
+    // reset the range 
+    reftraj_.setRange(TimeRange(std::min(reftraj_.range().begin(),effects_.begin()->get()->time() - config_.tbuff_),
+	std::max(reftraj_.range().end(),effects_.rbegin()->get()->time() + config_.tbuff_)));
+    // create the end effects: these help manage the fit
+    effects_.emplace_back(makeEffect<KKEND>(config_, fcache_, reftraj_,TimeDir::forwards));
+    effects_.emplace_back(makeEffect<KKEND>(config_, fcache_, reftraj_,TimeDir::backwards));
+  }
+
+  template <class KTRAJ> std::pmr::vector<unsigned> Track<KTRAJ>::groupMaterials() {
+    // group consecutive crossings while their time span and cumulative momentum change on the reference are small.  Groups never span
+    // a hit, so that the material effects of a group commute, and processing them together is the same as processing them individually
+    std::sort(mergexings_.begin(),mergexings_.end(),[](EXINGPTR const& a, EXINGPTR const& b){ return a->crossingTime() < b->crossingTime(); });
+    std::pmr::vector<double> htimes(mres_);
+    for(auto const& eff : effects_) if(dynamic_cast<KKHIT const*>(eff.get()) != 0)htimes.push_back(eff->time());
+    std::sort(htimes.begin(),htimes.end());
+    auto ihtime = htimes.begin();
+    std::pmr::vector<unsigned> groups(mres_);
+    double tstart(0.0), gdmom(0.0);
+    for(auto const& dxing : mergexings_) {
+      std::array<double,3> dmom = {0.0,0.0,0.0}, momvar = {0.0,0.0,0.0};
+      dxing->materialEffects(reftraj_,TimeDir::forwards,dmom,momvar);
+      double xdmom = fabs(dmom[MomBasis::momdir_]);
+      // hits before this crossing's material effect
+      double xtime = dxing->crossingTime() + KKMAT::timeBuffer();
+      bool hitbefore(false);
+      while(ihtime != htimes.end() && *ihtime < xtime){
+	hitbefore = true;
+	ihtime++;
+      }
+      if(groups.empty() || hitbefore || dxing->crossingTime() - tstart > config_.matmergedt_ || gdmom + xdmom > config_.matmergedp_){
+	groups.push_back(0);
+	tstart = dxing->crossingTime();
+	gdmom = 0.0;
+      }
+      groups.back()++;
+      gdmom += xdmom;
+    }
+    return groups;
+  }
+
+  template <class KTRAJ> void Track<KTRAJ>::createMaterials(std::pmr::vector<unsigned> const& groups) {
+    // single crossings are used directly, others are merged into a single crossing
+    auto ixing = mergexings_.begin();
+    for(auto ngroup : groups) {
+      if(ngroup == 1)
+	effects_.emplace_back(makeEffect<KKMAT>(*ixing,reftraj_));
+      else {
+	EXINGPTR mxing = std::allocate_shared<MXING>(std::pmr::polymorphic_allocator<MXING>(mres_),typename MXING::EXINGCOL(ixing,ixing+ngroup,mres_));
+	effects_.emplace_back(makeEffect<KKMAT>(mxing,reftraj_));
+      }
+      ixing += ngroup;
+    }
+    mergegroups_ = groups;
+  }
+
+  template <class KTRAJ> void Track<KTRAJ>::updateMaterials() {
+    // the crossing times and materials change as the reference improves.  If that changes the groups, replace the material effects
+    bool sorted = std::is_sorted(mergexings_.begin(),mergexings_.end(),[](EXINGPTR const& a, EXINGPTR const& b){ return a->crossingTime() < b->crossingTime(); });
+    auto groups = groupMaterials();
+    if(sorted && groups == mergegroups_)return;
+    effects_.erase(std::remove_if(effects_.begin(),effects_.end(),
+	  [](KKEFFPTR const& eff){ return dynamic_cast<KKMAT const*>(eff.get()) != 0; }),effects_.end());
+    createMaterials(groups);
+  }
+
+  template <class KTRAJ> template <class EFF, class ... ARGS> typename Track<KTRAJ>::KKEFFPTR Track<KTRAJ>::makeEffect(ARGS&& ... args) {
+    void* mem = mres_->allocate(sizeof(EFF),alignof(EFF));
+    try {
+      return KKEFFPTR(new (mem) EFF(std::forward<ARGS>(args)...),KKEFFDelete{mres_,sizeof(EFF),alignof(EFF)});
+    } catch(...) {
+      mres_->deallocate(mem,sizeof(EFF),alignof(EFF));
+      throw;
+    }
+  }
 
   // fit iteration management 
   template <class KTRAJ> void Track<KTRAJ>::fit() {
+    KINKAL_PROFILE_SCOPE(profile_);
     // execute the schedule of meta-iterations
     for(auto imiconfig=config_.schedule().begin(); imiconfig != config_.schedule().end(); imiconfig++){
       auto miconfig  = *imiconfig;
@@ -167,61 +347,89 @@ namespace KinKal {
       }
       if(!fstat.usable())break;
     }
+    finishFit();
+  }
+
+  template <class KTRAJ> void Track<KTRAJ>::finishFit() {
+    // build the fit trajectory of the last iteration.  Errors are recorded in the final status, as for the iterations
+    try {
+      if(fitstale_)buildFitTraj();
+    } catch (std::exception const& error) {
+      history_.back().status_ = Status::failed;
+      history_.back().comment_ = error.what();
+    }
   }
 
   // single algebraic iteration 
   template <class KTRAJ> void Track<KTRAJ>::fitIteration(Status& fstat, MetaIterConfig const& miconfig) {
+    startIteration(fstat);
+    // fit in both directions (order doesn't matter)
+    // start with empty fit information; each effect will modify this as necessary, and cache what it needs for later processing
+    FitState forwardstate(config_.invMethod());
+    {
+      KINKAL_PROFILE_TIMER(FitProfile::forwardSweep);
+      for(auto feff = effects_.begin(); feff != effects_.end(); feff++)
+	processEffect(**feff,forwardstate,TimeDir::forwards,fstat);
+    }
+    // reset the fit information and process backwards
+    FitState backwardstate(config_.invMethod());
+    {
+      KINKAL_PROFILE_TIMER(FitProfile::backwardSweep);
+      for(auto beff = effects_.rbegin(); beff != effects_.rend(); beff++)
+	processEffect(**beff,backwardstate,TimeDir::backwards,fstat);
+    }
+    finishIteration(fstat,miconfig);
+  }
+
+  template <class KTRAJ> void Track<KTRAJ>::startIteration(Status& fstat) const {
     if(config_.plevel_ >= Config::complete)std::cout << "Processing fit iteration " << fstat.iter_ << std::endl;
     // reset counters
     fstat.chisq_ = Chisq(0.0, -(int)NParams());
     fstat.iter_++;
-    // fit in both directions (order doesn't matter)
-    auto feff = effects_.begin();
-    // start with empty fit information; each effect will modify this as necessary, and cache what it needs for later processing
-    FitState forwardstate;
-    while(feff != effects_.end()){
-      auto ieff = feff->get();
+  }
+
+  template <class KTRAJ> void Track<KTRAJ>::processEffect(KKEFF& eff, FitState& state, TimeDir tdir, Status& fstat) const {
+    if(tdir == TimeDir::forwards){
       // update chisquared increment WRT the current state: only needed forwards
-      Chisq dchisq = ieff->chisq(forwardstate.pData());
+      Chisq dchisq = eff.chisq(state.pData());
       fstat.chisq_ += dchisq;
-      // process
-      ieff->process(forwardstate,TimeDir::forwards);
+      eff.process(state,tdir);
       if(config_.plevel_ >= Config::detailed){
 	std::cout << "Chisq total " << fstat.chisq_ << " increment " << dchisq << " ";
-	ieff->print(std::cout,config_.plevel_);
+	eff.print(std::cout,config_.plevel_);
       }
-      feff++;
-    }
-    // reset the fit information and process backwards
-    FitState backwardstate;
-    auto beff = effects_.rbegin();
-    while(beff != effects_.rend()){
-      auto ieff = beff->get();
-      ieff->process(backwardstate,TimeDir::backwards);
-      beff++;
-    }
-    // convert the fit result into a new trajectory; start with an empty ptraj
-    fittraj_ = PKTRAJ();
-    // process forwards, adding pieces as necessary
-    for(auto& ieff : effects_) {
-      ieff->append(fittraj_);
-    }
-    // trim the range to the physical elements (past the end sites)
-    feff = effects_.begin(); feff++;
-    beff = effects_.rbegin(); beff++;
-    fittraj_.front().range().begin() = (*feff)->time() - config_.tbuff_;
-    fittraj_.back().range().end() = (*beff)->time() + config_.tbuff_;
-    // compute parameter change WRT seed.  Compare in the middle
-    auto const& mtraj = fittraj_.nearestPiece(fittraj_.range().mid());
-    DVEC dpar = mtraj.params().parameters() - seedtraj_.params().parameters();
+    } else
+      eff.process(state,tdir);
+  }
+
+  template <class KTRAJ> void Track<KTRAJ>::finishIteration(Status& fstat, MetaIterConfig const& miconfig) {
+    // the fit trajectory is only needed as the next reference or at the end of the fit, so defer building it
+    fitstale_ = true;
+    // compute parameter change WRT seed.  Compare in the middle of the physical elements (past the end sites), using
+    // the smoothed state of the last effect before it.  The front end site always provides a state
+    auto feff = effects_.begin(); feff++;
+    auto beff = effects_.rbegin(); beff++;
+    double tmid = 0.5*((*feff)->time() + (*beff)->time());
+    auto meff = effects_.rbegin();
+    while(meff != effects_.rend() && !((*meff)->hasSmoothedState() && (*meff)->time() <= tmid))meff++;
+    if(meff == effects_.rend())throw std::runtime_error("No smoothed state");
+    auto mstate = (*meff)->smoothedState();
+    DVEC dpar = mstate.pars_.parameters() - seedtraj_.params().parameters();
     double delta = ROOT::Math::Similarity(dpar,seedwt_);
+    // optionally test the parameter change WRT the reference at the same effect.  If that is small, another iteration
+    // would reproduce this result, so the fit has converged without needing to rebuild the reference
+    bool pconverged(false);
+    if(miconfig.convdpar_ > 0.0){
+      DVEC dref = mstate.pars_.parameters() - reftraj_.nearestPiece(mstate.time_).params().parameters();
+      pconverged = ROOT::Math::Similarity(dref,Weights(mstate.pars_).weightMat()) < miconfig.convdpar_;
+    }
     // update status.  Convergence criteria is iteration-dependent.
     double dchisq = fstat.chisq_.chisqPerNDOF() - fitStatus().chisq_.chisqPerNDOF();
     if (delta > config().pdchi2_ || (fstat.iter_ > 0 && dchisq > miconfig.divdchisq_) ) {
       fstat.status_ = Status::diverged;
     } else if (fstat.chisq_.nDOF() < config_.minndof_){
       fstat.status_ = Status::lowNDOF;
-    } else if(fabs(dchisq) < miconfig.convdchisq_) {
+    } else if(fabs(dchisq) < miconfig.convdchisq_ || pconverged) {
       fstat.status_ = Status::converged;
     } else
       fstat.status_ = Status::unconverged;
@@ -229,64 +437,109 @@ namespace KinKal {
 
   // update between iterations 
   template <class KTRAJ> void Track<KTRAJ>::update(Status const& fstat, MetaIterConfig const& miconfig) {
+    if(fitstale_)buildFitTraj();
     if(fstat.iter_ < 0) { // 1st iteration of a meta-iteration: update the state
-      if(miconfig.miter_ > 0)// if this isn't the 1st meta-iteration, swap the fit trajectory to the reference
+      if(miconfig.miter_ > 0){// if this isn't the 1st meta-iteration, swap the fit trajectory to the reference
 	reftraj_ = fittraj_;
-      for(auto& ieff : effects_ ) ieff->update(reftraj_,miconfig);
+	// optionally re-derive the BField domains from the improved reference
+	if(miconfig.bftol_ > 0.0 && config_.bfcorr_ != Config::nocorr)updateDomains(miconfig.bftol_);
+	// regroup merged material crossings; the new effects are updated with the rest
+	if(config_.matmergedt_ > 0.0)updateMaterials();
+      }
+      for(auto& ieff : effects_ ) {
+	KINKAL_PROFILE_TIMER(updatePhase(*ieff));
+	ieff->update(reftraj_,miconfig);
+      }
     } else {
       //swap the fit trajectory to the reference
       reftraj_ = fittraj_;
       // update the effects to use the new reference
-      for(auto& ieff : effects_) ieff->update(reftraj_);
+      for(auto& ieff : effects_) {
+	KINKAL_PROFILE_TIMER(updatePhase(*ieff));
+	ieff->update(reftraj_);
+      }
     }
     // sort the effects by time
     std::sort(effects_.begin(),effects_.end(),KKEFFComp ());
   }
 
+  // convert the fit result into a new trajectory
+  template <class KTRAJ> void Track<KTRAJ>::buildFitTraj() {
+    KINKAL_PROFILE_TIMER(FitProfile::rebuild);
+    // start with an empty ptraj, keeping its memory
+    fittraj_.clear();
+    // process forwards, adding pieces as necessary
+    for(auto const& ieff : effects_) {
+      ieff->append(fittraj_);
+    }
+    // trim the range to the physical elements (past the end sites)
+    auto feff = effects_.begin(); feff++;
+    auto beff = effects_.rbegin(); beff++;
+    fittraj_.front().range().begin() = (*feff)->time() - config_.tbuff_;
+    fittraj_.back().range().end() = (*beff)->time() + config_.tbuff_;
+    fitstale_ = false;
+    nbuilds_++;
+  }
+
+  template<class KTRAJ> std::vector<SmoothedState> Track<KTRAJ>::smoothedStates() const {
+    std::vector<SmoothedState> states;
+    states.reserve(effects_.size());
+    for(auto const& ieff : effects_) {
+      if(ieff->hasSmoothedState())states.push_back(ieff->smoothedState());
+    }
+    return states;
+  }
+
   template<class KTRAJ> bool Track<KTRAJ>::canIterate() const {
     return fitStatus().needsFit() && fitStatus().iter_ < config_.maxniter_;
   }
 
+#ifdef KINKAL_PROFILE
+  template<class KTRAJ> FitProfile::Phase Track<KTRAJ>::updatePhase(KKEFF const& eff) {
+    if(dynamic_cast<KKHIT const*>(&eff) != 0) return FitProfile::hitUpdate;
+    if(dynamic_cast<KKMAT const*>(&eff) != 0) return FitProfile::materialUpdate;
+    if(dynamic_cast<KKBFIELD const*>(&eff) != 0) return FitProfile::bfieldUpdate;
+    return FitProfile::endUpdate;
+  }
+#endif
+
+  template<class KTRAJ> std::vector<TimeRange> Track<KTRAJ>::domains() const {
+    std::vector<TimeRange> domains;
+    for(auto const& eff : effects_) {
+      auto const* kkbf = dynamic_cast<KKBFIELD const*>(eff.get());
+      if(kkbf != 0)domains.push_back(kkbf->range());
+    }
+    std::sort(domains.begin(),domains.end(),[](TimeRange const& a, TimeRange const& b){ return a.begin() < b.begin(); });
+    return domains;
+  }
+
   template <class KTRAJ> void Track<KTRAJ>::createRefTraj(KTRAJ const& seedtraj ) {
     if(config_.bfcorr_ != Config::nocorr) {
+      // the first meta-iteration can use its own (coarser) domain tolerance
+      double tol = config_.schedule().front().bftol_ > 0.0 ? config_.schedule().front().bftol_ : config_.tol_;
     // find the nominal BField.  This can be fixed or variable
       VEC3 bf;
       // use the seed to set the range
       double tstart = seedtraj.range().begin();
       if(config_.bfcorr_ == Config::fixed) // fixed field: take the middle of the range
-	bf = bfield_.fieldVect(seedtraj.position3(seedtraj.range().mid()));
+	bf = fcache_.fieldVect(seedtraj.position3(seedtraj.range().mid()),seedtraj.range().mid());
       else // this will change with piece: start with the begining
-	bf = bfield_.fieldVect(seedtraj.position3(tstart));
+	bf = fcache_.fieldVect(seedtraj.position3(tstart),tstart);
 	// create the first piece
       KTRAJ newpiece(seedtraj,bf,tstart);
-      reftraj_ = PKTRAJ(newpiece);
+      reftraj_.clear();
+      reftraj_.append(newpiece);
       // divide the range up into magnetic 'domains'.  start with the full range
       double tend = tstart;
       do {
-	// see how far we can go on the current traj before the BField change causes it to go out of tolerance
-	// that defines the end of this domain
-	tend = BFieldUtils::rangeInTolerance(tstart,bfield_, reftraj_, config_.tol_);
-	// for local correction there is also tolerance coming from 2nd order terms in the rotation of the BField: this is proportional
-	// to the lever arm.
-	if(config_.localBFieldCorr()){
-	  double dx;
-	  do{
-	    auto epos = reftraj_.position3(tend);
-	    auto ebf = bfield_.fieldVect(epos);
-	    dx = epos.R()*(1.0-bf.Dot(ebf)/(bf.R()*ebf.R())); // there may be magnitude-based 2nd order terms too TODO
-	    if(dx > config_.tol_){
-	      double factor = std::min(0.9,0.9*config_.tol_/dx);
-	      // decrease the time step
-	      tend = tstart + factor*(tend-tstart);
-	    }
-	  } while(dx > config_.tol_);
-	}
+	// the last piece covers the rest of the range
+	tend = domainEnd(tstart,reftraj_.back(),bf,tol);
 	// create the BField effect for integrated differences over this range
-	effects_.emplace_back(std::make_unique<KKBFIELD>(config_,bfield_,reftraj_,TimeRange(tstart,tend)));
+	effects_.emplace_back(makeEffect<KKBFIELD>(config_,fcache_,reftraj_,TimeRange(tstart,tend)));
 	// if we're using a local BField correction, create a new piece that uses the local BField
 	if(tend < reftraj_.range().end() && config_.localBFieldCorr()) {
 	  // update the BF for the next piece: it is at the end of this one
-	  bf = bfield_.fieldVect(reftraj_.position3(tend));
+	  bf = fcache_.fieldVect(reftraj_.position3(tend),tend);
 	  // update the trajectory parameters to correspond to the same particle state but referencing the local field.
 	  // this allows the effects built on this traj to reference the correct parameterization
 	  KTRAJ newpiece(reftraj_.back(),bf,tend);
@@ -298,8 +551,85 @@ namespace KinKal {
       } while(tstart < reftraj_.range().end());
     } else {
       // use the seed BField, fixed for the whole fit
-      reftraj_ = PKTRAJ(seedtraj); // the initial ref traj is just the seed.  The nominal BField is taken from the seed
+      // the initial ref traj is just the seed.  The nominal BField is taken from the seed
+      reftraj_.clear();
+      reftraj_.append(seedtraj);
+    }
+  }
+
+  template <class KTRAJ> double Track<KTRAJ>::domainEnd(double tstart, KTRAJ const& ktraj, VEC3 const& bf, double tol) const {
+    // see how far we can go on the current traj before the BField change causes it to go out of tolerance
+    // that defines the end of this domain
+    double tend = BFieldUtils::rangeInTolerance(tstart,fcache_, ktraj, tol);
+    // for local correction there is also tolerance coming from 2nd order terms in the rotation of the BField: this is proportional
+    // to the lever arm.
+    if(config_.localBFieldCorr()){
+      double dx;
+      do{
+	auto epos = ktraj.position3(tend);
+	auto ebf = fcache_.fieldVect(epos,tend);
+	dx = epos.R()*(1.0-bf.Dot(ebf)/(bf.R()*ebf.R())); // there may be magnitude-based 2nd order terms too TODO
+	if(dx > tol){
+	  double factor = std::min(0.9,0.9*tol/dx);
+	  // decrease the time step
+	  tend = tstart + factor*(tend-tstart);
+	}
+      } while(dx > tol);
+    }
+    return tend;
+  }
+
+  template <class KTRAJ> void Track<KTRAJ>::updateDomains(double tol) {
+    // the new domains cover the same range as the existing ones, which are merged or split
+    double dbeg(std::numeric_limits<double>::max()), dend(-std::numeric_limits<double>::max());
+    for(auto const& eff : effects_) {
+      auto const* kkbf = dynamic_cast<KKBFIELD const*>(eff.get());
+      if(kkbf != 0){
+	dbeg = std::min(dbeg,kkbf->range().begin());
+	dend = std::max(dend,kkbf->range().end());
+      }
+    }
+    if(dbeg > dend)return;
+    double tbeg = std::max(reftraj_.range().begin(),dbeg);
+    double tlast = std::min(reftraj_.range().end(),dend);
+    // remove the existing BField effects
+    effects_.erase(std::remove_if(effects_.begin(),effects_.end(),
+	  [](KKEFFPTR const& eff){ return dynamic_cast<KKBFIELD const*>(eff.get()) != 0; }),effects_.end());
+    // walk the reference as in createRefTraj, extrapolating the piece at the start of each domain expressed in that domain's field.
+    // The material kinks beyond the domain start are ignored, as when the domains are first created
+    std::pmr::vector<TimeRange> domains(mres_);
+    std::pmr::vector<VEC3> bfs(mres_);
+    double tstart = tbeg;
+    VEC3 bf = reftraj_.front().bnom();
+    do {
+      if(config_.localBFieldCorr()) bf = fcache_.fieldVect(reftraj_.position3(tstart),tstart);
+      KTRAJ dtraj(reftraj_.nearestPiece(tstart),bf,tstart);
+      dtraj.range() = TimeRange(tstart,tlast);
+      double tend = domainEnd(tstart,dtraj,bf,tol);
+      domains.emplace_back(tstart,tend);
+      bfs.push_back(bf);
+      tstart = tend;
+    } while(tstart < tlast);
+    // with local correction, the reference pieces must use the field of the domain they are in: split and re-express them
+    if(config_.localBFieldCorr()){
+      PKTRAJ newref(mres_);
+      size_t idom(0);
+      for(auto const& piece : reftraj_.pieces()){
+	double tpiece = piece.range().begin();
+	while(tpiece < piece.range().end()){
+	  while(idom+1 < domains.size() && domains[idom].end() <= tpiece) idom++;
+	  double tend = idom+1 < domains.size() ? std::min(piece.range().end(),domains[idom].end()) : piece.range().end();
+	  KTRAJ newpiece(piece,bfs[idom],tpiece);
+	  newpiece.range() = TimeRange(tpiece,tend);
+	  newref.append(newpiece);
+	  tpiece = tend;
+	}
+      }
+      reftraj_ = std::move(newref);
     }
+    // create the new BField effects; these are updated with the rest of the effects
+    for(auto const& domain : domains)
+      effects_.emplace_back(makeEffect<KKBFIELD>(config_,fcache_,reftraj_,domain));
   }
 
   template <class KTRAJ> void Track<KTRAJ>::print(std::ostream& ost, int detail) const {
@@ -0,0 +1,261 @@
+#ifndef KinKal_TrackBatch_hh
+#define KinKal_TrackBatch_hh
+//
+//  Fit a batch of similar tracks (same trajectory type and configuration) in lockstep.  The tracks are swept in blocks whose fit
+//  states are stored together in structure-of-arrays layout (FitStateBatch).  Each step processes the n'th effect of every track
+//  in the block: the state inversions, the chisquared, the effect increments and the cached states are each computed for all the
+//  tracks together, so the state algebra vectorizes.  Effects which can't describe their processing as an increment are processed
+//  individually.  Tracks with fewer effects, or whose fit has failed or converged, are masked out.  The effect updates and
+//  processing are the same as for individual Tracks, and the batch inversion follows the arithmetic of FitData::invert with the
+//  configured method (Config::sqrtinv_), so the results are identical to Track fits.  Only the square-root inversion vectorizes.
+//  The tracks are constructed when added to the batch, and fit together when fit() is called.
+//
+#include "KinKal/Fit/Track.hh"
+#include "KinKal/Fit/FitStateBatch.hh"
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <array>
+#include <algorithm>
+#include <stdexcept>
+
+namespace KinKal {
+  template<class KTRAJ> class TrackBatch {
+    public:
+      using TRACK = Track<KTRAJ>;
+      using KKEFF = Effect<KTRAJ>;
+      using HITCOL = typename TRACK::HITCOL;
+      using EXINGCOL = typename TRACK::EXINGCOL;
+      TrackBatch(Config const& config, BFieldMap const& bfield) : config_(config), bfield_(bfield) {}
+      // construct a track and add it to the batch.  This throws on an invalid seed, as does the Track constructor
+      TRACK& addTrack(KTRAJ const& seedtraj, HITCOL& thits, EXINGCOL& dxings, std::pmr::memory_resource* mres=std::pmr::get_default_resource());
+      // fit all the tracks added since the last call
+      void fit();
+      // accessors
+      size_t size() const { return tracks_.size(); }
+      TRACK const& track(size_t itrk) const { return *tracks_.at(itrk); }
+      std::vector<std::unique_ptr<TRACK>> const& tracks() const { return tracks_; }
+    private:
+      // per-track state of the lockstep fit
+      struct Lane {
+	TRACK* track_;
+	Status fstat_; // status of the current iteration
+	bool live_; // still being processed in this sweep
+	Lane(TRACK& track, int miter) : track_(&track), fstat_(miter), live_(false) {}
+      };
+      static constexpr size_t nlanes_ = FitStateBatch::nlanes_;
+      using BLOCK = std::array<Lane*,nlanes_>; // lanes swept together; unused entries are null
+      using Mask = FitStateBatch::Mask;
+      void sweep(std::vector<Lane*> const& lanes, TimeDir tdir);
+      void step(BLOCK const& block, FitStateBatch& states, size_t istep, TimeDir tdir);
+      void invert(BLOCK const& block, FitStateBatch& states, Mask pmask, Mask wmask);
+      void fail(Lane& lane, std::exception const& error);
+      KKEFF& effect(Lane const& lane, size_t istep, TimeDir tdir) const {
+	auto const& effects = lane.track_->effects_;
+	return tdir == TimeDir::forwards ? *effects[istep] : *effects[effects.size()-istep-1];
+      }
+      Config const& config_;
+      BFieldMap const& bfield_;
+      std::vector<std::unique_ptr<TRACK>> tracks_;
+      size_t nfit_ = 0; // number of tracks already fit
+  };
+
+  template <class KTRAJ> typename TrackBatch<KTRAJ>::TRACK& TrackBatch<KTRAJ>::addTrack(KTRAJ const& seedtraj, HITCOL& thits, EXINGCOL& dxings,
+      std::pmr::memory_resource* mres) {
+    // own the track before adding it, so it isn't leaked if the vector can't grow.  The non-fitting constructor is private
+    std::unique_ptr<TRACK> track(new TRACK(typename TRACK::NoFit(),config_,bfield_,seedtraj,thits,dxings,mres));
+    tracks_.push_back(std::move(track));
+    return *tracks_.back();
+  }
+
+  template <class KTRAJ> void TrackBatch<KTRAJ>::fit() {
+    std::vector<Lane> lanes;
+    lanes.reserve(tracks_.size()-nfit_);
+    // execute the schedule of meta-iterations in lockstep, following Track::fit
+    for(auto imiconfig=config_.schedule().begin(); imiconfig != config_.schedule().end(); imiconfig++){
+      auto miconfig  = *imiconfig;
+      miconfig.miter_  = std::distance(config_.schedule().begin(),imiconfig);
+      if(imiconfig == config_.schedule().begin()){
+	for(size_t itrk=nfit_;itrk < tracks_.size(); itrk++) lanes.emplace_back(*tracks_[itrk],miconfig.miter_);
+      } else {
+	// drop the tracks which failed the previous meta-iteration
+	lanes.erase(std::remove_if(lanes.begin(),lanes.end(),[](Lane const& lane){ return !lane.fstat_.usable(); }),lanes.end());
+	for(auto& lane : lanes) lane.fstat_ = Status(miconfig.miter_);
+      }
+      for(auto& lane : lanes) lane.track_->history_.push_back(lane.fstat_);
+      if(config_.plevel_ >= Config::basic)std::cout << "Processing batch fit meta-iteration " << miconfig << std::endl;
+      std::vector<Lane*> active;
+      do {
+	// update the tracks which can still iterate
+	active.clear();
+	for(auto& lane : lanes) {
+	  auto& track = *lane.track_;
+	  if(!track.canIterate())continue;
+	  KINKAL_PROFILE_SCOPE(track.profile_);
+	  try {
+	    track.update(lane.fstat_,miconfig);
+	    track.startIteration(lane.fstat_);
+	    active.push_back(&lane);
+	  } catch (std::exception const& error) {
+	    fail(lane,error);
+	    track.history_.push_back(lane.fstat_);
+	  }
+	}
+	// process all the active tracks in both directions together
+	sweep(active,TimeDir::forwards);
+	sweep(active,TimeDir::backwards);
+	for(auto lane : active) {
+	  auto& track = *lane->track_;
+	  KINKAL_PROFILE_SCOPE(track.profile_);
+	  try {
+	    if(lane->live_)track.finishIteration(lane->fstat_,miconfig);
+	  } catch (std::exception const& error) {
+	    fail(*lane,error);
+	  }
+	  track.history_.push_back(lane->fstat_);
+	}
+      } while(active.size() > 0);
+    }
+    for(size_t itrk=nfit_;itrk < tracks_.size(); itrk++) {
+      auto& track = *tracks_[itrk];
+      {
+	KINKAL_PROFILE_SCOPE(track.profile_);
+	track.finishFit();
+      }
+      KINKAL_PROFILE_GLOBAL(track.profile_);
+      if(config_.plevel_ > Config::none)track.print(std::cout, config_.plevel_);
+    }
+    nfit_ = tracks_.size();
+  }
+
+  template <class KTRAJ> void TrackBatch<KTRAJ>::sweep(std::vector<Lane*> const& lanes, TimeDir tdir) {
+    for(auto lane : lanes) lane->live_ = lane->fstat_.status_ != Status::failed;
+    // sweep each block through all its effects, so that its states stay in cache
+    FitStateBatch states;
+    for(size_t ibeg=0; ibeg < lanes.size(); ibeg += nlanes_){
+      BLOCK block = {};
+      size_t nsteps(0);
+      for(size_t il=0; il < nlanes_ && ibeg+il < lanes.size(); il++){
+	block[il] = lanes[ibeg+il];
+	nsteps = std::max(nsteps,block[il]->track_->effects_.size());
+      }
+      states.reset();
+      for(size_t istep=0; istep < nsteps; istep++) step(block,states,istep,tdir);
+    }
+  }
+
+  template <class KTRAJ> void TrackBatch<KTRAJ>::step(BLOCK const& block, FitStateBatch& states, size_t istep, TimeDir tdir) {
+    // find the effects processed in this step and how they change the state
+    std::array<KKEFF*,nlanes_> effs = {};
+    std::array<StateIncrement,nlanes_> incrs;
+    Mask batched = {}, needpars = {}, needwts = {};
+    for(size_t il=0; il < nlanes_; il++){
+      auto lane = block[il];
+      if(lane == 0 || !lane->live_ || istep >= lane->track_->effects_.size())continue;
+      auto& eff = effect(*lane,istep,tdir);
+      effs[il] = &eff;
+      batched[il] = eff.increment(tdir,incrs[il]);
+      auto space = batched[il] ? incrs[il].space_ : eff.processSpace(tdir);
+      // forwards, the chisquared always needs parameters
+      needpars[il] = tdir == TimeDir::forwards || space == FitState::parameterSpace;
+      needwts[il] = (batched[il] && incrs[il].cacheBefore_) || space == FitState::weightSpace;
+    }
+    auto live = [&](size_t il) { return effs[il] != 0 && block[il]->live_; };
+    // invert the states which need it
+    invert(block,states,needpars,needwts);
+    std::array<Chisq,nlanes_> dchisq;
+    if(tdir == TimeDir::forwards){
+      for(size_t il=0; il < nlanes_; il++){
+	if(live(il)){
+	  // update chisquared increment WRT the current state: only needed forwards
+	  try {
+	    dchisq[il] = effs[il]->chisq(states.parameters(il));
+	    block[il]->fstat_.chisq_ += dchisq[il];
+	  } catch (std::exception const& error) {
+	    fail(*block[il],error);
+	  }
+	}
+      }
+    }
+    // add the increments of all the batched effects together, caching the states they need
+    FitDataLanes pincr, wincr;
+    Mask pmask = {}, wmask = {}, cmask = {};
+    for(size_t il=0; il < nlanes_; il++){
+      if(live(il) && batched[il]){
+	auto const& incr = incrs[il];
+	if(incr.cacheBefore_)effs[il]->cacheState(states.weights(il),tdir);
+	if(incr.space_ == FitState::parameterSpace){
+	  pincr.set(il,incr.data_);
+	  pmask[il] = true;
+	} else if(incr.space_ == FitState::weightSpace){
+	  wincr.set(il,incr.data_);
+	  wmask[il] = true;
+	}
+	cmask[il] = incr.cacheAfter_;
+      }
+    }
+    states.append(FitState::parameterSpace,pincr,pmask);
+    states.append(FitState::weightSpace,wincr,wmask);
+    invert(block,states,Mask{},cmask);
+    for(size_t il=0; il < nlanes_; il++){
+      if(!live(il))continue;
+      auto& eff = *effs[il];
+      KINKAL_PROFILE_SCOPE(block[il]->track_->profile_);
+      try {
+	if(batched[il]){
+	  if(incrs[il].cacheAfter_)eff.cacheState(states.weights(il),tdir);
+	  eff.setState(tdir,KKEFF::processed);
+	} else {
+	  // process the other effects individually
+	  FitState state = states.state(il,config_.invMethod());
+	  eff.process(state,tdir);
+	  states.setState(il,state);
+	}
+      } catch (std::exception const& error) {
+	fail(*block[il],error);
+      }
+      if(block[il]->live_ && tdir == TimeDir::forwards && config_.plevel_ >= Config::detailed){
+	std::cout << "Chisq total " << block[il]->fstat_.chisq_ << " increment " << dchisq[il] << " ";
+	eff.print(std::cout,config_.plevel_);
+      }
+    }
+  }
+
+  template <class KTRAJ> void TrackBatch<KTRAJ>::invert(BLOCK const& block, FitStateBatch& states, Mask pmask, Mask wmask) {
+    // a lane only ever needs one representation inverted
+    bool any(false);
+    for(size_t il=0; il < nlanes_; il++){
+      bool live = (pmask[il] || wmask[il]) && block[il]->live_;
+      pmask[il] = live && states.needsInversion(il,FitState::parameterSpace);
+      wmask[il] = live && states.needsInversion(il,FitState::weightSpace);
+      any |= pmask[il] || wmask[il];
+    }
+    if(!any)return;
+    auto failed = states.invert(pmask,wmask,config_.invMethod());
+    for(size_t il=0; il < nlanes_; il++){
+      if(!(pmask[il] || wmask[il]))continue;
+      KINKAL_PROFILE_SCOPE(block[il]->track_->profile_);
+      KINKAL_PROFILE_COUNT(FitProfile::inversions,1);
+      // if the batch inversion failed, invert the lane individually, which reports the failure
+      if(failed[il]){
+	try {
+	  FitState state = states.state(il,config_.invMethod());
+	  if(pmask[il])
+	    state.pData();
+	  else
+	    state.wData();
+	  states.setState(il,state);
+	} catch (std::exception const& error) {
+	  fail(*block[il],error);
+	}
+      }
+    }
+  }
+
+  template <class KTRAJ> void TrackBatch<KTRAJ>::fail(Lane& lane, std::exception const& error) {
+    lane.fstat_.status_ = Status::failed;
+    lane.fstat_.comment_ = error.what();
+    lane.live_ = false;
+  }
+}
+#endif
@@ -5,7 +5,7 @@
 //
 #include "KinKal/Fit/Effect.hh"
 #include "KinKal/Fit/Config.hh"
-#include "KinKal/Detector/BFieldMap.hh"
+#include "KinKal/Detector/BFieldCache.hh"
 #include <stdexcept>
 #include <limits>
 #include <ostream>
@@ -23,8 +23,15 @@ namespace KinKal {
       double time() const override { return (tdir_ == TimeDir::forwards) ? -std::numeric_limits<double>::max() : std::numeric_limits<double>::max(); } // make sure this is always at the end
       bool active() const override { return true; }
       void process(FitState& kkdata,TimeDir tdir) override;
+      FitState::Space processSpace(TimeDir tdir) const override { return tdir == tdir_ ? FitState::weightSpace : FitState::parameterSpace; }
+      // only the start of the fit is an increment; the opposite end caches the parameters
+      bool increment(TimeDir tdir, StateIncrement& incr) const override;
       void append(PKTRAJ& fit) override;
       void print(std::ostream& ost=std::cout,int detail=0) const override;
+      // the end parameters are cached when processing towards this end
+      bool hasSmoothedState() const override { return KKEFF::wasProcessed(TimeDir::forwards) && KKEFF::wasProcessed(TimeDir::backwards); }
+      SmoothedState smoothedState() const override {
+	return SmoothedState{tdir_ == TimeDir::forwards ? endtraj_.range().begin() : endtraj_.range().end(), endtraj_.params()}; }
       virtual ~TrackEnd(){}
       // accessors
       TimeDir const& tDir() const { return tdir_; }
@@ -33,14 +40,14 @@ namespace KinKal {
       Weights const& endEffect() const { return endeff_; }
 
       // construct from trajectory and direction.  Deweighting must be tuned to balance stability vs bias
-      TrackEnd(Config const& config, BFieldMap const& bfield, PKTRAJ const& pktraj,TimeDir tdir);
+      TrackEnd(Config const& config, BFieldCache const& bfield, PKTRAJ const& pktraj,TimeDir tdir);
       // disallow
       TrackEnd() = delete;
       TrackEnd(TrackEnd const& other) = delete;
       TrackEnd& operator =(TrackEnd const& other) = delete; 
     private:
       Config const& config_; // cache configuration
-      BFieldMap const& bfield_; // BField; needed to define reference
+      BFieldCache const& bfield_; // BField; needed to define reference
       TimeDir tdir_; // direction for this effect; note the early end points forwards, the late backwards
       VEC3 bnom_; // nominal BField
       double vscale_; // variance scale (from annealing)
@@ -51,27 +58,36 @@ namespace KinKal {
 
   template <class KTRAJ> double TrackEnd<KTRAJ>::tbuff_ = 1.0; // this should come from the config FIXME!
 
-  template <class KTRAJ> TrackEnd<KTRAJ>::TrackEnd(Config const& config, BFieldMap const& bfield, PKTRAJ const& pktraj, TimeDir tdir) :
+  template <class KTRAJ> TrackEnd<KTRAJ>::TrackEnd(Config const& config, BFieldCache const& bfield, PKTRAJ const& pktraj, TimeDir tdir) :
     config_(config), bfield_(bfield), tdir_(tdir) , vscale_(1.0),
     endtraj_(tdir == TimeDir::forwards ? pktraj.front() : pktraj.back()){
       update(pktraj);
     }
 
   template<class KTRAJ> void TrackEnd<KTRAJ>::process(FitState& kkdata,TimeDir tdir) {
-    if(tdir == tdir_) 
-      // start the fit with the de-weighted info cached from the previous iteration or seed
-      kkdata.append(endeff_);
-    else
+    StateIncrement incr;
+    if(increment(tdir,incr))
+      KKEFF::processIncrement(kkdata,tdir,incr);
+    else {
       // at the opposite end, cache the final parameters
-      endtraj_.params() = kkdata.pData();
-    KKEFF::setState(tdir,KKEFF::processed);
+      endtraj_.setParams(kkdata.pData());
+      KKEFF::setState(tdir,KKEFF::processed);
+    }
+  }
+
+  template<class KTRAJ> bool TrackEnd<KTRAJ>::increment(TimeDir tdir, StateIncrement& incr) const {
+    if(tdir != tdir_)return false;
+    // start the fit with the de-weighted info cached from the previous iteration or seed
+    incr.space_ = FitState::weightSpace;
+    incr.data_ = endeff_.fitData();
+    return true;
   }
 
   template<class KTRAJ> void TrackEnd<KTRAJ>::update(PKTRAJ const& ref) {
     auto refend = (tdir_ == TimeDir::forwards) ? ref.front().params() : ref.back().params();
     refend.covariance() *= (config_.dwt_/vscale_);
     // convert this to a weight (inversion)
-    endeff_ = Weights(refend);
+    endeff_ = Weights(refend,config_.invMethod());
     // set the range; this should buffer the original traj
     if(tdir_ == TimeDir::forwards){
       endtraj_.setRange(TimeRange(ref.range().begin()-tbuff_,ref.range().end()));
@@ -80,7 +96,7 @@ namespace KinKal {
     }
     // update BField reference
     double endtime = (tdir_ == TimeDir::forwards) ? ref.range().begin() : ref.range().end();
-    bnom_ = bfield_.fieldVect(ref.position3(endtime));
+    bnom_ = bfield_.fieldVect(ref.position3(endtime),endtime);
     KKEFF::updateState();
   }
 
@@ -0,0 +1,184 @@
+#ifndef KinKal_TrackFilter_hh
+#define KinKal_TrackFilter_hh
+//
+//  Low-latency single-direction Kalman filter of a track, for online (trigger) applications.  The effects are the same as for
+//  Track, but they are linearized once around the reference built from the seed, and processed in a single sweep in one direction,
+//  without smoothing or building the fit trajectory.  The result is the filtered estimate at the end of the sweep: processing forwards
+//  gives the parameters after the last measurement, backwards before the first.  Optionally, the filter can be repeated to
+//  re-linearize the effects, using as reference the filtered parameters transported through the material and BField effects.
+//  The first meta-iteration of the configuration schedule sets the effect updates (annealing temperature, TOCA precision, ...)
+//  The filter is performed on construction.
+//
+#include "KinKal/Fit/Track.hh"
+#include <memory>
+#include <memory_resource>
+#include <algorithm>
+#include <stdexcept>
+#include <ostream>
+
+namespace KinKal {
+  template<class KTRAJ> class TrackFilter {
+    public:
+      using TRACK = Track<KTRAJ>;
+      using KKEND = TrackEnd<KTRAJ>;
+      using PKTRAJ = ParticleTrajectory<KTRAJ>;
+      using HITCOL = typename TRACK::HITCOL;
+      using EXINGCOL = typename TRACK::EXINGCOL;
+      // filter the hits and material crossings in the given direction, niter times.  This throws on an invalid seed, as does Track
+      TrackFilter(Config const& config, BFieldMap const& bfield, KTRAJ const& seedtraj, HITCOL& thits, EXINGCOL& dxings,
+	  TimeDir tdir=TimeDir::forwards, unsigned niter=1, std::pmr::memory_resource* mres=std::pmr::get_default_resource());
+      // accessors
+      Status const& fitStatus() const { return track_->fitStatus(); }
+      Chisq const& chisq() const { return fitStatus().chisq_; }
+      // filtered estimate at the end of the sweep, expressed in the reference trajectory piece there
+      KTRAJ const& endTraj() const { return endEffect().endTraj(); }
+      Parameters const& parameters() const { return endTraj().params(); }
+      double time() const; // time of the last active effect processed, where the filtered estimate applies
+      TimeDir tDir() const { return tdir_; }
+      // the track holding the effects of the last iteration; it is not fit, so it has no fit trajectory
+      TRACK const& track() const { return *track_; }
+      void print(std::ostream& ost=std::cout,int detail=0) const;
+    private:
+      void filter(MetaIterConfig const& miconfig);
+      void relinearize(MetaIterConfig const& miconfig); // update the effects to the reference of the current track
+      KKEND const& endEffect() const; // end effect which caches the filtered estimate
+      PKTRAJ filteredTraj(Parameters const& seedpars) const; // filtered parameters transported through the effects that change them
+      TimeDir tdir_; // direction of processing
+      std::unique_ptr<TRACK> track_;
+  };
+
+  template <class KTRAJ> TrackFilter<KTRAJ>::TrackFilter(Config const& config, BFieldMap const& bfield, KTRAJ const& seedtraj,
+      HITCOL& thits, EXINGCOL& dxings, TimeDir tdir, unsigned niter, std::pmr::memory_resource* mres) : tdir_(tdir) {
+    if(config.schedule().size() ==0)throw std::invalid_argument("Invalid configuration: no schedule");
+    auto miconfig = config.schedule().front();
+    miconfig.miter_ = 0;
+    std::unique_ptr<TRACK> prevtrack;
+    for(unsigned iter=0; iter < std::max(niter,1u); iter++){
+      if(iter == 0)
+	track_.reset(new TRACK(typename TRACK::NoFit(),config,bfield,seedtraj,thits,dxings,mres));
+      else {
+	// re-linearize around the filtered parameters.  The reference follows the expected energy loss, so that it describes the
+	// particle at the other end of the sweep too.  The seed covariance is kept for the deweighted starting constraint
+	auto reftraj = filteredTraj(seedtraj.params());
+	auto domains = track_->domains();
+	KTRAJ seed(reftraj.nearestPiece(seedtraj.range().mid()));
+	seed.range() = seedtraj.range();
+	prevtrack = std::move(track_);
+	track_.reset(new TRACK(typename TRACK::NoFit(),config,bfield,seed,reftraj,domains,thits,dxings,mres));
+      }
+      filter(miconfig);
+      KINKAL_PROFILE_GLOBAL(track_->profile_);
+      // the reference doesn't follow the scattering, so re-linearizing can make the result worse.  In that case, keep the previous one.
+      // The activity of the hits can change, so the results are compared per degree of freedom.  The hits and crossings are shared
+      // and were updated to the rejected reference, so they are updated back to the kept one
+      if(prevtrack && (!fitStatus().usable() || chisq().chisqPerNDOF() > prevtrack->fitStatus().chisq_.chisqPerNDOF())){
+	track_ = std::move(prevtrack);
+	relinearize(miconfig);
+	break;
+      }
+      if(!fitStatus().usable())break;
+    }
+    if(config.plevel_ > Config::none)print(std::cout, config.plevel_);
+  }
+
+  template <class KTRAJ> void TrackFilter<KTRAJ>::filter(MetaIterConfig const& miconfig) {
+    auto& track = *track_;
+    KINKAL_PROFILE_SCOPE(track.profile_);
+    Status fstat(miconfig.miter_);
+    track.history_.push_back(fstat);
+    try {
+      // linearize the effects around the reference once
+      relinearize(miconfig);
+      track.startIteration(fstat);
+      // single sweep; the chisquared increments are computed WRT the state before each effect, as in the Track forward sweep
+      FitState state(track.config_.invMethod());
+      auto process = [&fstat,&state,this](auto& eff) {
+	fstat.chisq_ += eff.chisq(state.pData());
+	eff.process(state,tdir_);
+      };
+      if(tdir_ == TimeDir::forwards){
+	KINKAL_PROFILE_TIMER(FitProfile::forwardSweep);
+	for(auto feff = track.effects_.begin(); feff != track.effects_.end(); feff++) process(**feff);
+      } else {
+	KINKAL_PROFILE_TIMER(FitProfile::backwardSweep);
+	for(auto beff = track.effects_.rbegin(); beff != track.effects_.rend(); beff++) process(**beff);
+      }
+      // there is no convergence test: a single sweep with a fixed linearization is final
+      fstat.status_ = fstat.chisq_.nDOF() < track.config_.minndof_ ? Status::lowNDOF : Status::converged;
+    } catch (std::exception const& error) {
+      fstat.status_ = Status::failed;
+      fstat.comment_ = error.what();
+    }
+    track.history_.push_back(fstat);
+  }
+
+  template <class KTRAJ> void TrackFilter<KTRAJ>::relinearize(MetaIterConfig const& miconfig) {
+    auto& track = *track_;
+    for(auto& ieff : track.effects_) {
+      KINKAL_PROFILE_TIMER(track.updatePhase(*ieff));
+      ieff->update(track.reftraj_,miconfig);
+    }
+    std::sort(track.effects_.begin(),track.effects_.end(),typename TRACK::KKEFFComp());
+  }
+
+  template <class KTRAJ> typename TrackFilter<KTRAJ>::KKEND const& TrackFilter<KTRAJ>::endEffect() const {
+    // the end effect pointing opposite to the processing caches the filtered parameters.  The effects are sorted, so it's at the far end
+    auto const& effects = track_->effects();
+    auto const* kkend = dynamic_cast<KKEND const*>(tdir_ == TimeDir::forwards ? effects.back().get() : effects.front().get());
+    if(kkend == 0)throw std::runtime_error("No track end");
+    return *kkend;
+  }
+
+  template <class KTRAJ> typename TrackFilter<KTRAJ>::PKTRAJ TrackFilter<KTRAJ>::filteredTraj(Parameters const& seedpars) const {
+    auto const& reftraj = track_->refTraj();
+    // parameter changes of the material and BField effects, with the reference piece describing the parameters after each
+    struct ParChange { double time_; DVEC dpars_; KTRAJ const* ref_; };
+    std::vector<ParChange> pchanges;
+    for(auto const& eff : track_->effects()) {
+      if(!eff->active())continue;
+      auto const* kkmat = dynamic_cast<typename TRACK::KKMAT const*>(eff.get());
+      if(kkmat != 0)pchanges.push_back(ParChange{kkmat->time(),kkmat->effect().parameters(),&reftraj.nearestPiece(kkmat->time())});
+      auto const* kkbf = dynamic_cast<typename TRACK::KKBFIELD const*>(eff.get());
+      if(kkbf != 0)pchanges.push_back(ParChange{kkbf->time(),kkbf->effect().parameters(),&reftraj.nearestPiece(kkbf->range().end())});
+    }
+    // the backwards estimate is at the start; the forwards estimate is after all the changes, so undo them
+    DVEC pars = parameters().parameters();
+    if(tdir_ == TimeDir::forwards) for(auto const& pchange : pchanges) pars -= pchange.dpars_;
+    // build the trajectory forwards, appending a piece after each change
+    KTRAJ front(Parameters(pars,seedpars.covariance()),reftraj.front());
+    front.range() = reftraj.range();
+    PKTRAJ ftraj(front);
+    for(auto const& pchange : pchanges){
+      pars += pchange.dpars_;
+      if(pchange.time_ < ftraj.back().range().begin() + TimeRange::tbuff_)continue;
+      KTRAJ piece(Parameters(pars,seedpars.covariance()),*pchange.ref_);
+      piece.range() = TimeRange(pchange.time_,reftraj.range().end());
+      ftraj.append(piece);
+    }
+    return ftraj;
+  }
+
+  template <class KTRAJ> double TrackFilter<KTRAJ>::time() const {
+    // skip the end effects
+    auto const& effects = track_->effects();
+    if(tdir_ == TimeDir::forwards){
+      for(auto ieff = std::next(effects.rbegin()); ieff != effects.rend(); ieff++) if((*ieff)->active())return (*ieff)->time();
+    } else {
+      for(auto ieff = std::next(effects.begin()); ieff != effects.end(); ieff++) if((*ieff)->active())return (*ieff)->time();
+    }
+    throw std::runtime_error("No active effects");
+  }
+
+  template <class KTRAJ> void TrackFilter<KTRAJ>::print(std::ostream& ost, int detail) const {
+    // the track has no fit trajectory to print
+    ost << "Filter " << (tdir_ == TimeDir::forwards ? "forwards " : "backwards ") << fitStatus() << std::endl;
+    ost << " Filter Result ";
+    endTraj().print(ost,detail);
+    if(detail > Config::complete) {
+      ost << " Effects " << std::endl;
+      for(auto const& eff : track_->effects()) eff.get()->print(ost,detail-3);
+    }
+  }
+
+}
+#endif
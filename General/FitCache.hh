@@ -0,0 +1,105 @@
+#ifndef KinKal_FitCache_hh
+#define KinKal_FitCache_hh
+//
+//  Storage for weight-space fit data cached by effects between the fit sweeps.  When compiled with KINKAL_FLOAT_CACHE
+//  the data are stored in single precision, reducing the memory footprint of the caches by ~40%.  The sweeps,
+//  inversions and other calculations are always performed in double precision.
+//  Rounding the weight matrix elements directly to single precision adds spurious information in weakly-constrained
+//  directions, so the reduced precision storage uses the (square-root) LDL^T factorization of the equilibrated matrix,
+//  which preserves the rank and positive-definiteness of the matrix.  The vector is stored in the same factored basis
+//
+#include "KinKal/General/Vectors.hh"
+#include <array>
+#include <cmath>
+namespace KinKal {
+#ifdef KINKAL_FLOAT_CACHE
+  using CacheScalar = float;
+#else
+  using CacheScalar = double;
+#endif
+
+  template <class DATA, typename T=CacheScalar> class FitCache {
+    public:
+      FitCache() { scale_.fill(0); lfac_.fill(0); dfac_.fill(0); zvec_.fill(0); }
+      FitCache(DATA const& data) { store(data); }
+      FitCache& operator =(DATA const& data) { store(data); return *this; }
+      // accumulation is done in double precision before storing
+      FitCache& operator +=(DATA const& data) { DATA sum = get(); sum += data; store(sum); return *this; }
+      DATA get() const;
+    private:
+      void store(DATA const& data);
+      static constexpr size_t ndim_ = NParams();
+      static constexpr size_t lindex(size_t irow, size_t icol) { return irow*(irow-1)/2 + icol; } // strict lower triangle index
+      std::array<T,ndim_> scale_; // equilibration factors: inverse sqrt of the diagonal
+      std::array<T,ndim_*(ndim_-1)/2> lfac_; // unit lower-triangular factor L, below the diagonal
+      std::array<T,ndim_> dfac_; // diagonal factor D; 0 for directions without information
+      std::array<T,ndim_> zvec_; // vector in the factored basis: vec = scale*L*D*zvec
+  };
+
+  template <class DATA, typename T> void FitCache<DATA,T>::store(DATA const& data) {
+    auto const& fdata = data.fitData();
+    double scale[ndim_];
+    for(size_t idim=0;idim<ndim_;idim++){
+      double diag = fdata.mat()(idim,idim);
+      scale[idim] = diag > 0.0 ? 1.0/sqrt(diag) : 0.0;
+    }
+    // LDL^T factorization of the equilibrated matrix.  Pivots at the roundoff level signal directions without information
+    static const double mindiag(1.0e-13);
+    double lfac[ndim_][ndim_] = {}, dfac[ndim_];
+    for(size_t jdim=0;jdim<ndim_;jdim++){
+      double diag = scale[jdim] > 0.0 ? 1.0 : 0.0;
+      for(size_t kdim=0;kdim<jdim;kdim++) diag -= lfac[jdim][kdim]*lfac[jdim][kdim]*dfac[kdim];
+      dfac[jdim] = diag > mindiag ? diag : 0.0;
+      lfac[jdim][jdim] = 1.0;
+      if(dfac[jdim] > 0.0){
+	for(size_t idim=jdim+1;idim<ndim_;idim++){
+	  double sum = fdata.mat()(idim,jdim)*scale[idim]*scale[jdim];
+	  for(size_t kdim=0;kdim<jdim;kdim++) sum -= lfac[idim][kdim]*lfac[jdim][kdim]*dfac[kdim];
+	  lfac[idim][jdim] = sum/dfac[jdim];
+	}
+      }
+    }
+    // express the (equilibrated) vector in the factored basis: solve L*w = vec, then z = w/D
+    double wvec[ndim_];
+    for(size_t idim=0;idim<ndim_;idim++){
+      wvec[idim] = fdata.vec()[idim]*scale[idim];
+      for(size_t kdim=0;kdim<idim;kdim++) wvec[idim] -= lfac[idim][kdim]*wvec[kdim];
+    }
+    for(size_t idim=0;idim<ndim_;idim++){
+      scale_[idim] = scale[idim];
+      dfac_[idim] = dfac[idim];
+      zvec_[idim] = dfac[idim] > 0.0 ? wvec[idim]/dfac[idim] : 0.0;
+      for(size_t jdim=0;jdim<idim;jdim++) lfac_[lindex(idim,jdim)] = lfac[idim][jdim];
+    }
+  }
+
+  template <class DATA, typename T> DATA FitCache<DATA,T>::get() const {
+    auto lval = [this](size_t irow, size_t icol) -> double { return irow == icol ? 1.0 : (irow > icol ? lfac_[lindex(irow,icol)] : 0.0); };
+    DVEC vec;
+    DMAT mat;
+    for(size_t irow=0;irow<ndim_;irow++){
+      double vsum(0.0);
+      for(size_t kdim=0;kdim<=irow;kdim++) vsum += lval(irow,kdim)*dfac_[kdim]*zvec_[kdim];
+      vec[irow] = vsum/(scale_[irow] > 0.0 ? scale_[irow] : 1.0);
+      for(size_t icol=0;icol<=irow;icol++){
+	double msum(0.0);
+	for(size_t kdim=0;kdim<=icol;kdim++) msum += lval(irow,kdim)*dfac_[kdim]*lval(icol,kdim);
+	mat(irow,icol) = scale_[irow] > 0.0 && scale_[icol] > 0.0 ? msum/(double(scale_[irow])*double(scale_[icol])) : 0.0;
+      }
+    }
+    return DATA(vec,mat);
+  }
+
+  // double precision: store the data directly
+  template <class DATA> class FitCache<DATA,double> {
+    public:
+      FitCache() {}
+      FitCache(DATA const& data) : data_(data) {}
+      FitCache& operator =(DATA const& data) { data_ = data; return *this; }
+      FitCache& operator +=(DATA const& data) { data_ += data; return *this; }
+      DATA const& get() const { return data_; }
+    private:
+      DATA data_;
+  };
+}
+#endif
@@ -0,0 +1,47 @@
+#include "KinKal/General/FitData.hh"
+#include <array>
+#include <cmath>
+namespace KinKal {
+  void FitData::invertCholesky() {
+    KINKAL_PROFILE_COUNT(FitProfile::inversions,1);
+    constexpr size_t ndim = NParams();
+    // equilibrate: scale the matrix to unit diagonal, so that the factorization isn't limited by the relative scale of the parameters
+    std::array<double,ndim> scale;
+    for(size_t idim=0;idim<ndim;idim++){
+      if(!(mat_(idim,idim) > 0.0))throw std::runtime_error("Inversion failure");
+      scale[idim] = 1.0/sqrt(mat_(idim,idim));
+    }
+    // factorize the scaled matrix as L*L^T
+    double lfac[ndim][ndim] = {};
+    for(size_t jdim=0;jdim<ndim;jdim++){
+      double diag = 1.0;
+      for(size_t kdim=0;kdim<jdim;kdim++) diag -= lfac[jdim][kdim]*lfac[jdim][kdim];
+      if(!(diag > 0.0))throw std::runtime_error("Inversion failure"); // not positive-definite
+      lfac[jdim][jdim] = sqrt(diag);
+      for(size_t idim=jdim+1;idim<ndim;idim++){
+	double sum = mat_(idim,jdim)*scale[idim]*scale[jdim];
+	for(size_t kdim=0;kdim<jdim;kdim++) sum -= lfac[idim][kdim]*lfac[jdim][kdim];
+	lfac[idim][jdim] = sum/lfac[jdim][jdim];
+      }
+    }
+    // invert the (lower-triangular) factor
+    double linv[ndim][ndim] = {};
+    for(size_t idim=0;idim<ndim;idim++){
+      linv[idim][idim] = 1.0/lfac[idim][idim];
+      for(size_t jdim=0;jdim<idim;jdim++){
+	double sum(0.0);
+	for(size_t kdim=jdim;kdim<idim;kdim++) sum -= lfac[idim][kdim]*linv[kdim][jdim];
+	linv[idim][jdim] = sum*linv[idim][idim];
+      }
+    }
+    // the inverse is L^-T*L^-1, undoing the equilibration
+    for(size_t idim=0;idim<ndim;idim++){
+      for(size_t jdim=0;jdim<=idim;jdim++){
+	double sum(0.0);
+	for(size_t kdim=idim;kdim<ndim;kdim++) sum += linv[kdim][idim]*linv[kdim][jdim];
+	mat_(idim,jdim) = sum*scale[idim]*scale[jdim];
+      }
+    }
+    vec_ = mat_*vec_;
+  }
+}
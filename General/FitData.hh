@@ -8,17 +8,21 @@
 #include "Math/SVector.h"
 #include "Math/SMatrix.h"
 #include "KinKal/General/Vectors.hh"
+#include "KinKal/General/FitProfile.hh"
 #include <stdexcept>
 
 namespace KinKal {
   class FitData {
     public:
+      // matrix inversion algorithm.  The Cholesky (square-root) factorization of the equilibrated matrix is robust against
+      // badly-scaled matrices, such as the de-weighted fit ends, but requires the matrix be positive-definite
+      enum InvMethod {direct=0, cholesky};
       // construct from vector and matrix
       FitData(DVEC const& vec, DMAT const& mat) : vec_(vec), mat_(mat) {}
       FitData(DVEC const& vec) : vec_(vec)  {}
       FitData() {}
       // copy with optional inversion
-      FitData(FitData const& tdata, bool inv=false) : vec_(tdata.vec_), mat_(tdata.mat_) { if (inv) invert(); }
+      FitData(FitData const& tdata, bool inv=false, InvMethod method=direct) : vec_(tdata.vec_), mat_(tdata.mat_) { if (inv) invert(method); }
       // accessors
       DVEC const& vec() const { return vec_; }
       DMAT const& mat() const { return mat_; }
@@ -28,8 +32,10 @@ namespace KinKal {
       void scale(double sfac) { mat_ *= sfac; }
       // inversion changes from params <-> weight. 
       // Invert in-place
-      void invert() {
+      void invert(InvMethod method=direct) {
+	if(method == cholesky)return invertCholesky();
 	// first invert the matrix
+	KINKAL_PROFILE_COUNT(FitProfile::inversions,1);
 	if(mat_.Invert()){
 	  vec_ = mat_*vec_;
 	} else {
@@ -39,6 +45,7 @@ namespace KinKal {
    if(std::isnan(mat_(0,0)))throw std::runtime_error("Inversion failure");
 
       }
+      void invertCholesky();
      // append
       FitData & operator -= (FitData const& other) {
 	vec_ -= other.vec();
@@ -0,0 +1,151 @@
+#include "KinKal/General/FitDataBatch.hh"
+#include <cmath>
+namespace KinKal {
+  void FitDataLanes::set(size_t lane, FitData const& fdata) {
+    for(size_t irow=0;irow<ndim_;irow++){
+      vec_[irow][lane] = fdata.vec()[irow];
+      for(size_t icol=0;icol<=irow;icol++) mat_[mindex(irow,icol)][lane] = fdata.mat()(irow,icol);
+    }
+  }
+
+  void FitDataLanes::get(size_t lane, FitData& fdata) const {
+    for(size_t irow=0;irow<ndim_;irow++){
+      fdata.vec()[irow] = vec_[irow][lane];
+      for(size_t icol=0;icol<=irow;icol++) fdata.mat()(irow,icol) = mat_[mindex(irow,icol)][lane];
+    }
+  }
+
+  void FitDataLanes::zero() {
+    for(size_t imat=0;imat<nmat_;imat++)
+      for(size_t lane=0;lane<nlanes_;lane++) mat_[imat][lane] = 0.0;
+    for(size_t idim=0;idim<ndim_;idim++)
+      for(size_t lane=0;lane<nlanes_;lane++) vec_[idim][lane] = 0.0;
+  }
+
+  // masks are converted to floating-point selectors of the same width as the data, so that selections vectorize
+  namespace {
+    void selector(FitDataLanes::Mask const& mask, double* sel) {
+      for(size_t lane=0;lane<FitDataLanes::nlanes_;lane++) sel[lane] = mask[lane] ? 1.0 : 0.0;
+    }
+  }
+
+  void FitDataLanes::select(FitDataLanes const& first, FitDataLanes const& second, Mask const& mask) {
+    alignas(64) double sel[nlanes_];
+    selector(mask,sel);
+    for(size_t imat=0;imat<nmat_;imat++)
+      for(size_t lane=0;lane<nlanes_;lane++) mat_[imat][lane] = sel[lane] > 0.0 ? first.mat_[imat][lane] : second.mat_[imat][lane];
+    for(size_t idim=0;idim<ndim_;idim++)
+      for(size_t lane=0;lane<nlanes_;lane++) vec_[idim][lane] = sel[lane] > 0.0 ? first.vec_[idim][lane] : second.vec_[idim][lane];
+  }
+
+  void FitDataLanes::add(FitDataLanes const& other, Mask const& mask) {
+    // scale rather than branch, so the loops vectorize
+    alignas(64) double scale[nlanes_];
+    selector(mask,scale);
+    for(size_t imat=0;imat<nmat_;imat++)
+      for(size_t lane=0;lane<nlanes_;lane++) mat_[imat][lane] += scale[lane]*other.mat_[imat][lane];
+    for(size_t idim=0;idim<ndim_;idim++)
+      for(size_t lane=0;lane<nlanes_;lane++) vec_[idim][lane] += scale[lane]*other.vec_[idim][lane];
+  }
+
+  FitDataLanes::Mask FitDataLanes::invert(FitDataLanes& inverse, Mask const& mask) const {
+    // replace the unselected lanes by the identity, so that all lanes can be processed together
+    alignas(64) double sel[nlanes_];
+    selector(mask,sel);
+    alignas(64) double mat[nmat_][nlanes_], vec[ndim_][nlanes_];
+    for(size_t irow=0;irow<ndim_;irow++){
+      for(size_t lane=0;lane<nlanes_;lane++) vec[irow][lane] = sel[lane] > 0.0 ? vec_[irow][lane] : 0.0;
+      for(size_t icol=0;icol<=irow;icol++){
+	double ident = irow == icol ? 1.0 : 0.0;
+	for(size_t lane=0;lane<nlanes_;lane++) mat[mindex(irow,icol)][lane] = sel[lane] > 0.0 ? mat_[mindex(irow,icol)][lane] : ident;
+      }
+    }
+    // failures are flagged per lane and the lane replaced by the identity, which keeps the arithmetic finite.
+    // The loops are branch-free over the lanes (innermost) so they vectorize, except for the square roots
+    alignas(64) double fail[nlanes_] = {};
+    alignas(64) double scale[ndim_][nlanes_];
+    for(size_t idim=0;idim<ndim_;idim++){
+      for(size_t lane=0;lane<nlanes_;lane++){
+	double diag = mat[mindex(idim,idim)][lane];
+	fail[lane] = diag > 0.0 ? fail[lane] : 1.0;
+	scale[idim][lane] = diag > 0.0 ? diag : 1.0;
+      }
+      for(size_t lane=0;lane<nlanes_;lane++) scale[idim][lane] = sqrt(scale[idim][lane]);
+      for(size_t lane=0;lane<nlanes_;lane++) scale[idim][lane] = 1.0/scale[idim][lane];
+    }
+    // factorize the equilibrated matrix as L*L^T.  The arithmetic follows FitData::invertCholesky, so that the results are identical
+    alignas(64) double lfac[nmat_][nlanes_];
+    alignas(64) double sum[nlanes_];
+    for(size_t jdim=0;jdim<ndim_;jdim++){
+      for(size_t lane=0;lane<nlanes_;lane++) sum[lane] = 1.0;
+      for(size_t kdim=0;kdim<jdim;kdim++)
+	for(size_t lane=0;lane<nlanes_;lane++) sum[lane] -= lfac[mindex(jdim,kdim)][lane]*lfac[mindex(jdim,kdim)][lane];
+      for(size_t lane=0;lane<nlanes_;lane++){
+	fail[lane] = sum[lane] > 0.0 ? fail[lane] : 1.0;
+	sum[lane] = sum[lane] > 0.0 ? sum[lane] : 1.0;
+      }
+      for(size_t lane=0;lane<nlanes_;lane++) lfac[mindex(jdim,jdim)][lane] = sqrt(sum[lane]);
+      for(size_t idim=jdim+1;idim<ndim_;idim++){
+	for(size_t lane=0;lane<nlanes_;lane++) sum[lane] = mat[mindex(idim,jdim)][lane]*scale[idim][lane]*scale[jdim][lane];
+	for(size_t kdim=0;kdim<jdim;kdim++)
+	  for(size_t lane=0;lane<nlanes_;lane++) sum[lane] -= lfac[mindex(idim,kdim)][lane]*lfac[mindex(jdim,kdim)][lane];
+	for(size_t lane=0;lane<nlanes_;lane++) lfac[mindex(idim,jdim)][lane] = sum[lane]/lfac[mindex(jdim,jdim)][lane];
+      }
+    }
+    // invert the (lower-triangular) factor
+    alignas(64) double linv[nmat_][nlanes_];
+    for(size_t idim=0;idim<ndim_;idim++){
+      for(size_t lane=0;lane<nlanes_;lane++) linv[mindex(idim,idim)][lane] = 1.0/lfac[mindex(idim,idim)][lane];
+      for(size_t jdim=0;jdim<idim;jdim++){
+	for(size_t lane=0;lane<nlanes_;lane++) sum[lane] = 0.0;
+	for(size_t kdim=jdim;kdim<idim;kdim++)
+	  for(size_t lane=0;lane<nlanes_;lane++) sum[lane] -= lfac[mindex(idim,kdim)][lane]*linv[mindex(kdim,jdim)][lane];
+	for(size_t lane=0;lane<nlanes_;lane++) linv[mindex(idim,jdim)][lane] = sum[lane]*linv[mindex(idim,idim)][lane];
+      }
+    }
+    // the inverse is L^-T*L^-1, undoing the equilibration
+    for(size_t idim=0;idim<ndim_;idim++){
+      for(size_t jdim=0;jdim<=idim;jdim++){
+	for(size_t lane=0;lane<nlanes_;lane++) sum[lane] = 0.0;
+	for(size_t kdim=idim;kdim<ndim_;kdim++)
+	  for(size_t lane=0;lane<nlanes_;lane++) sum[lane] += linv[mindex(kdim,idim)][lane]*linv[mindex(kdim,jdim)][lane];
+	for(size_t lane=0;lane<nlanes_;lane++) mat[mindex(idim,jdim)][lane] = sum[lane]*scale[idim][lane]*scale[jdim][lane];
+      }
+    }
+    // transform the vector with the (symmetric) inverse
+    alignas(64) double ivec[ndim_][nlanes_];
+    for(size_t irow=0;irow<ndim_;irow++){
+      for(size_t lane=0;lane<nlanes_;lane++) ivec[irow][lane] = 0.0;
+      for(size_t icol=0;icol<ndim_;icol++){
+	size_t index = irow >= icol ? mindex(irow,icol) : mindex(icol,irow);
+	for(size_t lane=0;lane<nlanes_;lane++) ivec[irow][lane] += mat[index][lane]*vec[icol][lane];
+      }
+    }
+    // only the successfully inverted lanes are written
+    Mask failed;
+    for(size_t lane=0;lane<nlanes_;lane++){
+      failed[lane] = mask[lane] && fail[lane] > 0.0;
+      sel[lane] = failed[lane] ? 0.0 : sel[lane];
+    }
+    for(size_t imat=0;imat<nmat_;imat++)
+      for(size_t lane=0;lane<nlanes_;lane++) inverse.mat_[imat][lane] = sel[lane] > 0.0 ? mat[imat][lane] : inverse.mat_[imat][lane];
+    for(size_t idim=0;idim<ndim_;idim++)
+      for(size_t lane=0;lane<nlanes_;lane++) inverse.vec_[idim][lane] = sel[lane] > 0.0 ? ivec[idim][lane] : inverse.vec_[idim][lane];
+    return failed;
+  }
+
+  FitDataLanes::Mask FitDataLanes::invertDirect(FitDataLanes& inverse, Mask const& mask) const {
+    Mask failed = {};
+    for(size_t lane=0;lane<nlanes_;lane++){
+      if(!mask[lane])continue;
+      FitData fdata;
+      get(lane,fdata);
+      if(fdata.mat().Invert() && !std::isnan(fdata.mat()(0,0))){
+	fdata.vec() = fdata.mat()*fdata.vec();
+	inverse.set(lane,fdata);
+      } else
+	failed[lane] = true;
+    }
+    return failed;
+  }
+}
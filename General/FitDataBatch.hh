@@ -0,0 +1,35 @@
+#ifndef KinKal_FitDataBatch_hh
+#define KinKal_FitDataBatch_hh
+//
+//  FitData of a batch of tracks stored in structure-of-arrays layout (the lane, ie the track, is the fastest index), so that the
+//  operations on all the lanes vectorize.  The inversion uses the same equilibrated Cholesky factorization as FitData::invertCholesky.
+//  Lanes whose matrix isn't positive-definite are flagged rather than throwing, so that one bad track doesn't affect the others
+//
+#include "KinKal/General/FitData.hh"
+#include <array>
+namespace KinKal {
+  // the data of a fixed number of lanes.  Operations act on the lanes selected by a mask, leaving the others unchanged
+  struct FitDataLanes {
+    static constexpr size_t nlanes_ = 8; // lanes per batch
+    static constexpr size_t ndim_ = NParams();
+    static constexpr size_t nmat_ = ndim_*(ndim_+1)/2;
+    static constexpr size_t mindex(size_t irow, size_t icol) { return irow*(irow+1)/2 + icol; } // lower triangle index (irow>=icol)
+    using Mask = std::array<bool,nlanes_>;
+    alignas(64) double mat_[nmat_][nlanes_]; // symmetric matrix, lower triangle
+    alignas(64) double vec_[ndim_][nlanes_];
+    void set(size_t lane, FitData const& fdata);
+    void get(size_t lane, FitData& fdata) const;
+    void zero(); // zero all lanes
+    // set each lane from one of 2 objects: the selected lanes from the first, the others from the second
+    void select(FitDataLanes const& first, FitDataLanes const& second, Mask const& mask);
+    // copy or add the selected lanes of another object
+    void copy(FitDataLanes const& other, Mask const& mask) { select(other,*this,mask); }
+    void add(FitDataLanes const& other, Mask const& mask);
+    // invert the selected lanes into inverse (which may be this object), returning the lanes whose inversion failed.
+    // Failed lanes of the inverse are left unchanged
+    Mask invert(FitDataLanes& inverse, Mask const& mask) const;
+    // as above, using the direct inversion of FitData::invert lane by lane, so that the results are identical to it
+    Mask invertDirect(FitDataLanes& inverse, Mask const& mask) const;
+  };
+}
+#endif
@@ -0,0 +1,77 @@
+#include "KinKal/General/FitProfile.hh"
+#include <mutex>
+#include <vector>
+namespace KinKal {
+  namespace {
+    std::mutex globalMutex_;
+    FitProfile globalProfile_;
+  }
+
+  FitProfile& FitProfile::operator +=(FitProfile const& other) {
+    for(size_t iphase=0; iphase < nphases; iphase++){
+      time_[iphase] += other.time_[iphase];
+      calls_[iphase] += other.calls_[iphase];
+    }
+    for(size_t icount=0; icount < ncounters; icount++)
+      counts_[icount] += other.counts_[icount];
+    for(size_t ibin=0; ibin < ntcabins; ibin++)
+      tcahist_[ibin] += other.tcahist_[ibin];
+    return *this;
+  }
+
+  std::string const& FitProfile::phaseName(Phase phase) {
+    static const std::vector<std::string> phaseNames_ = { "CreateRefTraj", "HitUpdate", "MaterialUpdate", "BFieldUpdate",
+      "EndUpdate", "ForwardSweep", "BackwardSweep", "Rebuild", "Unknown" };
+    return phaseNames_[std::min(phase,nphases)];
+  }
+
+  std::string const& FitProfile::counterName(Counter counter) {
+    static const std::vector<std::string> counterNames_ = { "TCAIterations", "TCAUnconverged", "BFieldQueries", "Inversions", "Unknown" };
+    return counterNames_[std::min(counter,ncounters)];
+  }
+
+  void FitProfile::fillTCA(unsigned niter, bool converged) {
+    if(auto profile = current()){
+      profile->counts_[tcaIterations] += niter;
+      if(!converged)profile->counts_[tcaUnconverged]++;
+      profile->tcahist_[std::min(size_t(niter),ntcabins-1)]++;
+    }
+  }
+
+  FitProfile FitProfile::global() {
+    std::lock_guard<std::mutex> lock(globalMutex_);
+    return globalProfile_;
+  }
+
+  void FitProfile::addGlobal(FitProfile const& profile) {
+    std::lock_guard<std::mutex> lock(globalMutex_);
+    globalProfile_ += profile;
+  }
+
+  void FitProfile::resetGlobal() {
+    std::lock_guard<std::mutex> lock(globalMutex_);
+    globalProfile_.reset();
+  }
+
+  FitProfile*& FitProfile::current() {
+    static thread_local FitProfile* current(0);
+    return current;
+  }
+
+  std::ostream& operator <<(std::ostream& ost, FitProfile const& profile) {
+    ost << "Fit Profile" << std::endl;
+    for(size_t iphase=0; iphase < FitProfile::nphases; iphase++){
+      auto phase = static_cast<FitProfile::Phase>(iphase);
+      ost << " " << FitProfile::phaseName(phase) << " calls " << profile.calls(phase) << " time " << profile.time(phase) << " ns" << std::endl;
+    }
+    for(size_t icount=0; icount < FitProfile::ncounters; icount++){
+      auto counter = static_cast<FitProfile::Counter>(icount);
+      ost << " " << FitProfile::counterName(counter) << " " << profile.count(counter) << std::endl;
+    }
+    ost << " TCA calls by iterations";
+    for(size_t ibin=0; ibin < FitProfile::ntcabins; ibin++)
+      ost << " " << ibin << (ibin+1 == FitProfile::ntcabins ? "+:" : ":") << profile.tcaCalls(ibin);
+    ost << std::endl;
+    return ost;
+  }
+}
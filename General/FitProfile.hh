@@ -0,0 +1,90 @@
+#ifndef KinKal_FitProfile_hh
+#define KinKal_FitProfile_hh
+//
+//  Optional instrumentation of the fit: time and call counts of the fit phases, and counts of low-level operations
+//  (TCA iterations, BField queries, matrix inversions), and a histogram of the number of iterations of each TCA calculation.  The instrumentation is only compiled in when KINKAL_PROFILE
+//  is defined (cmake -DKINKAL_PROFILE=ON); otherwise the macros below expand to nothing and have no cost.
+//  Each Track accumulates its own profile, which is also added to a global (thread-safe) total.
+//
+#include <array>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <ostream>
+
+namespace KinKal {
+  struct FitProfile {
+    enum Phase {createRefTraj=0, hitUpdate, materialUpdate, bfieldUpdate, endUpdate, forwardSweep, backwardSweep, rebuild, nphases};
+    enum Counter {tcaIterations=0, tcaUnconverged, bfieldQueries, inversions, ncounters};
+    static constexpr size_t ntcabins = 16; // the last bin counts all TCA calculations with more iterations
+    std::array<double,nphases> time_ = {}; // accumulated time for each phase (ns)
+    std::array<unsigned long,nphases> calls_ = {}; // number of times each phase was executed
+    std::array<unsigned long,ncounters> counts_ = {}; // number of low-level operations
+    std::array<unsigned long,ntcabins> tcahist_ = {}; // number of TCA calculations binned by their number of iterations
+    double time(Phase phase) const { return time_[phase]; }
+    unsigned long calls(Phase phase) const { return calls_[phase]; }
+    unsigned long count(Counter counter) const { return counts_[counter]; }
+    unsigned long tcaCalls(size_t niter) const { return tcahist_[std::min(niter,ntcabins-1)]; }
+    void reset() { *this = FitProfile(); }
+    FitProfile& operator +=(FitProfile const& other);
+    static std::string const& phaseName(Phase phase);
+    static std::string const& counterName(Counter counter);
+    // global totals, summed over all profiled fits since the last reset
+    static FitProfile global();
+    static void addGlobal(FitProfile const& profile);
+    static void resetGlobal();
+    // profile being accumulated in the current thread; null if none
+    static FitProfile*& current();
+    static void increment(Counter counter, unsigned long nops=1) { if(current() != 0)current()->counts_[counter] += nops; }
+    static void fillTCA(unsigned niter, bool converged);
+  };
+
+  // set the current thread's profile for the duration of a scope
+  class FitProfileScope {
+    public:
+      FitProfileScope(FitProfile& profile) : previous_(FitProfile::current()) { FitProfile::current() = &profile; }
+      ~FitProfileScope() { FitProfile::current() = previous_; }
+      FitProfileScope(FitProfileScope const& ) = delete;
+      FitProfileScope& operator =(FitProfileScope const& ) = delete;
+    private:
+      FitProfile* previous_;
+  };
+
+  // time a phase for the duration of a scope, adding the result to the current profile
+  class FitProfileTimer {
+    public:
+      using Clock = std::chrono::steady_clock;
+      FitProfileTimer(FitProfile::Phase phase) : phase_(phase), start_(Clock::now()) {}
+      ~FitProfileTimer() {
+	if(auto profile = FitProfile::current()){
+	  profile->time_[phase_] += std::chrono::duration<double,std::nano>(Clock::now()-start_).count();
+	  profile->calls_[phase_]++;
+	}
+      }
+      FitProfileTimer(FitProfileTimer const& ) = delete;
+      FitProfileTimer& operator =(FitProfileTimer const& ) = delete;
+    private:
+      FitProfile::Phase phase_;
+      Clock::time_point start_;
+  };
+
+  std::ostream& operator <<(std::ostream& ost, FitProfile const& profile);
+}
+
+#ifdef KINKAL_PROFILE
+#define KINKAL_PROFILE_CAT_(a,b) a##b
+#define KINKAL_PROFILE_CAT(a,b) KINKAL_PROFILE_CAT_(a,b)
+#define KINKAL_PROFILE_SCOPE(profile) KinKal::FitProfileScope KINKAL_PROFILE_CAT(kkprofscope_,__LINE__)(profile)
+#define KINKAL_PROFILE_TIMER(phase) KinKal::FitProfileTimer KINKAL_PROFILE_CAT(kkproftimer_,__LINE__)(phase)
+#define KINKAL_PROFILE_COUNT(counter,nops) KinKal::FitProfile::increment(counter,nops)
+#define KINKAL_PROFILE_TCA(niter,converged) KinKal::FitProfile::fillTCA(niter,converged)
+#define KINKAL_PROFILE_GLOBAL(profile) KinKal::FitProfile::addGlobal(profile)
+#else
+#define KINKAL_PROFILE_SCOPE(profile)
+#define KINKAL_PROFILE_TIMER(phase)
+#define KINKAL_PROFILE_COUNT(counter,nops)
+#define KINKAL_PROFILE_TCA(niter,converged)
+#define KINKAL_PROFILE_GLOBAL(profile)
+#endif
+
+#endif
@@ -2,7 +2,7 @@
 #include "KinKal/General/Weights.hh"
 #include <stdexcept>
 namespace KinKal {
-  Parameters::Parameters(Weights const& wdata) : fitdata_(wdata.fitData(),true) {}
+  Parameters::Parameters(Weights const& wdata, FitData::InvMethod method) : fitdata_(wdata.fitData(),true,method) {}
 
   double Parameters::delta(Parameters const& other) const {
     // difference of the parameter
@@ -10,6 +10,7 @@ namespace KinKal {
     // sum the covariances
     DMAT csum = covariance() + other.covariance();
     // invert and contract
+    KINKAL_PROFILE_COUNT(FitProfile::inversions,1);
     if(!csum.Invert())throw std::runtime_error("Inversion failure");
     double retval = ROOT::Math::Similarity(pdiff,csum);
     return retval;
@@ -13,7 +13,7 @@ namespace KinKal {
       // construct from vector and matrix
       Parameters(DVEC const& pars, DMAT const& pcov) : fitdata_(pars,pcov) {}
       Parameters(DVEC const& pars) : fitdata_(pars) {}
-      Parameters(Weights const& wdata);
+      Parameters(Weights const& wdata, FitData::InvMethod method=FitData::direct);
       Parameters() {}
       // accessors; just re-interpret the base class accessors
       DVEC const& parameters() const { return fitdata_.vec(); }
@@ -1,7 +1,7 @@
 #include "KinKal/General/Weights.hh"
 #include "KinKal/General/Parameters.hh"
 namespace KinKal {
-  Weights::Weights(Parameters const& pdata) : fitdata_(pdata.fitData(),true) {}
+  Weights::Weights(Parameters const& pdata, FitData::InvMethod method) : fitdata_(pdata.fitData(),true,method) {}
   std::ostream& operator << (std::ostream& ost, Weights const& wdata) {
     wdata.print(ost,0);
     return ost;
@@ -13,7 +13,7 @@ namespace KinKal {
       // construct from vector and matrix
       Weights(DVEC const& wvec, DMAT const& wmat) : fitdata_(wvec,wmat) {}
       Weights(DVEC const& wvec) : fitdata_(wvec) {}
-      Weights(Parameters const& pdata);
+      Weights(Parameters const& pdata, FitData::InvMethod method=FitData::direct);
       Weights() {}
       // accessors; just re-interpret the base class accessors
       DVEC const& weightVec() const { return fitdata_.vec(); }
@@ -145,7 +145,7 @@ int BFieldMapTest(int argc, char **argv) {
     auto dpfrac = dp/mom.R();
     DVEC dpars = dpfrac.Dot(t1hat)*dpdt1 + dpfrac.Dot(t2hat)*dpdt2;
     KTRAJ lnew = lptraj.back();
-    lnew.params() += dpars;
+    lnew.setParameters(lnew.params().parameters() + dpars);
     lnew.setRange(prange);
     lptraj.append(lnew);
     gap = xptraj.gap(xptraj.pieces().size()-1);
@@ -161,6 +161,15 @@ int BFieldMapTest(int argc, char **argv) {
   cout << "XTraj " << xptraj << " integral " << xdp << endl;
   cout << "LTraj " << lptraj << " integral " << ldp << endl;
   cout << "Nominal " << start << " integral " << ndp << endl;
+  // test the caching decorator: repeating the same integral must be answered from the cache, with the same result
+  CachedBFieldMap cbf(*BF,1.0e-6,32);
+  VEC3 cdp1 = BFieldUtils::integrate(cbf, tptraj, tptraj.range());
+  VEC3 cdp2 = BFieldUtils::integrate(cbf, tptraj, tptraj.range());
+  cout << cbf.stats() << endl;
+  if((cdp1-tdp).R() > 1e-10 || (cdp2-tdp).R() > 1e-10 || cbf.stats().vecthits_ == 0 || 2*cbf.stats().vecthits_ != cbf.stats().nvect_){
+    cout << "CachedBFieldMap failure: integrals " << tdp << " " << cdp1 << " " << cdp2 << endl;
+    return -1;
+  }
 
 // setup histograms
   TFile tpfile((KTRAJ::trajName()+"BFieldMap.root").c_str(),"RECREATE");
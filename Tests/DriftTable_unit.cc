@@ -0,0 +1,179 @@
+//
+// test DriftTable interpolation against a nonlinear, angle-dependent reference drift model.  The cubic Hermite interpolation in
+// distance should reproduce the drift time with 4th order accuracy in the grid spacing (3rd order for the speed), and the linear
+// interpolation in angle (and of the variance) with 2nd order accuracy.  Beyond the table, angles are clamped and distances
+// extrapolated linearly
+//
+#include "KinKal/Detector/DriftTable.hh"
+
+#include <iostream>
+#include <stdio.h>
+#include <cmath>
+#include <getopt.h>
+
+using namespace KinKal;
+using namespace std;
+
+void print_usage() {
+  printf("Usage: DriftTable --nr i --nphi i --rmax f\n");
+}
+
+// reference model: the drift speed decreases with distance, faster on one side of the ExB direction.  This is not
+// polynomial in distance, so the cubic interpolation isn't exact
+struct DriftModel {
+  double vdrift_ = 0.065; // drift speed at the wire (mm/ns)
+  double slow_ = 4.0; // slowing of the drift away from the wire (ns/mm^2)
+  double asym_ = 0.5; // angular asymmetry of the slowing
+  double sigt0_ = 2.0, sigt1_ = 0.5; // time resolution at the wire (ns) and its growth with distance (ns/mm)
+  void operator()(POL2 const& drift, DriftInfo& dinfo) const {
+    double rval = drift.R();
+    double slow = slow_*(1.0 + asym_*sin(drift.Phi()));
+    dinfo.tdrift_ = rval/vdrift_ + slow*rval*rval*rval/(1.0+rval);
+    double dtdr = 1.0/vdrift_ + slow*rval*rval*(2.0*rval+3.0)/((1.0+rval)*(1.0+rval));
+    dinfo.vdrift_ = 1.0/dtdr;
+    double sigt = sigt0_ + sigt1_*rval;
+    dinfo.tdriftvar_ = sigt*sigt;
+  }
+};
+
+// largest differences between the table and the model, over distances between the grid points, at the tabulated angles
+struct DriftDiff {
+  double dtime_ = 0.0, dspeed_ = 0.0, dvar_ = 0.0; // absolute time difference, relative speed and variance differences
+};
+
+DriftDiff distanceDiff(DriftTable const& dtable, DriftModel const& model) {
+  DriftDiff diff;
+  double dphi = dtable.nAngle() > 1 ? M_PI/(dtable.nAngle()-1) : 0.0;
+  double dr = dtable.maxDistance()/(dtable.nDistance()-1);
+  for(size_t iphi=0; iphi < dtable.nAngle(); iphi++){
+    double phi = -M_PI_2 + iphi*dphi;
+    for(double rval = 0.0; rval < dtable.maxDistance(); rval += 0.0731*dr){
+      DriftInfo tinfo, minfo;
+      POL2 drift(rval,phi);
+      dtable.distanceToTime(drift,tinfo);
+      model(drift,minfo);
+      diff.dtime_ = std::max(diff.dtime_,fabs(tinfo.tdrift_-minfo.tdrift_));
+      diff.dspeed_ = std::max(diff.dspeed_,fabs(tinfo.vdrift_/minfo.vdrift_-1.0));
+      diff.dvar_ = std::max(diff.dvar_,fabs(tinfo.tdriftvar_/minfo.tdriftvar_-1.0));
+    }
+  }
+  return diff;
+}
+
+// largest time difference between the table and the model half-way between the tabulated angles, at the tabulated distances
+double angleDiff(DriftTable const& dtable, DriftModel const& model) {
+  double diff(0.0);
+  double dphi = M_PI/(dtable.nAngle()-1);
+  double dr = dtable.maxDistance()/(dtable.nDistance()-1);
+  for(size_t iphi=0; iphi+1 < dtable.nAngle(); iphi++){
+    double phi = -M_PI_2 + (iphi+0.5)*dphi;
+    for(size_t ir=0; ir < dtable.nDistance(); ir++){
+      DriftInfo tinfo, minfo;
+      POL2 drift(ir*dr,phi);
+      dtable.distanceToTime(drift,tinfo);
+      model(drift,minfo);
+      diff = std::max(diff,fabs(tinfo.tdrift_-minfo.tdrift_));
+    }
+  }
+  return diff;
+}
+
+int main(int argc, char **argv) {
+  int opt;
+  size_t nr(33), nphi(9);
+  double rmax(2.5);
+  int status(0);
+
+  static struct option long_options[] = {
+    {"nr",     required_argument, 0, 'r'  },
+    {"nphi",     required_argument, 0, 'p'  },
+    {"rmax",     required_argument, 0, 'm'  },
+    {NULL, 0,0,0}
+  };
+
+  int long_index =0;
+  while ((opt = getopt_long_only(argc, argv,"",
+	  long_options, &long_index )) != -1) {
+    switch (opt) {
+      case 'r' : nr = atoi(optarg);
+		 break;
+      case 'p' : nphi = atoi(optarg);
+		 break;
+      case 'm' : rmax = atof(optarg);
+		 break;
+      default: print_usage();
+	       exit(EXIT_FAILURE);
+    }
+  }
+  DriftModel model;
+  // tables with the default grid and with the grid spacing halved in both dimensions
+  DriftTable dtable(model,rmax,nr,nphi);
+  DriftTable ftable(model,rmax,2*nr-1,2*nphi-1);
+  cout << dtable << ftable;
+
+  // the table reproduces the model exactly at the grid points
+  double dphi = M_PI/(nphi-1);
+  double dr = rmax/(nr-1);
+  double maxgrid(0.0);
+  for(size_t iphi=0; iphi < nphi; iphi++){
+    for(size_t ir=0; ir < nr; ir++){
+      DriftInfo tinfo, minfo;
+      POL2 drift(ir*dr,-M_PI_2 + iphi*dphi);
+      dtable.distanceToTime(drift,tinfo);
+      model(drift,minfo);
+      maxgrid = std::max(maxgrid,fabs(tinfo.tdrift_-minfo.tdrift_)+fabs(tinfo.vdrift_-minfo.vdrift_)+fabs(tinfo.tdriftvar_-minfo.tdriftvar_));
+    }
+  }
+  cout << "Max difference at the grid points " << maxgrid << endl;
+  if(maxgrid > 1.0e-9){
+    cout << "DriftTable doesn't reproduce the grid points" << endl;
+    status = -1;
+  }
+
+  // interpolation accuracy, and its scaling with the grid spacing
+  auto ddiff = distanceDiff(dtable,model);
+  auto fddiff = distanceDiff(ftable,model);
+  double adiff = angleDiff(dtable,model);
+  double fadiff = angleDiff(ftable,model);
+  cout << "Distance interpolation max differences: time " << ddiff.dtime_ << " ns (" << fddiff.dtime_ << " with half spacing), relative speed "
+    << ddiff.dspeed_ << " (" << fddiff.dspeed_ << "), relative variance " << ddiff.dvar_ << " (" << fddiff.dvar_ << ")" << endl;
+  cout << "Angle interpolation max time difference " << adiff << " ns (" << fadiff << " with half spacing)" << endl;
+  // the expected scaling is 16, 8, and 4 for the time, speed and variance; allow for higher order terms
+  if(ddiff.dtime_/fddiff.dtime_ < 12.0 || ddiff.dspeed_/fddiff.dspeed_ < 6.0 || ddiff.dvar_/fddiff.dvar_ < 3.5){
+    cout << "Distance interpolation doesn't scale as expected" << endl;
+    status = -2;
+  }
+  if(adiff/fadiff < 3.5){
+    cout << "Angle interpolation doesn't scale as expected" << endl;
+    status = -2;
+  }
+  // the default table resolves the drift time much better than the time resolution
+  if(ddiff.dtime_ > 1.0e-3*model.sigt0_ || adiff > 0.1*model.sigt0_){
+    cout << "Interpolation out of tolerance" << endl;
+    status = -3;
+  }
+
+  // angles beyond the table are clamped
+  DriftInfo cinfo, einfo;
+  dtable.distanceToTime(POL2(0.7*rmax,0.99*M_PI),cinfo);
+  dtable.distanceToTime(POL2(0.7*rmax,M_PI_2),einfo);
+  if(fabs(cinfo.tdrift_-einfo.tdrift_) > 1.0e-9 || fabs(cinfo.vdrift_-einfo.vdrift_) > 1.0e-12){
+    cout << "Angle beyond the table not clamped: " << cinfo.tdrift_ << " " << einfo.tdrift_ << endl;
+    status = -4;
+  }
+  // distances beyond the table are extrapolated linearly from the end
+  for(size_t iphi=0; iphi < nphi; iphi++){
+    double phi = -M_PI_2 + iphi*dphi;
+    DriftInfo minfo, xinfo;
+    model(POL2(rmax,phi),minfo);
+    double rext = 1.3*rmax;
+    dtable.distanceToTime(POL2(rext,phi),xinfo);
+    double text = minfo.tdrift_ + (rext-rmax)/minfo.vdrift_;
+    if(fabs(xinfo.tdrift_-text) > 1.0e-9 || fabs(xinfo.vdrift_-minfo.vdrift_) > 1.0e-12){
+      cout << "Distance beyond the table not extrapolated linearly: " << xinfo.tdrift_ << " " << text << endl;
+      status = -4;
+    }
+  }
+  cout << "Exiting with status " << status << endl;
+  return status;
+}
@@ -0,0 +1,547 @@
+//
+// Benchmark of Track construction + fit throughput.  Events are pre-generated with the ToyMC and only
+// the Track construction (which includes the fit) is timed.  No ROOT I/O or drawing is performed.
+// Reports tracks/second, per-track latency percentiles, heap allocations and iterations per track,
+// both single-threaded and multi-threaded (each thread fits a disjoint subset of the events).
+//
+#include "KinKal/General/Vectors.hh"
+#include "KinKal/Trajectory/LoopHelix.hh"
+#include "KinKal/Trajectory/CentralHelix.hh"
+#include "KinKal/Trajectory/KinematicLine.hh"
+#include "KinKal/Trajectory/ParticleTrajectory.hh"
+#include "KinKal/Detector/ParameterHit.hh"
+#include "KinKal/Detector/BFieldMap.hh"
+#include "KinKal/Fit/Config.hh"
+#include "KinKal/Fit/Track.hh"
+#include "KinKal/Fit/MultiHypothesisTrack.hh"
+#include "KinKal/Fit/TrackBatch.hh"
+#include "KinKal/Fit/TrackFilter.hh"
+#include "KinKal/Fit/SeedFinder.hh"
+#include "KinKal/Tests/ToyFitSetup.hh"
+
+#include <iostream>
+#include <getopt.h>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <cstdlib>
+
+using namespace KinKal;
+using namespace std;
+
+// count global heap allocations.  This replaces the global operator new for this executable only
+static std::atomic<unsigned long> nalloc_(0);
+void* operator new(std::size_t size) {
+  nalloc_.fetch_add(1,std::memory_order_relaxed);
+  if(void* ptr = std::malloc(size == 0 ? 1 : size)) return ptr;
+  throw std::bad_alloc();
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+// aligned versions, used by the std::pmr default (new_delete) resource
+void* operator new(std::size_t size, std::align_val_t align) {
+  nalloc_.fetch_add(1,std::memory_order_relaxed);
+  size_t alignment = std::max(sizeof(void*),static_cast<size_t>(align));
+  size_t asize = ((size == 0 ? 1 : size) + alignment - 1)/alignment*alignment;
+  if(void* ptr = std::aligned_alloc(alignment,asize)) return ptr;
+  throw std::bad_alloc();
+}
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+void print_usage() {
+  printf("Usage: FitBenchmark --traj s --nevents i --nthreads i --fitmat i --bfcorr i --momentum f --nhits i --seed i --seedsmear f --maxniter i --Schedule s --bfcache f --fcachetol f --daf f --hypotheses i --convdpar f --sqrtinv i --arena i --batch i --drifttable i --nomfield i --planar i --tprec f --tcamaxiter i --matmerge f --bftol f --seedfit i --filter i\n");
+  printf("  --traj = LoopHelix, CentralHelix, KinematicLine or all (default)\n");
+  printf("  --fitmat, --bfcorr = -1 (default) benchmarks both with and without material/BField correction\n");
+  printf("  --bfcache = quantum (mm) of a CachedBFieldMap wrapping the field, 0 to only count queries, <0 (default) for none\n");
+  printf("  --fcachetol = tolerance (mm) of the per-track BField cache (Config::bfcachetol_), 0 (default) disables it\n");
+  printf("  --daf = outlier chisquared of DAF wire hit ambiguity resolution, 0 for no outlier hypothesis, <0 (default) disables DAF\n");
+  printf("  --hypotheses = 1 to compare independent and shared (MultiHypothesisTrack) fits of the e, mu and pi hypotheses\n");
+  printf("  --convdpar = parameter change convergence (MetaIterConfig::convdpar_) for all meta-iterations, 0 (default) disables it\n");
+  printf("  --sqrtinv = 1 to use square-root (Cholesky) inversion in the fit (Config::sqrtinv_)\n");
+  printf("  --arena = 1 to allocate each event's hits, crossings and fit objects from a per-event monotonic arena\n");
+  printf("  --batch = number of tracks fit together in lockstep (TrackBatch) for comparison with individual fits, 0 (default) disables it\n");
+  printf("  --drifttable = number of angles of a DriftTable shared by the straw hits (WireHit::setDriftTable), 0 (default) for none\n");
+  printf("  --nomfield = 1 to take the straw hit ExB direction from the trajectory nominal field (WireHit::setNominalField)\n");
+  printf("  --planar = 1 to simulate pixel planes (PlanarHit and PlaneXing) instead of straws\n");
+  printf("  --tprec, --tcamaxiter = TOCA precision (MetaIterConfig::tprec_) and iteration limit (MetaIterConfig::tcamaxiter_) for all meta-iterations, 0 (default) keeps the schedule values\n");
+  printf("  --matmerge = time span (ns) for merging consecutive material crossings into a single effect (Config::matmergedt_), 0 (default) disables it\n");
+  printf("  --bftol = BField domain tolerance (mm) of the early meta-iterations (MetaIterConfig::bftol_); the last re-derives the domains with Config::tol_.  0 (default) disables it\n");
+  printf("  --seedfit = 1 to estimate the seeds from the hits with SeedFinder instead of smearing the true parameters.  Straw hits are seeded\n");
+  printf("              from their drift radii, scintillator hits from their axis; events where it fails use the smeared seed\n");
+  printf("  --filter = number of forward-only filter passes (TrackFilter) to benchmark for comparison with the full fit, 0 (default) disables it\n");
+}
+
+// benchmark options, shared by all trajectory types
+struct BenchOptions {
+  unsigned nevents_ = 1000;
+  unsigned nthreads_ = std::max(1u,std::thread::hardware_concurrency());
+  int fitmat_ = -1;
+  int bfcorr_ = -1;
+  double mom_ = 105.0;
+  unsigned nhits_ = 40;
+  int iseed_ = 123421;
+  double seedsmear_ = 10.0;
+  unsigned maxniter_ = 10;
+  string sfile_ = "Schedule.txt";
+  double bfcache_ = -1.0;
+  double fcachetol_ = 0.0;
+  double dafchicut_ = -1.0;
+  bool hypotheses_ = false;
+  double convdpar_ = 0.0;
+  bool sqrtinv_ = false;
+  bool arena_ = false;
+  unsigned batch_ = 0;
+  unsigned drifttable_ = 0;
+  bool nomfield_ = false;
+  bool planar_ = false;
+  double tprec_ = 0.0;
+  unsigned tcamaxiter_ = 0;
+  double matmergedt_ = 0.0;
+  double bftol_ = 0.0;
+  bool seedfit_ = false;
+  unsigned filter_ = 0;
+};
+
+// per-trajectory type test setup, following the *Fit_unit tests
+struct BenchSetup {
+  DVEC sigmas_; // expected parameter sigmas
+  double Bz_, Bgrad_; // field
+  int conspar_; // constrained parameter (-1 for none)
+  bool bfcorr_; // BField correction makes sense for this trajectory type
+};
+
+// result of a single benchmark pass
+struct BenchResult {
+  unsigned ntracks_ = 0, nfail_ = 0;
+  double wall_ = 0.0; // total wall time in seconds
+  double p50_ = 0.0, p99_ = 0.0; // per-track latency percentiles in microseconds
+  double nalloc_ = 0.0; // heap allocations per track
+  double niter_ = 0.0; // algebraic iterations per track
+  double nbfield_ = 0.0; // BFieldMap evaluations per track made through the track field cache
+  double nbuild_ = 0.0; // fit trajectory builds per track
+  double ndomain_ = 0.0; // final BField domains per track
+};
+
+// pre-generated fit inputs for 1 event
+template <class KTRAJ> struct BenchEvent {
+  using HITCOL = typename Track<KTRAJ>::HITCOL;
+  using EXINGCOL = typename Track<KTRAJ>::EXINGCOL;
+  std::unique_ptr<std::pmr::monotonic_buffer_resource> arena_; // optional; declared first so that it's released last
+  KTRAJ seed_;
+  HITCOL hits_;
+  EXINGCOL xings_;
+  BenchEvent(KTRAJ const& seed) : seed_(seed) {}
+};
+
+// generate events with the ToyMC.  This is not timed
+template <class KTRAJ> void generate(KKTest::ToyMC<KTRAJ>& toy, BenchOptions const& opts, BenchSetup const& setup,
+    VEC3 const& bnom, bool fitmat, std::vector<BenchEvent<KTRAJ>>& events) {
+  using PKTRAJ = ParticleTrajectory<KTRAJ>;
+  using PARHIT = ParameterHit<KTRAJ>;
+  using PMASK = std::array<bool,NParams()>;
+  TRandom3 tr(opts.iseed_+1);
+  if(opts.drifttable_ > 0)toy.useDriftTable(64,opts.drifttable_);
+  toy.setNominalField(opts.nomfield_);
+  toy.setPlanar(opts.planar_);
+  events.clear();
+  events.reserve(opts.nevents_);
+  unsigned nseedfail(0);
+  for(unsigned ievent=0;ievent<opts.nevents_;ievent++){
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+    if(opts.arena_)arena = std::make_unique<std::pmr::monotonic_buffer_resource>(1<<16);
+    std::pmr::memory_resource* mres = arena ? arena.get() : std::pmr::get_default_resource();
+    toy.setMemoryResource(mres);
+    PKTRAJ tptraj;
+    typename BenchEvent<KTRAJ>::HITCOL thits;
+    typename BenchEvent<KTRAJ>::EXINGCOL dxings;
+    toy.simulateParticle(tptraj,thits,dxings,fitmat);
+    double tmid = tptraj.range().mid();
+    auto const& midhel = tptraj.nearestPiece(tmid);
+    TimeRange seedrange(tptraj.range().begin()-0.5,tptraj.range().end()+0.5);
+    KTRAJ seedtraj(midhel.position4(tmid),midhel.momentum4(tmid),midhel.charge(),bnom,seedrange);
+    toy.createSeed(seedtraj,setup.sigmas_,opts.seedsmear_);
+    if(opts.seedfit_){
+      // replace the smeared seed with the estimate from the hits, keeping the covariance
+      try {
+	SeedFinder<KTRAJ> sfinder(bnom,midhel.mass(),midhel.charge());
+	sfinder.addHits(thits,&KKTest::ToyMC<KTRAJ>::seedHit);
+	DVEC sigmas;
+	for(size_t ipar=0; ipar < NParams(); ipar++) sigmas[ipar] = setup.sigmas_[ipar]*opts.seedsmear_;
+	seedtraj = sfinder.seed(sigmas);
+      } catch (std::exception const& error) {
+	nseedfail++;
+      }
+    }
+    if(setup.conspar_ >= 0 && setup.conspar_ < (int)NParams()){
+      PMASK mask = {false};
+      mask[setup.conspar_] = true;
+      auto const& front = tptraj.front();
+      Parameters cparams = front.params();
+      for(size_t ipar=0; ipar < NParams(); ipar++){
+	double perr = setup.sigmas_[ipar];
+	cparams.covariance()[ipar][ipar] = perr*perr;
+	cparams.parameters()[ipar] += tr.Gaus(0.0,perr);
+      }
+      thits.push_back(std::allocate_shared<PARHIT>(std::pmr::polymorphic_allocator<PARHIT>(mres),front.range().mid(),cparams,mask));
+    }
+    events.emplace_back(seedtraj);
+    events.back().arena_ = std::move(arena);
+    events.back().hits_ = std::move(thits);
+    events.back().xings_ = std::move(dxings);
+  }
+  toy.setMemoryResource(std::pmr::get_default_resource());
+  if(nseedfail > 0) cout << "SeedFinder failed for " << nseedfail << " events, which use the smeared seed" << endl;
+}
+
+// fit the events, distributing them over nthreads threads.  If nbatch > 0, each thread fits its events in lockstep
+// batches of that size, and the latency is the batch fit time divided by the batch size.  If nfilter > 0, the events are
+// instead filtered forwards with that many TrackFilter passes
+template <class KTRAJ> BenchResult fitEvents(Config const& config, BFieldMap const& bfield, std::vector<BenchEvent<KTRAJ>>& events, unsigned nthreads,
+    unsigned nbatch=0, unsigned nfilter=0) {
+  using Clock = std::chrono::high_resolution_clock;
+  BenchResult result;
+  result.ntracks_ = events.size();
+  if(events.size() == 0)return result;
+  std::vector<double> latency(events.size(),0.0);
+  std::vector<unsigned> niter(events.size(),0);
+  std::vector<unsigned long> nbfield(events.size(),0);
+  std::vector<unsigned> nbuild(events.size(),0);
+  std::vector<unsigned> ndomain(events.size(),0);
+  std::vector<char> failed(events.size(),false); // not vector<bool>, which is unsafe to fill concurrently
+  // each thread processes a disjoint subset of the events, so no synchronization is needed
+  auto fillResult = [&](size_t ievent, Track<KTRAJ> const& kktrk) {
+    for(auto const& fstat: kktrk.history()) if(fstat.status_ != Status::unfit)niter[ievent]++;
+    failed[ievent] = !kktrk.fitStatus().usable();
+    nbfield[ievent] = kktrk.bfieldCache().nEvaluations();
+    nbuild[ievent] = kktrk.nFitTrajBuilds();
+    ndomain[ievent] = kktrk.domains().size();
+  };
+  auto fitBatches = [&](unsigned ithread) {
+    for(size_t ibeg=ithread*nbatch; ibeg < events.size(); ibeg += nthreads*nbatch) {
+      size_t iend = std::min(events.size(),ibeg+nbatch);
+      auto start = Clock::now();
+      TrackBatch<KTRAJ> batch(config,bfield);
+      for(size_t ievent=ibeg; ievent < iend; ievent++){
+	auto& event = events[ievent];
+	batch.addTrack(event.seed_,event.hits_,event.xings_,event.arena_ ? event.arena_.get() : std::pmr::get_default_resource());
+      }
+      batch.fit();
+      auto stop = Clock::now();
+      double blatency = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()*1.0e-3/double(iend-ibeg);
+      for(size_t ievent=ibeg; ievent < iend; ievent++){
+	latency[ievent] = blatency;
+	fillResult(ievent,batch.track(ievent-ibeg));
+      }
+    }
+  };
+  auto filterRange = [&](unsigned ithread) {
+    for(size_t ievent=ithread; ievent < events.size(); ievent += nthreads) {
+      auto& event = events[ievent];
+      auto start = Clock::now();
+      TrackFilter<KTRAJ> kkflt(config,bfield,event.seed_,event.hits_,event.xings_,TimeDir::forwards,nfilter,
+	  event.arena_ ? event.arena_.get() : std::pmr::get_default_resource());
+      auto stop = Clock::now();
+      latency[ievent] = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()*1.0e-3;
+      fillResult(ievent,kkflt.track());
+    }
+  };
+  auto fitRange = [&](unsigned ithread) {
+    if(nbatch > 0)return fitBatches(ithread);
+    if(nfilter > 0)return filterRange(ithread);
+    for(size_t ievent=ithread; ievent < events.size(); ievent += nthreads) {
+      auto& event = events[ievent];
+      auto start = Clock::now();
+      Track<KTRAJ> kktrk(config,bfield,event.seed_,event.hits_,event.xings_,
+	  event.arena_ ? event.arena_.get() : std::pmr::get_default_resource());
+      auto stop = Clock::now();
+      latency[ievent] = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()*1.0e-3;
+      fillResult(ievent,kktrk);
+    }
+  };
+  unsigned long nalloc = nalloc_.load();
+  auto wstart = Clock::now();
+  if(nthreads <= 1) {
+    fitRange(0);
+  } else {
+    std::vector<std::thread> threads;
+    threads.reserve(nthreads);
+    for(unsigned ithread=0;ithread<nthreads;ithread++) threads.emplace_back(fitRange,ithread);
+    for(auto& thread : threads) thread.join();
+  }
+  auto wstop = Clock::now();
+  // thread creation allocations are included; they are negligible compared to the fits
+  result.nalloc_ = double(nalloc_.load() - nalloc)/double(events.size());
+  result.wall_ = std::chrono::duration_cast<std::chrono::nanoseconds>(wstop - wstart).count()*1.0e-9;
+  for(size_t ievent=0; ievent < events.size(); ievent++){
+    result.niter_ += niter[ievent];
+    result.nbfield_ += nbfield[ievent];
+    result.nbuild_ += nbuild[ievent];
+    result.ndomain_ += ndomain[ievent];
+    if(failed[ievent])result.nfail_++;
+  }
+  result.niter_ /= double(events.size());
+  result.nbfield_ /= double(events.size());
+  result.nbuild_ /= double(events.size());
+  result.ndomain_ /= double(events.size());
+  std::sort(latency.begin(),latency.end());
+  result.p50_ = latency[(latency.size()-1)/2];
+  result.p99_ = latency[std::min(latency.size()-1,size_t(0.99*latency.size()))];
+  return result;
+}
+
+// copy of the seed with a different mass hypothesis
+template <class KTRAJ> KTRAJ massSeed(KTRAJ const& seed, double mass) {
+  double tmid = seed.range().mid();
+  auto mom = seed.momentum4(tmid);
+  mom.SetM(mass);
+  KTRAJ hypseed(seed.position4(tmid),mom,seed.charge(),seed.bnom(),seed.range());
+  hypseed.setCovariance(seed.params().covariance());
+  return hypseed;
+}
+
+// fit each event under several mass hypotheses, first with independent Tracks then with MultiHypothesisTrack.
+// Events are regenerated for each pass so that no hit state is shared between the independent fits
+template <class KTRAJ> void benchHypotheses(string const& name, Config const& config, BFieldMap const& bfield, BenchOptions const& opts,
+    BenchSetup const& setup, VEC3 const& bnom, double zrange, bool fitmat) {
+  using Clock = std::chrono::high_resolution_clock;
+  std::vector<double> masses = {0.511,105.66,139.57}; // e, mu, pi, as in FitTest
+  std::vector<BenchEvent<KTRAJ>> events;
+  double indwall(0.0), sharedwall(0.0);
+  unsigned indfail(0), sharedfail(0), sharedrefit(0);
+  for(auto mass : masses){
+    KKTest::ToyMC<KTRAJ> toy(bfield, opts.mom_, -1, zrange, opts.iseed_, opts.nhits_, true, true, true, 0.25, 0.511);
+    generate(toy,opts,setup,bnom,fitmat,events);
+    auto start = Clock::now();
+    for(auto& event : events){
+      Track<KTRAJ> kktrk(config,bfield,massSeed(event.seed_,mass),event.hits_,event.xings_);
+      if(!kktrk.fitStatus().usable())indfail++;
+    }
+    indwall += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()*1.0e-9;
+  }
+  KKTest::ToyMC<KTRAJ> toy(bfield, opts.mom_, -1, zrange, opts.iseed_, opts.nhits_, true, true, true, 0.25, 0.511);
+  generate(toy,opts,setup,bnom,fitmat,events);
+  auto start = Clock::now();
+  for(auto& event : events){
+    MultiHypothesisTrack<KTRAJ> mhtrk(config,bfield,event.seed_,masses,event.hits_,event.xings_);
+    for(size_t ihyp=0; ihyp < mhtrk.nHypotheses(); ihyp++){
+      if(!mhtrk.fitStatus(ihyp).usable())sharedfail++;
+      if(mhtrk.refit(ihyp))sharedrefit++;
+    }
+  }
+  sharedwall = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()*1.0e-9;
+  unsigned nfits = masses.size()*events.size();
+  cout << name << " " << masses.size() << " hypotheses: independent " << indwall << " s failed " << indfail << "/" << nfits
+    << " shared " << sharedwall << " s failed " << sharedfail << "/" << nfits << " refit " << sharedrefit << "/" << nfits
+    << " shared/independent " << (indwall > 0.0 ? sharedwall/indwall : 0.0) << endl;
+}
+
+void printResult(string const& name, unsigned nthreads, BenchResult const& result) {
+  cout << name << " threads " << nthreads
+    << " tracks/sec " << (result.wall_ > 0.0 ? result.ntracks_/result.wall_ : 0.0)
+    << " p50 " << result.p50_ << " us p99 " << result.p99_ << " us"
+    << " allocs/track " << result.nalloc_
+    << " iterations/track " << result.niter_
+    << " BField evals/track " << result.nbfield_
+    << " rebuilds/track " << result.nbuild_
+    << " domains/track " << result.ndomain_
+    << " failed " << result.nfail_ << "/" << result.ntracks_ << endl;
+}
+
+template <class KTRAJ> int FitBenchmark(BenchOptions const& opts, BenchSetup const& setup) {
+  // construct BFieldMap
+  std::unique_ptr<BFieldMap> BF;
+  VEC3 bnom(0.0,0.0,setup.Bz_);
+  double zrange(3000);
+  if(setup.Bgrad_ != 0){
+    BF = std::make_unique<GradientBFieldMap>(setup.Bz_-0.5*setup.Bgrad_,setup.Bz_+0.5*setup.Bgrad_,-0.5*zrange,0.5*zrange);
+    bnom = BF->fieldVect(VEC3(0.0,0.0,0.0));
+  } else
+    BF = std::make_unique<UniformBFieldMap>(bnom);
+  Config config;
+  config.maxniter_ = opts.maxniter_;
+  config.tol_ = 0.01;
+  config.bfcachetol_ = opts.fcachetol_;
+  config.sqrtinv_ = opts.sqrtinv_;
+  config.matmergedt_ = opts.matmergedt_;
+  config.plevel_ = Config::none;
+  if(!KKTest::readSchedule(opts.sfile_,config))return -1;
+  if(opts.dafchicut_ >= 0.0){
+    for(auto& miconfig : config.schedule()) miconfig.updaters_.push_back(WireHitDAFUpdater(opts.dafchicut_));
+  }
+  if(opts.convdpar_ > 0.0){
+    for(auto& miconfig : config.schedule()) miconfig.convdpar_ = opts.convdpar_;
+  }
+  for(auto& miconfig : config.schedule()){
+    if(opts.tprec_ > 0.0) miconfig.tprec_ = opts.tprec_;
+    if(opts.tcamaxiter_ > 0) miconfig.tcamaxiter_ = opts.tcamaxiter_;
+    if(opts.bftol_ > 0.0) miconfig.bftol_ = &miconfig == &config.schedule().back() ? config.tol_ : opts.bftol_;
+  }
+  // loop over the material and BField correction configurations
+  std::vector<bool> fitmats;
+  if(opts.fitmat_ < 0)
+    fitmats = {false,true};
+  else
+    fitmats = {bool(opts.fitmat_)};
+  std::vector<Config::BFCorr> bfcorrs;
+  if(opts.bfcorr_ >= 0)
+    bfcorrs = {Config::BFCorr(opts.bfcorr_)};
+  else if(setup.bfcorr_)
+    bfcorrs = {Config::nocorr, Config::variable};
+  else
+    bfcorrs = {Config::nocorr};
+  std::vector<BenchEvent<KTRAJ>> events;
+  for(auto fitmat : fitmats) {
+    for(auto bfcorr : bfcorrs) {
+      config.bfcorr_ = bfcorr;
+      string name = KTRAJ::trajName() + string(" fitmat ") + std::to_string(fitmat) + string(" bfcorr ") + std::to_string(bfcorr);
+      // regenerate for each pass, as fitting changes the hit state.  The same random seed gives the same events
+      KKTest::ToyMC<KTRAJ> toy(*BF, opts.mom_, -1, zrange, opts.iseed_, opts.nhits_, true, true, true, 0.25, 0.511);
+      generate(toy,opts,setup,bnom,fitmat,events);
+      if(opts.bfcache_ >= 0.0){
+	// the field decorator is not thread-safe, so only run single-threaded
+	CachedBFieldMap cbf(*BF,opts.bfcache_);
+	printResult(name,1,fitEvents(config,cbf,events,1));
+	cout << name << " " << cbf.stats() << " per track " << double(cbf.stats().nvect_)/double(events.size()) << endl;
+      } else
+	printResult(name,1,fitEvents(config,*BF,events,1));
+      if(opts.batch_ > 0 && opts.bfcache_ < 0.0){
+	// regenerate the same events
+	KKTest::ToyMC<KTRAJ> btoy(*BF, opts.mom_, -1, zrange, opts.iseed_, opts.nhits_, true, true, true, 0.25, 0.511);
+	generate(btoy,opts,setup,bnom,fitmat,events);
+	printResult(name + string(" batch ") + std::to_string(opts.batch_),1,fitEvents(config,*BF,events,1,opts.batch_));
+      }
+      if(opts.filter_ > 0 && opts.bfcache_ < 0.0){
+	KKTest::ToyMC<KTRAJ> ftoy(*BF, opts.mom_, -1, zrange, opts.iseed_, opts.nhits_, true, true, true, 0.25, 0.511);
+	generate(ftoy,opts,setup,bnom,fitmat,events);
+	printResult(name + string(" filter ") + std::to_string(opts.filter_),1,fitEvents(config,*BF,events,1,0,opts.filter_));
+      }
+      if(opts.hypotheses_)benchHypotheses<KTRAJ>(name,config,*BF,opts,setup,bnom,zrange,fitmat);
+      if(opts.nthreads_ > 1 && opts.bfcache_ < 0.0){
+	KKTest::ToyMC<KTRAJ> mttoy(*BF, opts.mom_, -1, zrange, opts.iseed_, opts.nhits_, true, true, true, 0.25, 0.511);
+	generate(mttoy,opts,setup,bnom,fitmat,events);
+	printResult(name,opts.nthreads_,fitEvents(config,*BF,events,opts.nthreads_));
+      }
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  BenchOptions opts;
+  string traj("all");
+  static struct option long_options[] = {
+    {"traj",     required_argument, 0, 'T'  },
+    {"nevents",     required_argument, 0, 'N'  },
+    {"nthreads",     required_argument, 0, 'j'  },
+    {"fitmat",     required_argument, 0, 'f'  },
+    {"bfcorr",     required_argument, 0, 'B'  },
+    {"momentum",     required_argument, 0, 'm' },
+    {"nhits",     required_argument, 0, 'n'  },
+    {"seed",     required_argument, 0, 's'  },
+    {"seedsmear",     required_argument, 0, 'M' },
+    {"maxniter",     required_argument, 0, 'i'  },
+    {"Schedule",     required_argument, 0, 'u'  },
+    {"bfcache",     required_argument, 0, 'C'  },
+    {"fcachetol",     required_argument, 0, 'F'  },
+    {"daf",     required_argument, 0, 'D'  },
+    {"hypotheses",     required_argument, 0, 'H'  },
+    {"convdpar",     required_argument, 0, 'P'  },
+    {"sqrtinv",     required_argument, 0, 'Q'  },
+    {"arena",     required_argument, 0, 'A'  },
+    {"batch",     required_argument, 0, 'K'  },
+    {"drifttable",     required_argument, 0, 'W'  },
+    {"nomfield",     required_argument, 0, 'Z'  },
+    {"planar",     required_argument, 0, 'L'  },
+    {"tprec",     required_argument, 0, 'R'  },
+    {"tcamaxiter",     required_argument, 0, 'I'  },
+    {"matmerge",     required_argument, 0, 'G'  },
+    {"bftol",     required_argument, 0, 'O'  },
+    {"seedfit",     required_argument, 0, 'E'  },
+    {"filter",     required_argument, 0, 'X'  },
+    {NULL, 0,0,0}
+  };
+  int opt;
+  int long_index =0;
+  while ((opt = getopt_long(argc, argv,"",
+	  long_options, &long_index )) != -1) {
+    switch (opt) {
+      case 'T' : traj = optarg;
+		 break;
+      case 'N' : opts.nevents_ = atoi(optarg);
+		 break;
+      case 'j' : opts.nthreads_ = atoi(optarg);
+		 break;
+      case 'f' : opts.fitmat_ = atoi(optarg);
+		 break;
+      case 'B' : opts.bfcorr_ = atoi(optarg);
+		 break;
+      case 'm' : opts.mom_ = atof(optarg);
+		 break;
+      case 'n' : opts.nhits_ = atoi(optarg);
+		 break;
+      case 's' : opts.iseed_ = atoi(optarg);
+		 break;
+      case 'M' : opts.seedsmear_ = atof(optarg);
+		 break;
+      case 'i' : opts.maxniter_ = atoi(optarg);
+		 break;
+      case 'u' : opts.sfile_ = optarg;
+		 break;
+      case 'C' : opts.bfcache_ = atof(optarg);
+		 break;
+      case 'F' : opts.fcachetol_ = atof(optarg);
+		 break;
+      case 'D' : opts.dafchicut_ = atof(optarg);
+		 break;
+      case 'H' : opts.hypotheses_ = atoi(optarg);
+		 break;
+      case 'P' : opts.convdpar_ = atof(optarg);
+		 break;
+      case 'Q' : opts.sqrtinv_ = atoi(optarg);
+		 break;
+      case 'A' : opts.arena_ = atoi(optarg);
+		 break;
+      case 'K' : opts.batch_ = atoi(optarg);
+		 break;
+      case 'W' : opts.drifttable_ = atoi(optarg);
+		 break;
+      case 'Z' : opts.nomfield_ = atoi(optarg);
+		 break;
+      case 'L' : opts.planar_ = atoi(optarg);
+		 break;
+      case 'R' : opts.tprec_ = atof(optarg);
+		 break;
+      case 'I' : opts.tcamaxiter_ = atoi(optarg);
+		 break;
+      case 'G' : opts.matmergedt_ = atof(optarg);
+		 break;
+      case 'O' : opts.bftol_ = atof(optarg);
+		 break;
+      case 'E' : opts.seedfit_ = atoi(optarg);
+		 break;
+      case 'X' : opts.filter_ = atoi(optarg);
+		 break;
+      default: print_usage();
+	       exit(EXIT_FAILURE);
+    }
+  }
+  int retval(0);
+  // setups follow the corresponding *Fit_unit tests
+  if(traj == "all" || traj == "LoopHelix")
+    retval |= FitBenchmark<LoopHelix>(opts,BenchSetup{DVEC(0.5, 0.5, 0.5, 0.5, 0.002, 0.5), 1.0, -0.036, -1, true});
+  if(traj == "all" || traj == "CentralHelix")
+    retval |= FitBenchmark<CentralHelix>(opts,BenchSetup{DVEC(0.5, 0.003, 0.00001, 3.0 , 0.004, 0.1), 1.0, -0.036, -1, true});
+  if(traj == "all" || traj == "KinematicLine")
+    retval |= FitBenchmark<KinematicLine>(opts,BenchSetup{DVEC(0.5, 0.004, 0.5, 0.002, 0.4, 0.05), 0.0, 0.0, 5, false});
+#ifdef KINKAL_PROFILE
+  cout << FitProfile::global();
+#endif
+  return retval;
+}
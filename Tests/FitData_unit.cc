@@ -0,0 +1,161 @@
+//
+// test the inversion of FitData: Cholesky (square-root) inversion against direct inversion, for random positive-definite
+// matrices spanning a large range of parameter scales, and its failure on matrices which aren't positive-definite
+//
+#include "KinKal/General/FitData.hh"
+
+#include <iostream>
+#include <stdio.h>
+#include <cmath>
+#include <array>
+#include <getopt.h>
+#include <stdexcept>
+
+#include "TRandom3.h"
+
+using namespace KinKal;
+using namespace std;
+
+void print_usage() {
+  printf("Usage: FitData --ntrials i --scale f --tolerance f --seed i\n");
+}
+
+// largest difference between 2 matrices, relative to the diagonal of the first
+double maxDiff(DMAT const& ref, DMAT const& mat) {
+  double maxdiff(0.0);
+  for(size_t irow=0;irow<NParams();irow++)
+    for(size_t icol=0;icol<=irow;icol++)
+      maxdiff = std::max(maxdiff,fabs(mat(irow,icol)-ref(irow,icol))/sqrt(ref(irow,irow)*ref(icol,icol)));
+  return maxdiff;
+}
+
+// largest difference between 2 vectors, relative to the diagonal of the matrix they are associated with
+double maxDiff(DVEC const& ref, DVEC const& vec, DMAT const& mat) {
+  double maxdiff(0.0);
+  for(size_t irow=0;irow<NParams();irow++)
+    maxdiff = std::max(maxdiff,fabs(vec[irow]-ref[irow])/sqrt(mat(irow,irow)));
+  return maxdiff;
+}
+
+// test that the Cholesky inversion fails on this matrix
+bool choleskyFails(DMAT const& mat) {
+  FitData fdata(DVEC(),mat);
+  try {
+    fdata.invert(FitData::cholesky);
+  } catch (std::runtime_error const& error) {
+    return true;
+  }
+  return false;
+}
+
+int main(int argc, char **argv) {
+  int opt;
+  unsigned ntrials(1000);
+  double scale(6.0); // log10 range of the parameter scales
+  double tol(1.0e-8);
+  unsigned iseed(124223);
+  int status(0);
+
+  static struct option long_options[] = {
+    {"ntrials",     required_argument, 0, 'n'  },
+    {"scale",     required_argument, 0, 's'  },
+    {"tolerance",     required_argument, 0, 't'  },
+    {"seed",     required_argument, 0, 'S'  },
+    {NULL, 0,0,0}
+  };
+
+  int long_index =0;
+  while ((opt = getopt_long_only(argc, argv,"",
+	  long_options, &long_index )) != -1) {
+    switch (opt) {
+      case 'n' : ntrials = atoi(optarg);
+		 break;
+      case 's' : scale = atof(optarg);
+		 break;
+      case 't' : tol = atof(optarg);
+		 break;
+      case 'S' : iseed = atoi(optarg);
+		 break;
+      default: print_usage();
+	       exit(EXIT_FAILURE);
+    }
+  }
+
+  TRandom3 tr(iseed);
+  double maxdirect(0.0), maxround(0.0), maxvround(0.0);
+  unsigned nfail(0);
+  for(unsigned itrial=0;itrial<ntrials;itrial++){
+    // random positive-definite matrix: correlated, with a well-conditioned core and parameter scales spanning 'scale' decades
+    ROOT::Math::SMatrix<double,NParams(),NParams()> amat;
+    for(size_t irow=0;irow<NParams();irow++)
+      for(size_t icol=0;icol<NParams();icol++)
+	amat(irow,icol) = tr.Gaus(0.0,1.0);
+    DMAT mat;
+    std::array<double,NParams()> pscale;
+    for(size_t irow=0;irow<NParams();irow++) pscale[irow] = pow(10.0,tr.Uniform(-0.5*scale,0.5*scale));
+    for(size_t irow=0;irow<NParams();irow++){
+      for(size_t icol=0;icol<=irow;icol++){
+	double sum = irow == icol ? 1.0 : 0.0;
+	for(size_t kdim=0;kdim<NParams();kdim++) sum += amat(irow,kdim)*amat(icol,kdim);
+	mat(irow,icol) = sum*pscale[irow]*pscale[icol];
+      }
+    }
+    DVEC vec;
+    for(size_t irow=0;irow<NParams();irow++) vec[irow] = tr.Gaus(0.0,1.0)*sqrt(mat(irow,irow));
+    FitData ref(vec,mat);
+    FitData direct(ref,true,FitData::direct);
+    FitData chol(ref,true,FitData::cholesky);
+    // compare with direct inversion
+    maxdirect = std::max(maxdirect,maxDiff(direct.mat(),chol.mat()));
+    // inverting again should return the original
+    try {
+      chol.invert(FitData::cholesky);
+    } catch (std::runtime_error const& error) {
+      nfail++;
+      continue;
+    }
+    maxround = std::max(maxround,maxDiff(ref.mat(),chol.mat()));
+    maxvround = std::max(maxvround,maxDiff(ref.vec(),chol.vec(),ref.mat()));
+  }
+  cout << ntrials << " trials, max relative difference to direct inversion " << maxdirect << ", round trip matrix " << maxround
+    << " vector " << maxvround << ", " << nfail << " failures" << endl;
+  if(nfail > 0 || maxdirect > tol || maxround > tol || maxvround > tol){
+    cout << "Cholesky inversion out of tolerance " << tol << endl;
+    status = -1;
+  }
+
+  // matrices which aren't positive-definite must be rejected
+  DMAT notpd = ROOT::Math::SMatrixIdentity();
+  notpd(3,3) = -1.0;
+  if(!choleskyFails(notpd)){
+    cout << "Cholesky inversion accepted a negative diagonal" << endl;
+    status = -2;
+  }
+  notpd = ROOT::Math::SMatrixIdentity();
+  notpd(2,2) = 0.0;
+  if(!choleskyFails(notpd)){
+    cout << "Cholesky inversion accepted a zero diagonal" << endl;
+    status = -2;
+  }
+  // correlation larger than 1
+  notpd = ROOT::Math::SMatrixIdentity();
+  notpd(1,1) = 4.0; notpd(4,4) = 16.0; notpd(1,4) = 8.5;
+  if(!choleskyFails(notpd)){
+    cout << "Cholesky inversion accepted an indefinite matrix" << endl;
+    status = -2;
+  }
+  // fully correlated (singular)
+  notpd(1,4) = 8.0;
+  if(!choleskyFails(notpd)){
+    cout << "Cholesky inversion accepted a singular matrix" << endl;
+    status = -2;
+  }
+  // a positive-definite matrix with the same scales is accepted
+  notpd(1,4) = 7.0;
+  if(choleskyFails(notpd)){
+    cout << "Cholesky inversion rejected a positive-definite matrix" << endl;
+    status = -2;
+  }
+  cout << "Exiting with status " << status << endl;
+  return status;
+}
@@ -37,6 +37,7 @@
 #include <memory>
 #include <cstdlib>
 #include <cstring>
+#include <iomanip>
 
 #include "TH1F.h"
 #include "TTree.h"
@@ -68,7 +69,7 @@ using namespace std;
 // avoid confusion with root
 using KinKal::Line;
 void print_usage() {
-  printf("Usage: FitTest  --momentum f --simparticle i --fitparticle i--charge i --nhits i --hres f --seed i --maxniter i --deweight f --ambigdoca f --nevents i --simmat i--fitmat i --ttree i --Bz f --dBx f --dBy f --dBz f--Bgrad f --tolerance f --TFilesuffix c --PrintBad i --PrintDetail i --ScintHit i --nulltime i--bfcorr i --invert i --Schedule a --ssmear i --constrainpar i --inefficiency f\n");
+  printf("Usage: FitTest  --momentum f --simparticle i --fitparticle i--charge i --nhits i --hres f --seed i --maxniter i --deweight f --ambigdoca f --nevents i --simmat i--fitmat i --ttree i --Bz f --dBx f --dBy f --dBz f--Bgrad f --tolerance f --TFilesuffix c --PrintBad i --PrintDetail i --ScintHit i --nulltime i--bfcorr i --invert i --Schedule a --ssmear i --constrainpar i --inefficiency f --daf f --dafnull i --sqrtinv i --matmerge f --writepars s --comparepars s --partol f --writepulls s --comparepulls s --pulltol f\n");
 }
 
 // utility function to compute transverse distance between 2 similar trajectories.  Also
@@ -163,6 +164,14 @@ int FitTest(int argc, char *argv[],KinKal::DVEC const& sigmas) {
   double seedsmear(10.0);
   double momsigma(0.2);
   double ineff(0.05);
+  double dafchicut(-1.0); // DAF ambiguity resolution outlier chisquared; <0 disables DAF
+  bool dafnull(false); // DAF also resolves null ambiguity hits
+  bool sqrtinv(false); // square-root (Cholesky) inversion in the fit
+  double matmergedt(0.0); // time span for merging material crossings; 0 disables merging
+  string wparfile, cparfile; // files to write the fit parameters to, or compare them with
+  double partol(0.05); // tolerance of the parameter comparison, in units of the reference parameter errors
+  string wpullfile, cpullfile; // files to write the pull means and widths to, or compare them with
+  double pulltol(0.06); // tolerance of the pull comparison: relative width difference, and mean difference
   bool simmat(true), lighthit(true),  nulltime(true);
   int retval(EXIT_SUCCESS);
   TRandom3 tr_; // random number generator
@@ -200,6 +209,16 @@ int FitTest(int argc, char *argv[],KinKal::DVEC const& sigmas) {
     {"constrainpar",     required_argument, 0, 'c' },
     {"inefficiency",     required_argument, 0, 'E' },
     {"iprint",     required_argument, 0, 'p' },
+    {"daf",     required_argument, 0, 'a' },
+    {"dafnull",     required_argument, 0, 'e' },
+    {"sqrtinv",     required_argument, 0, 'Q' },
+    {"matmerge",     required_argument, 0, 'G' },
+    {"writepars",     required_argument, 0, 'W' },
+    {"comparepars",     required_argument, 0, 'C' },
+    {"partol",     required_argument, 0, 'O' },
+    {"writepulls",     required_argument, 0, 'H' },
+    {"comparepulls",     required_argument, 0, 'R' },
+    {"pulltol",     required_argument, 0, 'U' },
     {NULL, 0,0,0}
   };
 
@@ -255,6 +274,26 @@ int FitTest(int argc, char *argv[],KinKal::DVEC const& sigmas) {
 		 break;
       case 'p' : iprint = atoi(optarg);
 		 break;
+      case 'a' : dafchicut = atof(optarg);
+		 break;
+      case 'e' : dafnull = atoi(optarg);
+		 break;
+      case 'Q' : sqrtinv = atoi(optarg);
+		 break;
+      case 'G' : matmergedt = atof(optarg);
+		 break;
+      case 'W' : wparfile = optarg;
+		 break;
+      case 'C' : cparfile = optarg;
+		 break;
+      case 'O' : partol = atof(optarg);
+		 break;
+      case 'H' : wpullfile = optarg;
+		 break;
+      case 'R' : cpullfile = optarg;
+		 break;
+      case 'U' : pulltol = atof(optarg);
+		 break;
       case 'D' : detail = atoi(optarg);
 		 break;
       case 'c' : conspar = atoi(optarg);
@@ -321,6 +360,8 @@ int FitTest(int argc, char *argv[],KinKal::DVEC const& sigmas) {
   config.maxniter_ = maxniter;
   config.bfcorr_ = bfcorr;
   config.tol_ = tol;
+  config.sqrtinv_ = sqrtinv;
+  config.matmergedt_ = matmergedt;
   config.plevel_ = (Config::printLevel)detail;
   // read the schedule from the file
   string fullfile;
@@ -347,6 +388,7 @@ int FitTest(int argc, char *argv[],KinKal::DVEC const& sigmas) {
       istringstream ss(line);
       MetaIterConfig mconfig(ss);
       mconfig.miter_ = nmiter++;
+      if(dafchicut >= 0.0) mconfig.updaters_.push_back(WireHitDAFUpdater(dafchicut,1.0e-3,dafnull));
       config.schedule_.push_back(mconfig);
     }
   }
@@ -411,22 +453,20 @@ int FitTest(int argc, char *argv[],KinKal::DVEC const& sigmas) {
     fitpl->SetLineColor(kBlue);
     fitpl->SetLineStyle(kSolid);
     double ts = fptraj.range().range()/(np-1);
-    for(unsigned ip=0;ip<np;ip++){
-      double tp = fptraj.range().begin() + ip*ts;
-      VEC3 ppos = fptraj.position3(tp);
-      fitpl->SetPoint(ip,ppos.X(),ppos.Y(),ppos.Z());
-    }
+    std::vector<double> tps(np);
+    for(unsigned ip=0;ip<np;ip++) tps[ip] = fptraj.range().begin() + ip*ts;
+    std::vector<VEC3> ppos;
+    fptraj.positions(tps,ppos);
+    for(unsigned ip=0;ip<np;ip++) fitpl->SetPoint(ip,ppos[ip].X(),ppos[ip].Y(),ppos[ip].Z());
     fitpl->Draw();
 // now draw the truth
     TPolyLine3D* ttpl = new TPolyLine3D(np);
     ttpl->SetLineColor(kGreen);
     ttpl->SetLineStyle(kDashDotted);
     ts = tptraj.range().range()/(np-1);
-    for(unsigned ip=0;ip<np;ip++){
-      double tp = tptraj.range().begin() + ip*ts;
-      VEC3 ppos = tptraj.position3(tp);
-      ttpl->SetPoint(ip,ppos.X(),ppos.Y(),ppos.Z());
-    }
+    for(unsigned ip=0;ip<np;ip++) tps[ip] = tptraj.range().begin() + ip*ts;
+    tptraj.positions(tps,ppos);
+    for(unsigned ip=0;ip<np;ip++) ttpl->SetPoint(ip,ppos[ip].X(),ppos[ip].Y(),ppos[ip].Z());
     ttpl->Draw();
     // draw the hits
     std::vector<TPolyLine3D*> htpls;
@@ -589,6 +629,22 @@ int FitTest(int argc, char *argv[],KinKal::DVEC const& sigmas) {
     TH1F* bmompull = new TH1F("bmompull","Back Momentum Pull;#Delta P/#sigma _{p}",100,-nsig,nsig);
     double duration (0.0);
     unsigned nfail(0), ndiv(0);
+    // optionally record the front fit parameters, or compare them with a previous record of the same events (ie with a different build)
+    std::ofstream wpars;
+    std::ifstream cpars;
+    if(wparfile.size() > 0){
+      wpars.open(wparfile);
+      wpars << std::setprecision(17);
+    }
+    if(cparfile.size() > 0){
+      cpars.open(cparfile);
+      if(!cpars.is_open()){
+	cout << "Can't open parameter file " << cparfile << endl;
+	exit(EXIT_FAILURE);
+      }
+    }
+    unsigned ncompare(0), nstatdiff(0);
+    double maxdpar(0.0), maxderr(0.0);
 
     config.plevel_ = Config::none;
     for(unsigned ievent=0;ievent<nevents;ievent++){
@@ -648,6 +704,7 @@ int FitTest(int argc, char *argv[],KinKal::DVEC const& sigmas) {
       minfovec.clear();
       tinfovec.clear();
       statush->Fill(fstat.status_);
+      Parameters fitpars; // front fit parameters
       if(fstat.usable()){
 	// truth parameters, front and back
 	double ttlow = tptraj.range().begin();
@@ -777,6 +834,7 @@ int FitTest(int argc, char *argv[],KinKal::DVEC const& sigmas) {
 	KTRAJ bftraj(fptraj.stateEstimate(fthigh),tptraj.bnom(tthigh),fptraj.nearestPiece(fthigh).range());
 	// fit parameters
 	auto const& ffpars = fftraj.params();
+	fitpars = ffpars;
 	auto const& mfpars = mftraj.params();
 	auto const& bfpars = bftraj.params();
 	double maxgap, avgap;
@@ -853,6 +911,40 @@ int FitTest(int argc, char *argv[],KinKal::DVEC const& sigmas) {
 	kktrk.print(cout,detail);
       }
       if(ttree)ftree->Fill();
+      if(wpars.is_open()){
+	wpars << ievent << " " << fstat.usable();
+	for(size_t ipar=0;ipar<NParams();ipar++) wpars << " " << fitpars.parameters()[ipar] << " " << sqrt(fitpars.covariance()(ipar,ipar));
+	wpars << endl;
+      }
+      if(cpars.is_open()){
+	unsigned cevent;
+	bool cusable;
+	std::array<double,NParams()> cpar, cerr;
+	cpars >> cevent >> cusable;
+	for(size_t ipar=0;ipar<NParams();ipar++) cpars >> cpar[ipar] >> cerr[ipar];
+	if(cpars.fail() || cevent != ievent){
+	  cout << "Parameter file " << cparfile << " doesn't match these events" << endl;
+	  exit(EXIT_FAILURE);
+	}
+	if(cusable != fstat.usable())
+	  nstatdiff++;
+	else if(cusable){
+	  ncompare++;
+	  for(size_t ipar=0;ipar<NParams();ipar++){
+	    maxdpar = std::max(maxdpar,fabs(fitpars.parameters()[ipar]-cpar[ipar])/cerr[ipar]);
+	    maxderr = std::max(maxderr,fabs(sqrt(fitpars.covariance()(ipar,ipar))/cerr[ipar]-1.0));
+	  }
+	}
+      }
+    }
+    // Test agreement with the reference parameters
+    if(cpars.is_open()){
+      cout << "Compared " << ncompare << " fits with " << cparfile << ": max parameter difference " << maxdpar
+	<< " sigma, max relative error difference " << maxderr << ", " << nstatdiff << " fits with different status" << endl;
+      if(maxdpar > partol || maxderr > partol || nstatdiff > 0.01*nevents){
+	cout << "Parameters differ from " << cparfile << " beyond tolerance " << partol << endl;
+	retval = -4;
+      }
     }
 // Test fit success
     cout << nfail << " Failed fits and " << ndiv << " Diverged fits " << endl;
@@ -908,6 +1000,14 @@ int FitTest(int argc, char *argv[],KinKal::DVEC const& sigmas) {
       retval=-3;	
     }
     bdpcan->Write();
+    // record the pull fits, to optionally write them or compare them with a reference (ie a fit without approximations)
+    vector<string> pullnames;
+    vector<double> pullmeans, pullsigmas;
+    auto recordPull = [&pullnames,&pullmeans,&pullsigmas](string const& pname, TFitResultPtr pfitr) {
+      pullnames.push_back(pname);
+      pullmeans.push_back(pfitr->Parameter(1));
+      pullsigmas.push_back(pfitr->Parameter(2));
+    };
     TCanvas* fpullcan = new TCanvas("fpullcan","fpullcan",800,600);
     fpullcan->Divide(3,3);
     for(size_t ipar=0;ipar<NParams();++ipar){
@@ -918,28 +1018,58 @@ int FitTest(int argc, char *argv[],KinKal::DVEC const& sigmas) {
 	  << fpfitr->Parameter(1) << " +- " << fpfitr->Error(1) << " sigma " << fpfitr->Parameter(2) << endl;
 	retval=-3;	
       }
+      recordPull(string("fp") + KTRAJ::paramName(static_cast<typename KTRAJ::ParamIndex>(ipar)),fpfitr);
     }
     fpullcan->cd(NParams()+1);
-    fmompull->Fit("gaus","q");
+    recordPull("fmompull",fmompull->Fit("gaus","qS"));
     fpullcan->Write();
     TCanvas* mpullcan = new TCanvas("mpullcan","mpullcan",800,600);
     mpullcan->Divide(3,3);
     for(size_t ipar=0;ipar<NParams();++ipar){
       mpullcan->cd(ipar+1);
-      mpull[ipar]->Fit("gaus","q");
+      recordPull(string("mp") + KTRAJ::paramName(static_cast<typename KTRAJ::ParamIndex>(ipar)),mpull[ipar]->Fit("gaus","qS"));
     }
     mpullcan->cd(NParams()+1);
-    fmompull->Fit("gaus","q");
+    recordPull("mmompull",mmompull->Fit("gaus","qS"));
     mpullcan->Write();
     TCanvas* bpullcan = new TCanvas("bpullcan","bpullcan",800,600);
     bpullcan->Divide(3,3);
     for(size_t ipar=0;ipar<NParams();++ipar){
       bpullcan->cd(ipar+1);
-      bpull[ipar]->Fit("gaus","q");
+      recordPull(string("bp") + KTRAJ::paramName(static_cast<typename KTRAJ::ParamIndex>(ipar)),bpull[ipar]->Fit("gaus","qS"));
     }
     bpullcan->cd(NParams()+1);
-    bmompull->Fit("gaus","q");
+    recordPull("bmompull",bmompull->Fit("gaus","qS"));
     bpullcan->Write();
+    if(wpullfile.size() > 0){
+      ofstream wpulls(wpullfile);
+      wpulls << setprecision(8);
+      for(size_t ipull=0;ipull<pullnames.size();ipull++) wpulls << pullnames[ipull] << " " << pullmeans[ipull] << " " << pullsigmas[ipull] << endl;
+    }
+    if(cpullfile.size() > 0){
+      ifstream cpulls(cpullfile);
+      double maxdmean(0.0), maxdsigma(0.0);
+      string maxpull;
+      for(size_t ipull=0;ipull<pullnames.size();ipull++){
+	string cname;
+	double cmean, csigma;
+	cpulls >> cname >> cmean >> csigma;
+	if(cpulls.fail() || cname != pullnames[ipull]){
+	  cout << "Pull file " << cpullfile << " doesn't match these pulls" << endl;
+	  exit(EXIT_FAILURE);
+	}
+	maxdmean = std::max(maxdmean,fabs(pullmeans[ipull]-cmean));
+	if(fabs(pullsigmas[ipull]/csigma-1.0) > maxdsigma){
+	  maxdsigma = fabs(pullsigmas[ipull]/csigma-1.0);
+	  maxpull = pullnames[ipull];
+	}
+      }
+      cout << "Compared pulls with " << cpullfile << ": max mean difference " << maxdmean << ", max relative width difference " << maxdsigma << " (" << maxpull << ")" << endl;
+      if(maxdmean > pulltol || maxdsigma > pulltol){
+	cout << "Pulls differ from " << cpullfile << " beyond tolerance " << pulltol << endl;
+	retval = -3;
+      }
+    }
     TCanvas* perrcan = new TCanvas("perrcan","perrcan",800,600);
     perrcan->Divide(3,2);
     for(size_t ipar=0;ipar<NParams();++ipar){
@@ -49,7 +49,7 @@ using namespace std;
 using KinKal::Line;
 
 void print_usage() {
-  printf("Usage: HitTest  --momentum f --particle i --charge i --strawhit i --scinthit i --zrange f --nhits i --hres f --seed i --ambigdoca f --By f --Bgrad f --simmat_ i --prec f\n");
+  printf("Usage: HitTest  --momentum f --particle i --charge i --strawhit i --scinthit i --zrange f --nhits i --hres f --seed i --ambigdoca f --By f --Bgrad f --simmat_ i --prec f --planarhit i\n");
 }
 
 template <class KTRAJ>
@@ -68,6 +68,8 @@ int HitTest(int argc, char **argv, const vector<double>& delpars) {
   using SCINTHITPTR = std::shared_ptr<SCINTHIT>;
   using STRAWXING = StrawXing<KTRAJ>;
   using STRAWXINGPTR = shared_ptr<STRAWXING>;
+  using PLANARHIT = PlanarHit<KTRAJ>;
+  using PLANARHITPTR = shared_ptr<PLANARHIT>;
 
   int status = 0;
 
@@ -80,7 +82,7 @@ int HitTest(int argc, char **argv, const vector<double>& delpars) {
   unsigned nhits(40);
   int iseed(124223);
   double Bgrad(0.0), By(0.0);
-  bool simmat_(true), scinthit_(true), strawhit_(true);
+  bool simmat_(true), scinthit_(true), strawhit_(true), planarhit_(false);
   double precision(1e-8);
   double zrange(3000.0); // tracker dimension
 
@@ -99,6 +101,7 @@ int HitTest(int argc, char **argv, const vector<double>& delpars) {
     {"By",     required_argument, 0, 'y'  },
     {"Bgrad",     required_argument, 0, 'g'  },
     {"prec",     required_argument, 0, 'P'  },
+    {"planarhit",     required_argument, 0, 'L'  },
     {NULL, 0,0,0}
   };
 
@@ -132,6 +135,8 @@ int HitTest(int argc, char **argv, const vector<double>& delpars) {
 		 break;
       case 'g' : Bgrad = atof(optarg);
 		 break;
+      case 'L' : planarhit_ = atoi(optarg);
+		 break;
       default: print_usage();
 	       exit(EXIT_FAILURE);
     }
@@ -150,6 +155,7 @@ int HitTest(int argc, char **argv, const vector<double>& delpars) {
   }
   KKTest::ToyMC<KTRAJ> toy(*BF, mom, icharge, zrange, iseed, nhits, simmat_, scinthit_,false, ambigdoca, pmass );
   toy.setInefficiency(0.0);
+  toy.setPlanar(planarhit_);
   PKTRAJ tptraj;
 //  cout << "True " << tptraj << endl;
   StrawMaterial const& smat = toy.strawMaterial();
@@ -179,25 +185,42 @@ int HitTest(int argc, char **argv, const vector<double>& delpars) {
   hel->Draw();
   unsigned ihit(0);
   StrawXingConfig sxconfig(toy.strawMaterial().strawRadius()*0.05,1.0);
+  // hits query the field through a cache; without tolerance this queries the map directly
+  BFieldCache fcache(*BF);
+  // tabulated drift model, which should reproduce the straw hit drift calculation
+  toy.useDriftTable(32,9);
+  auto const& dtable = toy.driftTable();
   for(auto& thit : thits) {
     Residual res;
     ClosestApproachData tpdata;
     STRAWHIT* strawhit = dynamic_cast<STRAWHIT*>(thit.get());
     SCINTHIT* scinthit = dynamic_cast<SCINTHIT*>(thit.get());
+    PLANARHIT* planarhit = dynamic_cast<PLANARHIT*>(thit.get());
     if(strawhit && strawhit_){
-      strawhit->update(tptraj);
+      strawhit->update(tptraj,fcache);
       res = strawhit->residual(0);
       tpdata = strawhit->closestApproach();
+      strawhit->setDriftTable(dtable);
+      strawhit->update(tptraj,fcache);
+      if(fabs(strawhit->residual(0).value()-res.value()) > 1e-6 || fabs(strawhit->residual(0).variance()-res.variance()) > 1e-6){
+	cout << "DriftTable residual mismatch " << strawhit->residual(0) << " " << res << endl;
+	status = 3;
+      }
+      strawhit->setDriftTable(nullptr);
     } else if(scinthit && scinthit_){
-      scinthit->update(tptraj);
+      scinthit->update(tptraj,fcache);
       res = scinthit->residual(0);
       tpdata = scinthit->closestApproach();
+    } else if(planarhit && planarhit_){
+      planarhit->update(tptraj,fcache);
+      res = planarhit->residual(0);
     } else
       continue;
     TPolyLine3D* line = new TPolyLine3D(2);
     VEC3 plow, phigh;
     STRAWHITPTR shptr = std::dynamic_pointer_cast<STRAWHIT> (thit); 
     SCINTHITPTR lhptr = std::dynamic_pointer_cast<SCINTHIT> (thit);
+    PLANARHITPTR phptr = std::dynamic_pointer_cast<PLANARHIT> (thit);
     if((bool)shptr){
       auto const& tline = shptr->wire();
       plow = tline.position3(tline.range().begin());
@@ -208,6 +231,11 @@ int HitTest(int argc, char **argv, const vector<double>& delpars) {
       plow = tline.position3(tline.range().begin());
       phigh = tline.position3(tline.range().end());
       line->SetLineColor(kCyan);
+    } else if ((bool)phptr){
+      // draw the plane normal at the crossing
+      plow = phptr->crossingPosition();
+      phigh = plow + 10.0*phptr->plane().normal();
+      line->SetLineColor(kGreen);
     }
     line->SetPoint(0,plow.X(),plow.Y(), plow.Z());
     line->SetPoint(1,phigh.X(),phigh.Y(), phigh.Z());
@@ -254,17 +282,20 @@ int HitTest(int argc, char **argv, const vector<double>& delpars) {
   unsigned ipt(0);
   //  cout << tptraj << endl;
   for(auto& thit : thits) {
-    KKHIT kkhit(thit,tptraj,precision);
+    KKHIT kkhit(thit,tptraj,fcache,precision);
     Residual ores;
     ClosestApproachData tpdata;
     STRAWHIT* strawhit = dynamic_cast<STRAWHIT*>(thit.get());
     SCINTHIT* scinthit = dynamic_cast<SCINTHIT*>(thit.get());
+    PLANARHIT* planarhit = dynamic_cast<PLANARHIT*>(thit.get());
     if(strawhit && strawhit_){
       ores = strawhit->residual(0);
       tpdata = strawhit->closestApproach();
     } else if(scinthit && scinthit_){
       ores = scinthit->residual(0);
       tpdata = scinthit->closestApproach();
+    } else if(planarhit && planarhit_){
+      ores = planarhit->residual(0);
     } else
       continue;
     auto pder = ores.dRdP();
@@ -276,7 +307,9 @@ int HitTest(int argc, char **argv, const vector<double>& delpars) {
 	  double dpar = delpars[ipar]*(-0.5 + double(istep)/double(nsteps));
 	  // modify the helix
 	  KTRAJ modktraj = tptraj.nearestPiece(kkhit.time());
-	  modktraj.params().parameters()[ipar] += dpar;
+	  KinKal::DVEC modpars = modktraj.params().parameters();
+	  modpars[ipar] += dpar;
+	  modktraj.setParameters(modpars);
 	  PKTRAJ modtptraj(modktraj);
 	  KinKal::DVEC dpvec;
 	  dpvec[ipar] = dpar;
@@ -286,6 +319,8 @@ int HitTest(int argc, char **argv, const vector<double>& delpars) {
 	    mres = strawhit->residual(0);
 	  } else if(scinthit) {
 	    mres = scinthit->residual(0);
+	  } else if(planarhit) {
+	    mres = planarhit->residual(0);
 	  }
 	  double dr = ores.value()-mres.value(); // this sign is confusing.  I think
 	  // it means the fit needs to know how much to change the ref parameters, which is
@@ -12,6 +12,10 @@ int main(int argc, char **argv) {
     arguments.push_back("2"); // local field correction (BField rotation)
     arguments.push_back("--tolerance");
     arguments.push_back("0.01");  // still not clear why this needs to be so low TODO
+#ifdef KINKAL_FLOAT_CACHE
+    arguments.push_back("--TFilesuffix");
+    arguments.push_back("Float"); // don't overwrite the default precision test output
+#endif
     std::vector<char*> myargv;
     for (const auto& arg : arguments)
       myargv.push_back((char*)arg.data());
@@ -0,0 +1,118 @@
+//
+// test the PTCA loop search enabled through the meta-iteration schedule.  Identical toy events are fit starting from
+// smeared seeds without and with the search, counting failed fits and wire hits whose final TOCA is on a different loop
+// than the true one (PTCA converging on the wrong loop).  The search must reduce both
+//
+#include "KinKal/Tests/ToyFitSetup.hh"
+#include "KinKal/Fit/Track.hh"
+
+#include <iostream>
+#include <stdio.h>
+#include <getopt.h>
+#include <string>
+
+using namespace KinKal;
+using namespace std;
+
+void print_usage() {
+  printf("Usage: LoopSearch --nevents i --seedsmear f --nloops i --seed i --Schedule s\n");
+}
+
+struct LoopSearchResult {
+  unsigned nfail_ = 0; // failed fits
+  unsigned nwrong_ = 0; // wire hits whose TOCA is on the wrong loop
+  unsigned nhits_ = 0; // wire hits
+};
+
+template <class KTRAJ> LoopSearchResult fitEvents(Config config, BFieldMap const& bfield, double seedsmear, unsigned nloops,
+    unsigned nevents, unsigned iseed) {
+  using PKTRAJ = ParticleTrajectory<KTRAJ>;
+  using HIT = Hit<KTRAJ>;
+  using HITCOL = vector<std::shared_ptr<HIT>>;
+  using EXING = ElementXing<KTRAJ>;
+  using EXINGCOL = vector<std::shared_ptr<EXING>>;
+  using WIREHIT = WireHit<KTRAJ>;
+  using PTCA = PiecewiseClosestApproach<KTRAJ,Line>;
+  using KKTRK = Track<KTRAJ>;
+  // the same events and seeds are generated for each search setting
+  auto toy = KKTest::toyMC<KTRAJ>(bfield, iseed);
+  for(auto& mconfig : config.schedule_) mconfig.tcanloops_ = nloops;
+  LoopSearchResult result;
+  for(unsigned ievent=0; ievent < nevents; ievent++){
+    PKTRAJ tptraj;
+    HITCOL thits;
+    EXINGCOL dxings;
+    toy.simulateParticle(tptraj, thits, dxings);
+    auto seedtraj = KKTest::toySeed(toy, bfield, tptraj, seedsmear);
+    KKTRK kktrk(config, bfield, seedtraj, thits, dxings);
+    if(!kktrk.fitStatus().usable())result.nfail_++;
+    for(auto const& hit : thits){
+      auto whit = dynamic_cast<WIREHIT const*>(hit.get());
+      if(whit == 0 || !whit->closestApproach().usable())continue;
+      result.nhits_++;
+      // the true TOCA is the closest approach on the true trajectory, searching the neighboring loops
+      auto const& tpdata = whit->closestApproach();
+      PTCA tpoca(tptraj, whit->wire(), CAHint(tpdata.particleToca(), tpdata.sensorToca()), 1e-6, 3);
+      if(tpoca.usable() && fabs(tpoca.particleToca()-tpdata.particleToca()) > 0.5*tpoca.loopPeriod())result.nwrong_++;
+    }
+  }
+  cout << KTRAJ::trajName() << " seed smear " << seedsmear << " loop search " << nloops << ": " << result.nfail_ << " failed fits of "
+    << nevents << ", " << result.nwrong_ << " wrong-loop hits of " << result.nhits_ << endl;
+  return result;
+}
+
+int main(int argc, char **argv) {
+  int opt;
+  unsigned nevents(200), nloops(1), iseed(1234);
+  double seedsmear(5.0);
+  string sfile("Schedule.txt");
+  int status(0);
+
+  static struct option long_options[] = {
+    {"nevents",     required_argument, 0, 'n'  },
+    {"seedsmear",     required_argument, 0, 's'  },
+    {"nloops",     required_argument, 0, 'l'  },
+    {"seed",     required_argument, 0, 'S'  },
+    {"Schedule",     required_argument, 0, 'u'  },
+    {NULL, 0,0,0}
+  };
+
+  int long_index =0;
+  while ((opt = getopt_long_only(argc, argv,"",
+	  long_options, &long_index )) != -1) {
+    switch (opt) {
+      case 'n' : nevents = atoi(optarg);
+		 break;
+      case 's' : seedsmear = atof(optarg);
+		 break;
+      case 'l' : nloops = atoi(optarg);
+		 break;
+      case 'S' : iseed = atoi(optarg);
+		 break;
+      case 'u' : sfile = string(optarg);
+		 break;
+      default: print_usage();
+	       exit(EXIT_FAILURE);
+    }
+  }
+  Config config;
+  if(!KKTest::toyConfig(config,sfile))return -1;
+  UniformBFieldMap bfield(1.0);
+  auto lhnosearch = fitEvents<LoopHelix>(config, bfield, seedsmear, 0, nevents, iseed);
+  auto lhsearch = fitEvents<LoopHelix>(config, bfield, seedsmear, nloops, nevents, iseed);
+  auto chnosearch = fitEvents<CentralHelix>(config, bfield, seedsmear, 0, nevents, iseed);
+  auto chsearch = fitEvents<CentralHelix>(config, bfield, seedsmear, nloops, nevents, iseed);
+  // the loop search should never make things worse, and should reduce the failures and wrong-loop hits overall
+  if(lhsearch.nfail_ > lhnosearch.nfail_ || chsearch.nfail_ > chnosearch.nfail_ ||
+      lhsearch.nfail_ + chsearch.nfail_ >= lhnosearch.nfail_ + chnosearch.nfail_){
+    cout << "Loop search doesn't reduce fit failures" << endl;
+    status = -1;
+  }
+  if(lhsearch.nwrong_ > lhnosearch.nwrong_ || chsearch.nwrong_ > chnosearch.nwrong_ ||
+      lhsearch.nwrong_ + chsearch.nwrong_ >= lhnosearch.nwrong_ + chnosearch.nwrong_){
+    cout << "Loop search doesn't reduce wrong-loop hits" << endl;
+    status = -2;
+  }
+  cout << "Exiting with status " << status << endl;
+  return status;
+}
@@ -0,0 +1,203 @@
+//
+// test MultiHypothesisTrack against independent Track fits of each hypothesis on the same toy events.  The independent fits use clones
+// of the hits and crossings taken before any fit, so no state is shared.  The shared fits must converge as often, to the same
+// parameters and chisquared, each hypothesis' hits must describe its own fit trajectory, and the subsequent hypotheses must take
+// fewer iterations than the independent fits.  Events are tested first without material: the fits then only depend on the final
+// hit states, so the results must agree closely.  With material the shared fits are approximate, as the crossings are only updated at the
+// start of each meta-iteration: the last meta-iteration of an independent fit uses crossings from its previous (annealed) fit, while
+// the shared fit uses crossings from the primary fit.  The rate of refits with the full schedule is reported
+//
+#include "KinKal/Tests/ToyFitSetup.hh"
+#include "KinKal/Fit/Track.hh"
+#include "KinKal/Fit/MultiHypothesisTrack.hh"
+#include "KinKal/Detector/WireHit.hh"
+
+#include <iostream>
+#include <stdio.h>
+#include <getopt.h>
+#include <string>
+#include <cmath>
+#include <vector>
+#include <chrono>
+
+using namespace KinKal;
+using namespace std;
+
+void print_usage() {
+  printf("Usage: MultiHypothesisTrack --nevents i --momentum f --simmass f --lighthit i --seedsmear f --seed i --tol f --chitol f --mattol f --matchitol f --ttol f --Schedule s\n");
+}
+
+template <class KTRAJ> int testHypotheses(Config const& config, BFieldMap const& bfield, double mom, double simmass, bool lighthit, bool addmat,
+    double seedsmear, unsigned nevents, unsigned iseed, double tol, double chitol, double ttol) {
+  using Clock = std::chrono::high_resolution_clock;
+  using PKTRAJ = ParticleTrajectory<KTRAJ>;
+  using HIT = Hit<KTRAJ>;
+  using HITCOL = vector<std::shared_ptr<HIT>>;
+  using EXING = ElementXing<KTRAJ>;
+  using EXINGCOL = vector<std::shared_ptr<EXING>>;
+  using WIREHIT = WireHit<KTRAJ>;
+  using PTCA = PiecewiseClosestApproach<KTRAJ,Line>;
+  using KKTRK = Track<KTRAJ>;
+  using KKMHT = MultiHypothesisTrack<KTRAJ>;
+  std::vector<double> masses = {0.511,105.66,139.57}; // e, mu, pi
+  size_t nhyp = masses.size();
+  auto toy = KKTest::toyMC<KTRAJ>(bfield, iseed, mom, simmass, addmat, lighthit);
+  unsigned nfit(0), ndiff(0), nstate(0);
+  vector<unsigned> indfail(nhyp,0), mhtfail(nhyp,0), mhtrefit(nhyp,0);
+  unsigned inditer(0), mhtiter(0); // iterations of the subsequent hypotheses
+  double indtime(0.0), mhttime(0.0), maxdpar(0.0), maxdchi(0.0), maxdt(0.0);
+  for(unsigned ievent=0; ievent < nevents; ievent++){
+    PKTRAJ tptraj;
+    HITCOL thits;
+    EXINGCOL dxings;
+    toy.simulateParticle(tptraj, thits, dxings, addmat);
+    auto seedtraj = KKTest::toySeed(toy, bfield, tptraj, seedsmear);
+    // independent fits, each with its own copy of the unfit hits and crossings
+    vector<std::unique_ptr<KKTRK>> tracks;
+    for(size_t ihyp=0; ihyp < nhyp; ihyp++){
+      HITCOL hits;
+      EXINGCOL xings;
+      for(auto const& hit : thits) hits.emplace_back(hit->clone());
+      for(auto const& xing : dxings) xings.emplace_back(xing->clone());
+      auto mom = seedtraj.momentum4(seedtraj.range().mid());
+      mom.SetM(masses[ihyp]);
+      KTRAJ hypseed(seedtraj.position4(seedtraj.range().mid()),mom,seedtraj.charge(),seedtraj.bnom(),seedtraj.range());
+      hypseed.setCovariance(seedtraj.params().covariance());
+      auto start = Clock::now();
+      tracks.emplace_back(new KKTRK(config, bfield, hypseed, hits, xings));
+      indtime += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()*1.0e-9;
+      if(ihyp > 0) inditer += tracks.back()->history().size();
+    }
+    auto start = Clock::now();
+    KKMHT mht(config, bfield, seedtraj, masses, thits, dxings);
+    mhttime += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()*1.0e-9;
+    for(size_t ihyp=1; ihyp < nhyp; ihyp++) mhtiter += mht.track(ihyp).history().size();
+    for(size_t ihyp=0; ihyp < nhyp; ihyp++){
+      nfit++;
+      auto const& trk = *tracks[ihyp];
+      auto const& mtrk = mht.track(ihyp);
+      if(!trk.fitStatus().usable()) indfail[ihyp]++;
+      if(!mtrk.fitStatus().usable()) mhtfail[ihyp]++;
+      if(mht.refit(ihyp)) mhtrefit[ihyp]++;
+      if(!trk.fitStatus().usable() || !mtrk.fitStatus().usable()) continue;
+      // compare the parameters at both ends, normalized by the fit errors.  Angles are equivalent modulo 2pi
+      double dpar(0.0);
+      for(auto const& [fpars,mpars] : {std::make_pair(trk.fitTraj().front().params(),mtrk.fitTraj().front().params()),
+	  std::make_pair(trk.fitTraj().back().params(),mtrk.fitTraj().back().params())}){
+	for(size_t ipar=0; ipar < NParams(); ipar++){
+	  double dp = fpars.parameters()(ipar)-mpars.parameters()(ipar);
+	  if(KTRAJ::paramUnit(typename KTRAJ::ParamIndex(ipar)).compare(0,3,"rad") == 0) dp = remainder(dp,2.0*M_PI);
+	  dpar = std::max(dpar,fabs(dp)/sqrt(fpars.covariance()(ipar,ipar)));
+	}
+      }
+      double dchi = fabs(trk.fitStatus().chisq_.chisq()-mtrk.fitStatus().chisq_.chisq())/std::max(1.0,trk.fitStatus().chisq_.chisq());
+      maxdpar = std::max(maxdpar,dpar);
+      maxdchi = std::max(maxdchi,dchi);
+      if(dpar > tol || dchi > chitol || trk.fitStatus().chisq_.nDOF() != mtrk.fitStatus().chisq_.nDOF()){
+	cout << KTRAJ::trajName() << " event " << ievent << " mass " << masses[ihyp] << " shared fit differs: parameters " << dpar
+	  << " sigma, chisquared " << trk.fitStatus().chisq_ << " shared " << mtrk.fitStatus().chisq_ << endl;
+	ndiff++;
+      }
+      // the wire hits of each hypothesis must be at the closest approach to that hypothesis' fit
+      double dtmax(0.0);
+      for(auto const& hit : mht.hits(ihyp)){
+	auto const* whit = dynamic_cast<WIREHIT const*>(hit.get());
+	if(whit == 0)continue;
+	CAHint tphint(whit->closestApproach().particleToca(),whit->closestApproach().sensorToca());
+	PTCA tpoca(mtrk.fitTraj(),whit->wire(),tphint,1e-6);
+	if(tpoca.usable()) dtmax = std::max(dtmax,fabs(tpoca.particleToca()-whit->time()));
+      }
+      maxdt = std::max(maxdt,dtmax);
+      if(dtmax > ttol){
+	cout << KTRAJ::trajName() << " event " << ievent << " mass " << masses[ihyp] << " hit state doesn't match the fit: dt " << dtmax << endl;
+	nstate++;
+      }
+    }
+  }
+  cout << KTRAJ::trajName() << (addmat ? " with" : " without") << " material " << nfit << " fits: " << ndiff << " differ from independent fits, "
+    << nstate << " have inconsistent hit state; max parameter difference " << maxdpar << " sigma, max relative chisquared difference " << maxdchi
+    << ", max hit time difference " << maxdt << " ns" << endl;
+  int status(0);
+  for(size_t ihyp=0; ihyp < nhyp; ihyp++){
+    cout << KTRAJ::trajName() << " mass " << masses[ihyp] << " failures: independent " << indfail[ihyp] << " shared " << mhtfail[ihyp]
+      << ", refits with the full schedule " << mhtrefit[ihyp] << "/" << nevents << endl;
+    if(mhtfail[ihyp] > indfail[ihyp] + nevents/50) status = -2;
+  }
+  cout << KTRAJ::trajName() << " subsequent hypotheses: independent " << inditer << " iterations, shared " << mhtiter
+    << "; all hypotheses: independent " << indtime << " s, shared " << mhttime << " s" << endl;
+  if(ndiff > 0 || nstate > 0) status = -1;
+  if(mhtiter >= inditer) status = -3;
+  return status;
+}
+
+int main(int argc, char **argv) {
+  int opt;
+  unsigned nevents(100), iseed(5678);
+  // a momentum at which all the hypotheses fit the events
+  double mom(500.0), simmass(0.511);
+  bool lighthit(true);
+  double seedsmear(1.0), tol(0.01), chitol(1.0e-3), mattol(1.5), matchitol(0.2), ttol(0.1);
+  string sfile("Schedule.txt");
+  int status(0);
+
+  static struct option long_options[] = {
+    {"nevents",     required_argument, 0, 'n'  },
+    {"momentum",     required_argument, 0, 'm'  },
+    {"simmass",     required_argument, 0, 'M'  },
+    {"lighthit",     required_argument, 0, 'l'  },
+    {"seedsmear",     required_argument, 0, 's'  },
+    {"seed",     required_argument, 0, 'S'  },
+    {"tol",     required_argument, 0, 't'  },
+    {"chitol",     required_argument, 0, 'c'  },
+    {"mattol",     required_argument, 0, 'x'  },
+    {"matchitol",     required_argument, 0, 'X'  },
+    {"ttol",     required_argument, 0, 'T'  },
+    {"Schedule",     required_argument, 0, 'u'  },
+    {NULL, 0,0,0}
+  };
+
+  int long_index =0;
+  while ((opt = getopt_long_only(argc, argv,"",
+	  long_options, &long_index )) != -1) {
+    switch (opt) {
+      case 'n' : nevents = atoi(optarg);
+		 break;
+      case 'm' : mom = atof(optarg);
+		 break;
+      case 'M' : simmass = atof(optarg);
+		 break;
+      case 'l' : lighthit = atoi(optarg) > 0;
+		 break;
+      case 's' : seedsmear = atof(optarg);
+		 break;
+      case 'S' : iseed = atoi(optarg);
+		 break;
+      case 't' : tol = atof(optarg);
+		 break;
+      case 'c' : chitol = atof(optarg);
+		 break;
+      case 'x' : mattol = atof(optarg);
+		 break;
+      case 'X' : matchitol = atof(optarg);
+		 break;
+      case 'T' : ttol = atof(optarg);
+		 break;
+      case 'u' : sfile = string(optarg);
+		 break;
+      default: print_usage();
+	       exit(EXIT_FAILURE);
+    }
+  }
+  Config config;
+  if(!KKTest::toyConfig(config,sfile))return -1;
+  UniformBFieldMap bfield(1.0);
+  for(bool addmat : {false, true}){
+    double ptol = addmat ? mattol : tol;
+    double ctol = addmat ? matchitol : chitol;
+    int lhstatus = testHypotheses<LoopHelix>(config, bfield, mom, simmass, lighthit, addmat, seedsmear, nevents, iseed, ptol, ctol, ttol);
+    int chstatus = testHypotheses<CentralHelix>(config, bfield, mom, simmass, lighthit, addmat, seedsmear, nevents, iseed, ptol, ctol, ttol);
+    status = std::min(status,std::min(lhstatus,chstatus));
+  }
+  cout << "Exiting with status " << status << endl;
+  return status;
+}
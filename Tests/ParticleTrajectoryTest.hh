@@ -4,6 +4,7 @@
 #include "KinKal/Trajectory/ParticleTrajectory.hh"
 #include "KinKal/Trajectory/Line.hh"
 #include "KinKal/Trajectory/PiecewiseClosestApproach.hh"
+#include "KinKal/Trajectory/Surface.hh"
 #include "KinKal/Detector/BFieldMap.hh"
 #include "KinKal/General/PhysicalConstants.h"
 
@@ -161,6 +162,63 @@ int ParticleTrajectoryTest(int argc, char **argv) {
   cout << "Final piece traj with " << ptraj.pieces().size() << " pieces and largest gap = "
   << largest << " average gap = " << average << endl;
 
+  // extrapolation test: crossings with planes normal to the field, and a coaxial cylinder through the middle of the trajectory
+  std::vector<Plane> planes;
+  VEC3 fpos = ptraj.position3(ptraj.range().begin());
+  VEC3 bpos = ptraj.position3(ptraj.range().end());
+  for(unsigned iplane=1; iplane < 5; iplane++)
+    planes.emplace_back(fpos + 0.2*iplane*(bpos-fpos).Dot(bnom.Unit())*bnom.Unit(),bnom);
+  Cylinder cyl(VEC3(0.0,0.0,0.0),bnom,ptraj.position3(ptraj.range().mid()).Rho());
+  double xprec(1e-8);
+  auto pxings = ptraj.crossings(planes,ptraj.range().begin(),TimeDir::forwards,xprec);
+  auto cxing = ptraj.crossing(cyl,ptraj.range().begin(),TimeDir::forwards,xprec);
+  auto bxing = ptraj.crossing(planes.back(),ptraj.range().end(),TimeDir::backwards,xprec);
+  double xtol = 10*xprec*ptraj.speed(ptraj.range().mid());
+  for(size_t iplane=0; iplane < planes.size(); iplane++){
+    auto const& pxing = pxings[iplane];
+    if(!pxing.found_ || fabs(planes[iplane].distance(pxing.state_.position3())) > xtol){
+      cout << "Plane crossing failure " << planes[iplane] << " time " << pxing.time_ << endl;
+      return -1;
+    }
+  }
+  if(!cxing.found_ || fabs(cyl.distance(cxing.state_.position3())) > xtol || !bxing.found_ || fabs(bxing.time_-pxings.back().time_) > 10*xprec){
+    cout << "Crossing failure " << cyl << " time " << cxing.time_ << " backwards time " << bxing.time_ << endl;
+    return -1;
+  }
+  // batch state estimates must agree with the individual ones
+  std::vector<double> xtimes;
+  for(auto const& pxing : pxings) xtimes.push_back(pxing.time_);
+  xtimes.push_back(ptraj.range().mid());
+  auto xstates = ptraj.stateEstimates(xtimes);
+  for(size_t itime=0; itime < xtimes.size(); itime++){
+    auto xstate = ptraj.stateEstimate(xtimes[itime]);
+    double dcov(0.0);
+    for(size_t irow=0; irow < 6; irow++)
+      for(size_t icol=0; icol <= irow; icol++)
+	dcov = std::max(dcov,fabs(xstate.stateCovariance()(irow,icol)-xstates[itime].stateCovariance()(irow,icol))/
+	    sqrt(xstate.stateCovariance()(irow,irow)*xstate.stateCovariance()(icol,icol)));
+    if((xstate.position3()-xstates[itime].position3()).R() > 1e-10 || (xstate.momentum3()-xstates[itime].momentum3()).R() > 1e-10 || dcov > 1e-9){
+      cout << "Batch state estimate failure at time " << xtimes[itime] << endl;
+      return -1;
+    }
+  }
+  // batch positions and directions must agree with the individual ones, including for unordered times
+  std::vector<double> btimes;
+  for(unsigned ipt=0;ipt<npts*ptraj.pieces().size();ipt++) btimes.push_back(ptraj.range().begin() + ipt*ptraj.range().range()/(npts*ptraj.pieces().size()-1));
+  btimes.insert(btimes.end(),xtimes.begin(),xtimes.end());
+  std::vector<VEC3> bposs, bdirs;
+  ptraj.positions(btimes,bposs);
+  ptraj.directions(btimes,bdirs,MomBasis::perpdir_);
+  for(size_t itime=0; itime < btimes.size(); itime++){
+    if((bposs[itime]-ptraj.position3(btimes[itime])).R() > 1e-10 || (bdirs[itime]-ptraj.direction(btimes[itime],MomBasis::perpdir_)).R() > 1e-10){
+      cout << "Batch position failure at time " << btimes[itime] << endl;
+      return -1;
+    }
+  }
+  cout << "Crossings: cylinder at time " << cxing.time_ << " planes at times";
+  for(auto const& pxing : pxings) cout << " " << pxing.time_;
+  cout << endl;
+
 // draw each piece of the piecetraj
   char fname[100];
   snprintf(fname,100,"ParticleTrajectory_%s_%2.2f.root",MomBasis::directionName(tdir).c_str(),delta);
@@ -248,6 +306,17 @@ int ParticleTrajectoryTest(int argc, char **argv) {
     poca->SetPoint(1,tp.sensorPoca().X() ,tp.sensorPoca().Y() ,tp.sensorPoca().Z());
     poca->SetLineColor(kBlack);
     poca->Draw();
+    // starting a loop away, the loop search must recover the same solution
+    double period = tp.loopPeriod();
+    for(int iloop=-1; iloop <= 1; iloop += 2){
+      CAHint lhint(tp.particleToca()+iloop*period,tp.sensorToca());
+      if(period <= 0.0 || !ptraj.range().inRange(lhint.particleToca_))continue;
+      PTCA ltp(ptraj,tline,lhint,1e-8,1);
+      if(!ltp.usable() || fabs(ltp.doca()-refd) > 1e-6 || fabs(ltp.particleToca()-tp.particleToca()) > 1e-6){
+	cout << "ClosestApproach loop search failure, hint time " << lhint.particleToca_ << " doca " << ltp.doca() << endl;
+	return -1;
+      }
+    }
   }
 
   cout << "ClosestApproach dDdP" << tp.dDdP() << " dTdP " << tp.dTdP() << endl;
@@ -19,9 +19,11 @@ namespace KinKal {
       bool activeRes(unsigned ires=0) const override;
       Residual const& residual(unsigned ires=0) const override;
       double time() const override { return tpdata_.particleToca(); }
-      void update(PKTRAJ const& pktraj) override;
-      void updateState(PKTRAJ const& pktraj, MetaIterConfig const& config) override;
+      void update(PKTRAJ const& pktraj, BFieldCache const& fcache) override;
+      void updateState(PKTRAJ const& pktraj, MetaIterConfig const& config, BFieldCache const& fcache) override;
       void print(std::ostream& ost=std::cout,int detail=0) const override;
+      std::shared_ptr<Hit<KTRAJ>> clone() const override { return std::make_shared<ScintHit>(*this); }
+      void scaleTime(double tref, double tscale) override { tpdata_.partCA_.SetE(tref + (tpdata_.particleToca()-tref)*tscale); }
       // scintHit explicit interface
       ScintHit(Line const& sensorAxis, double tvar, double wvar) : 
 	saxis_(sensorAxis), tvar_(tvar), wvar_(wvar), active_(true), precision_(1e-6) {}
@@ -41,6 +43,7 @@ namespace KinKal {
       // caches
       Residual rresid_; // residual WRT most recent reference parameters
       double precision_; // current precision
+      unsigned maxiter_ = 100, maxpiter_ = 10; // current PTCA iteration limits
   };
 
   template <class KTRAJ> bool ScintHit<KTRAJ>::activeRes(unsigned ires) const {
@@ -55,13 +58,16 @@ namespace KinKal {
     return rresid_;
   }
 
-  template <class KTRAJ> void ScintHit<KTRAJ>::update(PKTRAJ const& pktraj) {
+  template <class KTRAJ> void ScintHit<KTRAJ>::update(PKTRAJ const& pktraj, BFieldCache const& fcache) {
     // compute PTCA
     CAHint tphint( saxis_.t0(), saxis_.t0());
-    // don't update the hint: initial T0 values can be very poor, which can push the CA calculation onto the wrong helix loop,
-    // from which it's impossible to ever get back to the correct one.  Active loop checking might be useful eventually too TODO
-//    if(tpdata_.usable()) tphint = CAHint(tpdata_.particleToca(),tpdata_.sensorToca());
-    PTCA tpoca(pktraj,saxis_,tphint,precision_);
+    PTCA hpoca(pktraj,saxis_,tphint,precision_,0,maxiter_,maxpiter_);
+    // poor T0 values can push the CA calculation onto the wrong helix loop.  The DOCA to an axis parallel to the helix axis
+    // is the same on every loop, so select the loop by time instead, moving by whole turns to match the sensor time
+    double period = hpoca.usable() ? hpoca.loopPeriod() : 0.0;
+    bool wrongloop = period > 0.0 && fabs(hpoca.deltaT()) > 0.5*period;
+    if(wrongloop) tphint = CAHint(hpoca.particleToca() + period*std::round(hpoca.deltaT()/period),hpoca.sensorToca());
+    PTCA tpoca = wrongloop ? PTCA(pktraj,saxis_,tphint,precision_,0,maxiter_,maxpiter_) : hpoca;
     if(tpoca.usable()){
       tpdata_ = tpoca.tpData();
       // residual is just delta-T at CA. 
@@ -74,10 +80,12 @@ namespace KinKal {
       throw std::runtime_error("PTCA failure");
   }
 
-  template <class KTRAJ> void ScintHit<KTRAJ>::updateState(PKTRAJ const& pktraj, MetaIterConfig const& miconfig) {
+  template <class KTRAJ> void ScintHit<KTRAJ>::updateState(PKTRAJ const& pktraj, MetaIterConfig const& miconfig, BFieldCache const& fcache) {
     // for now, no updates are needed.  Eventually could test for consistency, update errors, etc
     precision_ = miconfig.tprec_;
-    update(pktraj);
+    maxiter_ = miconfig.tcamaxiter_;
+    maxpiter_ = miconfig.ptcamaxiter_;
+    update(pktraj,fcache);
   }
 
   template<class KTRAJ> void ScintHit<KTRAJ>::print(std::ostream& ost, int detail) const {
@@ -0,0 +1,143 @@
+//
+// test SeedFinder against the true trajectories of toy events: straws with and without a scintillator hit, and pixel planes.
+// The seed parameters are compared to those of the true trajectory, normalized by the seed sigmas used in the fit tests, so the
+// geometric parameters must be at least as accurate as the smeared seeds those tests start from.  The time origin of straw
+// events is limited by the straw time resolution, so it's compared in ns.  The median difference of each parameter and the
+// fraction of events with large differences are tested
+//
+#include "KinKal/Tests/ToyFitSetup.hh"
+#include "KinKal/Fit/SeedFinder.hh"
+
+#include <iostream>
+#include <stdio.h>
+#include <getopt.h>
+#include <string>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+using namespace KinKal;
+using namespace std;
+
+void print_usage() {
+  printf("Usage: SeedFinder --nevents i --momentum f --seed i --medtol f --ttol f --outlier f --maxout f --maxfail f\n");
+}
+
+struct SeedTest {
+  string name_; // geometry
+  bool planar_; // pixel planes instead of straws
+  bool lighthit_; // add a scintillator hit
+};
+
+template <class KTRAJ> int testSeeds(BFieldMap const& bfield, DVEC const& sigmas, SeedTest const& stest, double mom, unsigned nevents, unsigned iseed,
+    double medtol, double ttol, double outlier, double maxout, double maxfail) {
+  using Clock = std::chrono::high_resolution_clock;
+  using PKTRAJ = ParticleTrajectory<KTRAJ>;
+  using HITCOL = vector<std::shared_ptr<Hit<KTRAJ>>>;
+  using EXINGCOL = vector<std::shared_ptr<ElementXing<KTRAJ>>>;
+  using TOY = KKTest::ToyMC<KTRAJ>;
+  TOY toy(bfield, mom, -1, 3000, iseed, 40, false, stest.lighthit_, false, 0.25, 0.511);
+  toy.setPlanar(stest.planar_);
+  toy.useDriftTable(32,9);
+  std::array<std::vector<double>,NParams()> dpars;
+  unsigned nfail(0), nout(0);
+  double stime(0.0);
+  for(unsigned ievent=0; ievent < nevents; ievent++){
+    PKTRAJ tptraj;
+    HITCOL thits;
+    EXINGCOL dxings;
+    toy.simulateParticle(tptraj, thits, dxings, false);
+    auto const& midhel = tptraj.nearestPiece(tptraj.range().mid());
+    try {
+      auto start = Clock::now();
+      SeedFinder<KTRAJ> sfinder(bfield.fieldVect(midhel.position3(tptraj.range().mid())),midhel.mass(),midhel.charge());
+      sfinder.addHits(thits,&TOY::seedHit);
+      auto seedtraj = sfinder.seed(sigmas);
+      stime += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()*1.0e-9;
+      // the field is uniform and there's no material, so the true trajectory is a single helix
+      auto const& truepars = tptraj.nearestPiece(seedtraj.range().mid()).params().parameters();
+      bool isout(false);
+      for(size_t ipar=0; ipar < NParams(); ipar++){
+	double dpar = seedtraj.params().parameters()[ipar] - truepars[ipar];
+	if(KTRAJ::paramName(static_cast<typename KTRAJ::ParamIndex>(ipar)) == "Phi0") dpar = remainder(dpar,2.0*M_PI);
+	// the time difference is scaled to the time tolerance
+	double scale = ipar == KTRAJ::t0Index() ? ttol/medtol : sigmas[ipar];
+	dpars[ipar].push_back(fabs(dpar)/scale);
+	isout |= dpars[ipar].back() > outlier;
+      }
+      if(isout)nout++;
+    } catch (std::exception const& error) {
+      nfail++;
+    }
+  }
+  int status(0);
+  unsigned nseed = nevents - nfail;
+  cout << KTRAJ::trajName() << " " << stest.name_ << " " << nevents << " events: " << nfail << " seed failures, " << nout << " with differences above "
+    << outlier << " sigma; " << 1.0e6*stime/std::max(nseed,1u) << " us/seed" << endl;
+  if(nfail > maxfail*nevents || nout > maxout*nseed) status = -1;
+  for(size_t ipar=0; ipar < NParams() && nseed > 0; ipar++){
+    auto& dpar = dpars[ipar];
+    std::nth_element(dpar.begin(),dpar.begin()+dpar.size()/2,dpar.end());
+    double median = dpar[dpar.size()/2];
+    if(ipar == KTRAJ::t0Index())
+      cout << "  " << KTRAJ::paramName(KTRAJ::t0Index()) << " median |seed-true| " << median*ttol/medtol << " ns" << endl;
+    else
+      cout << "  " << KTRAJ::paramName(static_cast<typename KTRAJ::ParamIndex>(ipar)) << " median |seed-true|/sigma " << median << endl;
+    if(median > medtol) status = -1;
+  }
+  return status;
+}
+
+int main(int argc, char **argv) {
+  int opt;
+  unsigned nevents(200), iseed(2468);
+  double mom(105.0), medtol(0.5), ttol(1.0), outlier(5.0), maxout(0.05), maxfail(0.02);
+  int status(0);
+
+  static struct option long_options[] = {
+    {"nevents",     required_argument, 0, 'n'  },
+    {"momentum",     required_argument, 0, 'm'  },
+    {"seed",     required_argument, 0, 'S'  },
+    {"medtol",     required_argument, 0, 't'  },
+    {"ttol",     required_argument, 0, 'T'  },
+    {"outlier",     required_argument, 0, 'o'  },
+    {"maxout",     required_argument, 0, 'O'  },
+    {"maxfail",     required_argument, 0, 'f'  },
+    {NULL, 0,0,0}
+  };
+
+  int long_index =0;
+  while ((opt = getopt_long_only(argc, argv,"",
+	  long_options, &long_index )) != -1) {
+    switch (opt) {
+      case 'n' : nevents = atoi(optarg);
+		 break;
+      case 'm' : mom = atof(optarg);
+		 break;
+      case 'S' : iseed = atoi(optarg);
+		 break;
+      case 't' : medtol = atof(optarg);
+		 break;
+      case 'T' : ttol = atof(optarg);
+		 break;
+      case 'o' : outlier = atof(optarg);
+		 break;
+      case 'O' : maxout = atof(optarg);
+		 break;
+      case 'f' : maxfail = atof(optarg);
+		 break;
+      default: print_usage();
+	       exit(EXIT_FAILURE);
+    }
+  }
+  UniformBFieldMap bfield(1.0);
+  std::vector<SeedTest> stests = {{"straws",false,false},{"straws+scintillator",false,true},{"pixels",true,false}};
+  for(auto const& stest : stests){
+    int lhstatus = testSeeds<LoopHelix>(bfield, KKTest::seedSigmas<LoopHelix>(), stest, mom, nevents, iseed, medtol, ttol, outlier, maxout, maxfail);
+    int chstatus = testSeeds<CentralHelix>(bfield, KKTest::seedSigmas<CentralHelix>(), stest, mom, nevents, iseed, medtol, ttol, outlier, maxout, maxfail);
+    status = std::min(status,std::min(lhstatus,chstatus));
+  }
+  cout << "Exiting with status " << status << endl;
+  return status;
+}
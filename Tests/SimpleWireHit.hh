@@ -21,8 +21,9 @@ namespace KinKal {
       SimpleWireHit(BFieldMap const& bfield, Line const& wire, WireHitState const& whstate,
       double driftspeed, double tvar, double rcell);
 // WireHit and Hit interface implementations
-      void updateState(PKTRAJ const& pktraj, MetaIterConfig const& config) override;
+      void updateState(PKTRAJ const& pktraj, MetaIterConfig const& config, BFieldCache const& fcache) override;
       void distanceToTime(POL2 const& drift, DriftInfo& dinfo) const override;
+      std::shared_ptr<Hit<KTRAJ>> clone() const override { return std::make_shared<SimpleWireHit>(*this); }
       // specific to SimpleWireHit: this has a constant drift speed
       virtual ~SimpleWireHit(){}
       double timeVariance() const { return tvar_; }
@@ -38,11 +39,12 @@ namespace KinKal {
     WIREHIT(bfield,wire,whstate), dvel_(driftspeed), tvar_(tvar), rcell_(rcell) {}
 
 
-  template <class KTRAJ> void SimpleWireHit<KTRAJ>::updateState(PKTRAJ const& pktraj, MetaIterConfig const& miconfig) {
+  template <class KTRAJ> void SimpleWireHit<KTRAJ>::updateState(PKTRAJ const& pktraj, MetaIterConfig const& miconfig, BFieldCache const& fcache) {
     // set precision
     WIREHIT::setPrecision(miconfig.tprec_);
+    WIREHIT::setIterationLimits(miconfig.tcamaxiter_,miconfig.ptcamaxiter_,miconfig.tcanloops_);
     // update to move to the new trajectory
-    this->update(pktraj);
+    this->update(pktraj,fcache);
     // find the wire hit updater in the update params.  There should be 0 or 1
     const SimpleWireHitUpdater* whupdater(0);
     for(auto const& uparams : miconfig.updaters_){
@@ -56,6 +58,8 @@ namespace KinKal {
     if(whupdater != 0){
       // start with existing state
       WireHitState newstate = WIREHIT::hitState();
+      newstate.lrweight_ = 1.0; // hard assignment
+      newstate.altweight_ = 0.0;
       newstate.nullvar_ = whupdater->mindoca_*whupdater->mindoca_/3.0; // RMS of flat distribution beteween +- mindoca
       double doca = fabs(WIREHIT::closestApproach().doca());
       if(fabs(doca) > whupdater->mindoca_){
@@ -72,8 +76,10 @@ namespace KinKal {
       }
       WIREHIT::setHitState(newstate);
       // now update again in case the hit changed
-      this->update(pktraj);
+      this->update(pktraj,fcache);
     }
+    // soft (DAF) ambiguity resolution, if configured, refines the above
+    WIREHIT::updateDAF(pktraj,miconfig,fcache);
     // OK if no updater is found, hits may be frozen this meta-iteration
   }
 
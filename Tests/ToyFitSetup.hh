@@ -0,0 +1,79 @@
+#ifndef KinKal_ToyFitSetup_hh
+#define KinKal_ToyFitSetup_hh
+//
+//  Common setup of the tests comparing fits of toy events: the fit configuration with the meta-iteration schedule read from a file,
+//  the toy, and the seed taken from the middle of the true trajectory
+//
+#include "KinKal/Tests/ToyMC.hh"
+#include "KinKal/Trajectory/LoopHelix.hh"
+#include "KinKal/Trajectory/CentralHelix.hh"
+#include "KinKal/Fit/Config.hh"
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+namespace KKTest {
+  using namespace KinKal;
+  // append the meta-iterations read from a file to the schedule.  Relative names are found in $PACKAGE_SOURCE/Tests
+  inline bool readSchedule(std::string const& sfile, Config& config) {
+    std::string fullfile;
+    if(strncmp(sfile.c_str(),"/",1) == 0) {
+      fullfile = sfile;
+    } else {
+      if(const char* source = std::getenv("PACKAGE_SOURCE")){
+	fullfile = std::string(source) + std::string("/Tests/") + sfile;
+      } else {
+	std::cout << "PACKAGE_SOURCE not defined" << std::endl;
+	return false;
+      }
+    }
+    std::ifstream ifs (fullfile, std::ifstream::in);
+    if ( (ifs.rdstate() & std::ifstream::failbit ) != 0 ){
+      std::cerr << "Error opening " << fullfile << std::endl;
+      return false;
+    }
+    std::string line;
+    unsigned nmiter(config.schedule_.size());
+    while (getline(ifs,line)){
+      if(strncmp(line.c_str(),"#",1)!=0){
+	std::istringstream ss(line);
+	MetaIterConfig mconfig(ss);
+	mconfig.miter_ = nmiter++;
+	config.schedule_.push_back(mconfig);
+      }
+    }
+    return true;
+  }
+
+  // fit configuration of the toy tests
+  inline bool toyConfig(Config& config, std::string const& sfile="Schedule.txt") {
+    config.maxniter_ = 10;
+    config.plevel_ = Config::none;
+    return readSchedule(sfile,config);
+  }
+
+  // toy of particles crossing 40 straws with material.  Toys built with the same random seed generate the same events
+  template <class KTRAJ> ToyMC<KTRAJ> toyMC(BFieldMap const& bfield, unsigned iseed, double mom=105.0, double simmass=0.511,
+      bool simmat=true, bool lighthit=false) {
+    return ToyMC<KTRAJ>(bfield, mom, -1, 3000, iseed, 40, simmat, lighthit, true, 0.25, simmass);
+  }
+
+  // seed parameter sigmas, as used in the fit tests
+  template <class KTRAJ> DVEC seedSigmas();
+  template <> inline DVEC seedSigmas<LoopHelix>() { return DVEC(0.5, 0.5, 0.5, 0.5, 0.002, 0.5); }
+  template <> inline DVEC seedSigmas<CentralHelix>() { return DVEC(0.5, 0.003, 0.00001, 3.0, 0.004, 0.1); }
+
+  // seed from the middle of the true trajectory, covering its range, smeared by the seed sigmas
+  template <class KTRAJ> KTRAJ toySeed(ToyMC<KTRAJ>& toy, BFieldMap const& bfield, ParticleTrajectory<KTRAJ> const& tptraj, double seedsmear) {
+    double tmid = tptraj.range().mid();
+    auto const& midhel = tptraj.nearestPiece(tmid);
+    KTRAJ seedtraj(midhel.position4(tmid), midhel.momentum4(tmid), midhel.charge(), bfield.fieldVect(midhel.position3(tmid)),
+	TimeRange(tptraj.range().begin()-0.5, tptraj.range().end()+0.5));
+    toy.createSeed(seedtraj, seedSigmas<KTRAJ>(), seedsmear);
+    return seedtraj;
+  }
+}
+#endif
@@ -10,11 +10,16 @@
 #include "KinKal/Tests/SimpleWireHit.hh"
 #include "KinKal/Detector/StrawXing.hh"
 #include "KinKal/Detector/StrawMaterial.hh"
+#include "KinKal/Detector/DriftTable.hh"
+#include "KinKal/Detector/PlanarHit.hh"
+#include "KinKal/Detector/PlaneXing.hh"
 #include "KinKal/Tests/ScintHit.hh"
+#include "KinKal/Fit/SeedFinder.hh"
 #include "KinKal/Detector/BFieldMap.hh"
 #include "KinKal/Detector/BFieldUtils.hh"
 #include "KinKal/General/Vectors.hh"
 #include "KinKal/General/PhysicalConstants.h"
+#include <memory_resource>
 
 namespace KKTest {
   using namespace KinKal;
@@ -33,6 +38,9 @@ namespace KKTest {
       using SCINTHITPTR = std::shared_ptr<SCINTHIT>;
       using STRAWXING = StrawXing<KTRAJ>;
       using STRAWXINGPTR = std::shared_ptr<STRAWXING>;
+      using PLANARHIT = PlanarHit<KTRAJ>;
+      using PLANEXING = PlaneXing<KTRAJ>;
+      using PLANEXINGPTR = std::shared_ptr<PLANEXING>;
       using PTCA = PiecewiseClosestApproach<KTRAJ,Line>;
       // create from aseed
       ToyMC(BFieldMap const& bfield, double mom, int icharge, double zrange, int iseed, unsigned nhits, bool simmat, bool lighthit, bool nulltime, double ambigdoca ,double simmass) : 
@@ -51,10 +59,18 @@ namespace KKTest {
       void extendTraj(PKTRAJ& pktraj,double htime);
       void createTraj(PKTRAJ& pktraj);
       void createScintHit(PKTRAJ const& pktraj, HITCOL& thits);
+      // SeedFinder handler for ScintHits: the sensor axis measures the transverse position, and the time through the light propagation
+      static bool seedHit(HIT const& hit, SeedFinder<KTRAJ>& sfinder);
+      PLANEXINGPTR createPlanarHit(PKTRAJ const& pktraj, double htime, HITCOL& thits);
       void simulateParticle(PKTRAJ& pktraj,HITCOL& thits, EXINGCOL& dxings, bool addmat=true);
       double createStrawMaterial(PKTRAJ& pktraj, const EXING* sxing);
       // set functions, for special purposes
       void setInefficiency(double ineff) { ineff_ = ineff; }
+      void setMemoryResource(std::pmr::memory_resource* mres) { mres_ = mres; } // source of memory for the hits and crossings
+      // share a tabulated drift model between all the straw hits, with nr distances and nphi angles
+      void useDriftTable(size_t nr, size_t nphi);
+      void setNominalField(bool nomfield) { nomfield_ = nomfield; } // straw hits use the nominal field for ExB
+      void setPlanar(bool planar) { planar_ = planar; } // simulate pixel planes perpendicular to z instead of straws
       // accessors
       double shVar() const {return sigt_*sigt_;}
       double chVar() const {return scitsig_*scitsig_;}
@@ -62,9 +78,11 @@ namespace KKTest {
       double zRange() const { return zrange_; }
       double strawRadius() const { return rstraw_; }
       StrawMaterial const& strawMaterial() const { return smat_; }
+      std::shared_ptr<DriftTable const> const& driftTable() const { return dtable_; }
 
     private:
       BFieldMap const& bfield_;
+      std::pmr::memory_resource* mres_ = std::pmr::get_default_resource();
       MatEnv::MatDBInfo matdb_;
       double mom_;
       int icharge_;
@@ -85,9 +103,25 @@ namespace KKTest {
       double tol_; // tolerance on spatial accuracy for 
       double tprec_; // time precision on TCA
       StrawMaterial smat_; // straw material
+      std::shared_ptr<DriftTable const> dtable_; // shared drift model, if used
+      bool nomfield_ = false;
+      bool planar_ = false;
+      double psig_ = 0.1, pthick_ = 0.3, psize_ = 10.0; // pixel plane resolution, thickness, and sensor size (mm)
+      double psigt_ = 1.0; // pixel plane time resolution (ns)
     
   };
 
+  template <class KTRAJ> void ToyMC<KTRAJ>::useDriftTable(size_t nr, size_t nphi) {
+    // tabulate the same model as the straw hits, over the straw radius
+    double sdrift(sdrift_), tvar(sigt_*sigt_);
+    auto model = [sdrift,tvar](POL2 const& drift, DriftInfo& dinfo) {
+      dinfo.tdrift_ = drift.R()/sdrift;
+      dinfo.vdrift_ = sdrift;
+      dinfo.tdriftvar_ = tvar;
+    };
+    dtable_ = std::make_shared<DriftTable const>(model,rstraw_,nr,nphi);
+  }
+
   template <class KTRAJ> Line ToyMC<KTRAJ>::generateStraw(PKTRAJ const& traj, double htime) {
     // start with the true helix position at this time
     auto hpos = traj.position4(htime);
@@ -123,6 +157,12 @@ namespace KKTest {
       double htime = tbuff_ + pktraj.range().begin() + ihit*dt;
       // extend the trajectory in the BFieldMap to this time
       extendTraj(pktraj,htime);
+      if(planar_){
+	auto pxing = createPlanarHit(pktraj,htime,thits);
+	if(addmat)dxings.push_back(pxing);
+	if(simmat_ && fabs(createStrawMaterial(pktraj, pxing.get())) > 0.1)break;
+	continue;
+      }
       // create the hit at this time
       auto tline = generateStraw(pktraj,htime);
       CAHint tphint(htime,htime);
@@ -144,10 +184,13 @@ namespace KKTest {
       WireHitState whstate(ambig, dim, nullvar, nulldt);
       // construct the hit from this trajectory
       if(tr_.Uniform(0.0,1.0) > ineff_){
-	thits.push_back(std::make_shared<WIREHIT>(bfield_, tline, whstate, sdrift_, sigt_*sigt_, rstraw_));
+	auto whit = std::allocate_shared<WIREHIT>(std::pmr::polymorphic_allocator<WIREHIT>(mres_),bfield_, tline, whstate, sdrift_, sigt_*sigt_, rstraw_);
+	whit->setDriftTable(dtable_);
+	whit->setNominalField(nomfield_);
+	thits.push_back(whit);
       }
       // compute material effects and change trajectory accordingly
-      auto xing = std::make_shared<STRAWXING>(tp,smat_);
+      auto xing = std::allocate_shared<STRAWXING>(std::pmr::polymorphic_allocator<STRAWXING>(mres_),tp,smat_);
       if(addmat)dxings.push_back(xing);
       if(simmat_){
 	double defrac = createStrawMaterial(pktraj, xing.get());
@@ -217,17 +260,45 @@ namespace KKTest {
     VEC3 lvel(0.0,0.0,cprop_);
     Line lline(shmaxMeas,tmeas,lvel,clen_);
     // then create the hit and add it; the hit has no material
-    thits.push_back(std::make_shared<SCINTHIT>(lline, scitsig_*scitsig_, shPosSig_*shPosSig_));
+    thits.push_back(std::allocate_shared<SCINTHIT>(std::pmr::polymorphic_allocator<SCINTHIT>(mres_),lline, scitsig_*scitsig_, shPosSig_*shPosSig_));
+  }
+
+  template <class KTRAJ> bool ToyMC<KTRAJ>::seedHit(HIT const& hit, SeedFinder<KTRAJ>& sfinder) {
+    auto const* shit = dynamic_cast<SCINTHIT const*>(&hit);
+    if(shit == 0)return false;
+    auto const& axis = shit->sensorAxis();
+    sfinder.addLine(axis.startPosition(),axis.direction(),shit->widthVariance(),axis.t0(),1.0/axis.speed(),shit->timeVariance());
+    return true;
+  }
+
+  template <class KTRAJ> typename ToyMC<KTRAJ>::PLANEXINGPTR ToyMC<KTRAJ>::createPlanarHit(PKTRAJ const& pktraj, double htime, HITCOL& thits) {
+    // pixel plane perpendicular to z through the true position, with the sensor center randomly displaced
+    VEC3 hpos = pktraj.position3(htime);
+    VEC3 pcent(hpos.X()+tr_.Uniform(-psize_,psize_),hpos.Y()+tr_.Uniform(-psize_,psize_),hpos.Z());
+    Plane plane(pcent,VEC3(0.0,0.0,1.0));
+    // measure x and y WRT the center, smeared by the resolution
+    VEC3 udir(1.0,0.0,0.0), vdir(0.0,1.0,0.0);
+    double umeas = tr_.Gaus((hpos-pcent).Dot(udir),psig_);
+    double vmeas = tr_.Gaus((hpos-pcent).Dot(vdir),psig_);
+    if(tr_.Uniform(0.0,1.0) > ineff_){
+      auto phit = std::allocate_shared<PLANARHIT>(std::pmr::polymorphic_allocator<PLANARHIT>(mres_),plane,htime,udir,umeas,psig_*psig_,vdir,vmeas,psig_*psig_);
+      phit->setTimeMeasurement(tr_.Gaus(htime,psigt_),psigt_*psigt_);
+      thits.push_back(phit);
+    }
+    // the database has no silicon, use kapton for the sensor material
+    auto const* pmat = matdb_.findDetMaterial("Kapton");
+    return std::allocate_shared<PLANEXING>(std::pmr::polymorphic_allocator<PLANEXING>(mres_),pktraj,htime,plane,*pmat,pthick_,tprec_);
   }
 
   template <class KTRAJ> void ToyMC<KTRAJ>::createSeed(KTRAJ& seed,DVEC const& sigmas,double seedsmear){
-    auto& seedpar = seed.params();
+    auto seedpar = seed.params();
     // create covariance
     for(size_t ipar=0; ipar < NParams(); ipar++){
       double perr = sigmas[ipar]*seedsmear;
       seedpar.covariance()[ipar][ipar] = perr*perr;
       seedpar.parameters()[ipar] += tr_.Gaus(0.0,perr);
     }
+    seed.setParams(seedpar);
   }
 
   template <class KTRAJ> void ToyMC<KTRAJ>::extendTraj(PKTRAJ& pktraj,double htime) {
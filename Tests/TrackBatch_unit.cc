@@ -0,0 +1,159 @@
+//
+// test TrackBatch against individual Track fits of the same toy events.  The batch only changes how the fit state algebra is
+// organized, so the fit status, iterations, chisquared and parameters must agree up to the rounding of the batch inversion.
+// The batch size is chosen so that the last block of lanes is partly filled.  Both inversion methods (--sqrtinv) are tested.  The events include material and BField corrections
+// in a gradient field, so all the effect types are processed
+//
+#include "KinKal/Tests/ToyFitSetup.hh"
+#include "KinKal/Fit/Track.hh"
+#include "KinKal/Fit/TrackBatch.hh"
+
+#include <iostream>
+#include <stdio.h>
+#include <getopt.h>
+#include <string>
+#include <cmath>
+#include <vector>
+
+using namespace KinKal;
+using namespace std;
+
+void print_usage() {
+  printf("Usage: TrackBatch --nevents i --batch i --seedsmear f --seed i --sqrtinv i --tol f --chitol f --Schedule s\n");
+}
+
+template <class KTRAJ> int testBatch(Config const& config, BFieldMap const& bfield, double seedsmear, unsigned nevents, unsigned nbatch,
+    unsigned iseed, double tol, double chitol) {
+  using PKTRAJ = ParticleTrajectory<KTRAJ>;
+  using HIT = Hit<KTRAJ>;
+  using HITCOL = vector<std::shared_ptr<HIT>>;
+  using EXING = ElementXing<KTRAJ>;
+  using EXINGCOL = vector<std::shared_ptr<EXING>>;
+  using KKTRK = Track<KTRAJ>;
+  using KKBATCH = TrackBatch<KTRAJ>;
+  // the hits and crossings keep state between fits, so the batch fits identical events from an identically-seeded toy
+  auto toy = KKTest::toyMC<KTRAJ>(bfield, iseed);
+  auto btoy = KKTest::toyMC<KTRAJ>(bfield, iseed);
+  unsigned nfit(0), ndiff(0), nfail(0);
+  double maxdpar(0.0), maxdchi(0.0);
+  for(unsigned ibeg=0; ibeg < nevents; ibeg += nbatch){
+    unsigned iend = std::min(nevents,ibeg+nbatch);
+    vector<std::unique_ptr<KKTRK>> tracks;
+    KKBATCH batch(config,bfield);
+    vector<HITCOL> bhits(iend-ibeg);
+    vector<EXINGCOL> bxings(iend-ibeg);
+    for(unsigned ievent=ibeg; ievent < iend; ievent++){
+      for(auto* etoy : {&toy, &btoy}){
+	PKTRAJ tptraj;
+	HITCOL thits;
+	EXINGCOL dxings;
+	etoy->simulateParticle(tptraj, thits, dxings);
+	auto seedtraj = KKTest::toySeed(*etoy, bfield, tptraj, seedsmear);
+	if(etoy == &toy)
+	  tracks.emplace_back(new KKTRK(config, bfield, seedtraj, thits, dxings));
+	else {
+	  bhits[ievent-ibeg] = thits;
+	  bxings[ievent-ibeg] = dxings;
+	  batch.addTrack(seedtraj, bhits[ievent-ibeg], bxings[ievent-ibeg]);
+	}
+      }
+    }
+    batch.fit();
+    for(size_t itrk=0; itrk < tracks.size(); itrk++){
+      auto const& trk = *tracks[itrk];
+      auto const& btrk = batch.track(itrk);
+      nfit++;
+      auto const& fstat = trk.fitStatus();
+      auto const& bstat = btrk.fitStatus();
+      if(fstat.status_ != bstat.status_ || fstat.miter_ != bstat.miter_ || fstat.iter_ != bstat.iter_){
+	cout << KTRAJ::trajName() << " event " << ibeg+itrk << " status differs: fit " << fstat << " batch " << bstat << endl;
+	ndiff++;
+	continue;
+      }
+      if(!fstat.usable()){
+	nfail++;
+	continue;
+      }
+      double dchi = fabs(fstat.chisq_.chisq()-bstat.chisq_.chisq())/std::max(1.0,fstat.chisq_.chisq());
+      maxdchi = std::max(maxdchi,dchi);
+      // compare the parameters at both ends, normalized by the fit errors
+      double dpar(0.0);
+      for(auto const& [fpars,bpars] : {std::make_pair(trk.fitTraj().front().params(),btrk.fitTraj().front().params()),
+	  std::make_pair(trk.fitTraj().back().params(),btrk.fitTraj().back().params())}){
+	for(size_t ipar=0; ipar < NParams(); ipar++)
+	  dpar = std::max(dpar,fabs(fpars.parameters()(ipar)-bpars.parameters()(ipar))/sqrt(fpars.covariance()(ipar,ipar)));
+      }
+      maxdpar = std::max(maxdpar,dpar);
+      if(dpar > tol || dchi > chitol){
+	cout << KTRAJ::trajName() << " event " << ibeg+itrk << " batch fit differs: parameters " << dpar << " sigma, relative chisquared " << dchi << endl;
+	ndiff++;
+      }
+    }
+  }
+  cout << KTRAJ::trajName() << " " << nfit << " events in batches of " << nbatch << ": " << ndiff << " differ from individual fits, " << nfail
+    << " failed; max parameter difference " << maxdpar << " sigma, max relative chisquared difference " << maxdchi << endl;
+  if(ndiff > 0)return -1;
+  if(nfit == 0 || nfail > nfit/20)return -2;
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  int opt;
+  unsigned nevents(100), nbatch(13), iseed(1234);
+  double seedsmear(1.0), tol(1.0e-3), chitol(1.0e-6);
+  bool sqrtinv(true);
+  string sfile("Schedule.txt");
+  int status(0);
+
+  static struct option long_options[] = {
+    {"nevents",     required_argument, 0, 'n'  },
+    {"batch",     required_argument, 0, 'b'  },
+    {"seedsmear",     required_argument, 0, 's'  },
+    {"seed",     required_argument, 0, 'S'  },
+    {"sqrtinv",     required_argument, 0, 'q'  },
+    {"tol",     required_argument, 0, 't'  },
+    {"chitol",     required_argument, 0, 'c'  },
+    {"Schedule",     required_argument, 0, 'u'  },
+    {NULL, 0,0,0}
+  };
+
+  int long_index =0;
+  while ((opt = getopt_long_only(argc, argv,"",
+	  long_options, &long_index )) != -1) {
+    switch (opt) {
+      case 'n' : nevents = atoi(optarg);
+		 break;
+      case 'b' : nbatch = atoi(optarg);
+		 break;
+      case 's' : seedsmear = atof(optarg);
+		 break;
+      case 'S' : iseed = atoi(optarg);
+		 break;
+      case 'q' : sqrtinv = atoi(optarg) > 0;
+		 break;
+      case 't' : tol = atof(optarg);
+		 break;
+      case 'c' : chitol = atof(optarg);
+		 break;
+      case 'u' : sfile = string(optarg);
+		 break;
+      default: print_usage();
+	       exit(EXIT_FAILURE);
+    }
+  }
+  if(nbatch == 0){
+    print_usage();
+    exit(EXIT_FAILURE);
+  }
+  Config config;
+  if(!KKTest::toyConfig(config,sfile))return -1;
+  config.sqrtinv_ = sqrtinv;
+  // a field gradient along the track, so that the fits include BField corrections
+  double zrange(3000.0), Bgrad(-0.036);
+  GradientBFieldMap bfield(1.0-0.5*Bgrad,1.0+0.5*Bgrad,-0.5*zrange,0.5*zrange);
+  int lhstatus = testBatch<LoopHelix>(config, bfield, seedsmear, nevents, nbatch, iseed, tol, chitol);
+  int chstatus = testBatch<CentralHelix>(config, bfield, seedsmear, nevents, nbatch, iseed, tol, chitol);
+  status = std::min(lhstatus,chstatus);
+  cout << "Exiting with status " << status << endl;
+  return status;
+}
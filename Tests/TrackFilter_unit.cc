@@ -0,0 +1,197 @@
+//
+// test TrackFilter against the full Track fit on toy events.  The filtered estimate at the end of a sweep uses all the
+// measurements, so it should reproduce the smoothed fit at that end: the forwards filter the back of the fit trajectory, the backwards
+// filter the front.  The filter is linearized around its seed, so it's repeated to re-linearize around the filtered parameters.
+// Parameter differences are normalized by the fit errors; their median and the fraction of large differences are tested, and the
+// filter errors and chisquared are compared to the fit.  The hits are shared with the fit and the filters, so the state of the wire
+// hits after each filter must be that of the filter's reference, also when a re-linearization is rejected
+//
+#include "KinKal/Tests/ToyFitSetup.hh"
+#include "KinKal/Fit/Track.hh"
+#include "KinKal/Fit/TrackFilter.hh"
+#include "KinKal/Detector/WireHit.hh"
+
+#include <iostream>
+#include <stdio.h>
+#include <getopt.h>
+#include <string>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+using namespace KinKal;
+using namespace std;
+
+void print_usage() {
+  printf("Usage: TrackFilter --nevents i --seedsmear f --niter i --seed i --tol f --errtol f --outlier f --maxout f --ttol f --Schedule s\n");
+}
+
+// compare the filter and fit parameters, normalized by the fit errors, and the ratio of their errors.  The filter is linearized
+// around a reference that doesn't follow the scattering, which occasionally biases it, so the differences are compared using
+// their median and the fraction of large differences
+struct FilterComparison {
+  std::array<std::vector<double>,NParams()> dpars_; // |filter - fit|/fit error
+  std::array<double,NParams()> errsum_ = {}; // sum of filter error/fit error
+  unsigned nout_ = 0; // events with a large difference in any parameter
+  double dchisum_ = 0.0; // sum of the relative chisquared differences
+  void add(Parameters const& fltpars, Parameters const& fitpars, double fltchi, double fitchi, double outlier) {
+    bool isout(false);
+    for(size_t ipar=0; ipar < NParams(); ipar++){
+      double fiterr = sqrt(fitpars.covariance()(ipar,ipar));
+      double dpar = fabs(fltpars.parameters()(ipar) - fitpars.parameters()(ipar))/fiterr;
+      dpars_[ipar].push_back(dpar);
+      errsum_[ipar] += sqrt(fltpars.covariance()(ipar,ipar))/fiterr;
+      isout |= dpar > outlier;
+    }
+    if(isout)nout_++;
+    dchisum_ += fabs(fltchi - fitchi)/fitchi;
+  }
+  unsigned nEvents() const { return dpars_[0].size(); }
+  // largest median difference of any parameter
+  double maxMedian() const {
+    double maxmed(0.0);
+    for(auto dpars : dpars_){
+      std::nth_element(dpars.begin(),dpars.begin()+dpars.size()/2,dpars.end());
+      maxmed = std::max(maxmed,dpars[dpars.size()/2]);
+    }
+    return maxmed;
+  }
+  double outFraction() const { return double(nout_)/nEvents(); }
+  // largest difference of the average error ratio of any parameter from 1
+  double maxErrDiff() const { double maxdiff(0.0); for(auto errsum : errsum_) maxdiff = std::max(maxdiff,fabs(errsum/nEvents()-1.0)); return maxdiff; }
+  double chiDiff() const { return dchisum_/nEvents(); }
+};
+
+// largest difference between the time of the wire hit states and that of their closest approach to a reference trajectory
+template <class KTRAJ> double hitStateDiff(ParticleTrajectory<KTRAJ> const& reftraj, vector<std::shared_ptr<Hit<KTRAJ>>> const& hits) {
+  double dtmax(0.0);
+  for(auto const& hit : hits){
+    auto const* whit = dynamic_cast<WireHit<KTRAJ> const*>(hit.get());
+    if(whit == 0)continue;
+    CAHint tphint(whit->closestApproach().particleToca(),whit->closestApproach().sensorToca());
+    PiecewiseClosestApproach<KTRAJ,Line> tpoca(reftraj,whit->wire(),tphint,1e-6);
+    if(tpoca.usable()) dtmax = std::max(dtmax,fabs(tpoca.particleToca()-whit->time()));
+  }
+  return dtmax;
+}
+
+template <class KTRAJ> int testFilter(Config const& config, BFieldMap const& bfield, double seedsmear, unsigned niter, unsigned nevents,
+    unsigned iseed, double tol, double errtol, double outlier, double maxout, double ttol) {
+  using PKTRAJ = ParticleTrajectory<KTRAJ>;
+  using HIT = Hit<KTRAJ>;
+  using HITCOL = vector<std::shared_ptr<HIT>>;
+  using EXING = ElementXing<KTRAJ>;
+  using EXINGCOL = vector<std::shared_ptr<EXING>>;
+  using KKTRK = Track<KTRAJ>;
+  using KKFLT = TrackFilter<KTRAJ>;
+  auto toy = KKTest::toyMC<KTRAJ>(bfield, iseed);
+  // the filter uses the final (unannealed) meta-iteration of the fit
+  Config fconfig(config);
+  fconfig.schedule_.erase(fconfig.schedule_.begin(),fconfig.schedule_.end()-1);
+  FilterComparison fwd, bwd;
+  unsigned nfail(0); // events where either the fit or a filter failed
+  unsigned nstate(0); // events where the hit states don't match a filter reference
+  double maxdt(0.0);
+  for(unsigned ievent=0; ievent < nevents; ievent++){
+    PKTRAJ tptraj;
+    HITCOL thits;
+    EXINGCOL dxings;
+    toy.simulateParticle(tptraj, thits, dxings);
+    auto seedtraj = KKTest::toySeed(toy, bfield, tptraj, seedsmear);
+    KKTRK kktrk(config, bfield, seedtraj, thits, dxings);
+    KKFLT fflt(fconfig, bfield, seedtraj, thits, dxings, TimeDir::forwards, niter);
+    double fdt = hitStateDiff(fflt.track().refTraj(),thits);
+    KKFLT bflt(fconfig, bfield, seedtraj, thits, dxings, TimeDir::backwards, niter);
+    double bdt = hitStateDiff(bflt.track().refTraj(),thits);
+    maxdt = std::max(maxdt,std::max(fdt,bdt));
+    if(fdt > ttol || bdt > ttol)nstate++;
+    if(!kktrk.fitStatus().usable() || !fflt.fitStatus().usable() || !bflt.fitStatus().usable()){
+      nfail++;
+      continue;
+    }
+    // compare beyond the end of each sweep, where both include all the effects
+    auto const& fittraj = kktrk.fitTraj();
+    fwd.add(fflt.parameters(), fittraj.back().params(), fflt.chisq().chisq(), kktrk.fitStatus().chisq_.chisq(), outlier);
+    bwd.add(bflt.parameters(), fittraj.front().params(), bflt.chisq().chisq(), kktrk.fitStatus().chisq_.chisq(), outlier);
+  }
+  int status(0);
+  for(auto const& [name,comp] : {std::make_pair("forwards",&fwd), std::make_pair("backwards",&bwd)}){
+    if(comp->nEvents() == 0){
+      status = -2;
+      continue;
+    }
+    cout << KTRAJ::trajName() << " filter " << name << " of " << comp->nEvents() << " events: max median difference from the fit " << comp->maxMedian()
+      << " sigma, fraction above " << outlier << " sigma " << comp->outFraction() << ", max error ratio difference " << comp->maxErrDiff()
+      << ", average relative chisquared difference " << comp->chiDiff() << endl;
+    if(comp->maxMedian() > tol || comp->outFraction() > maxout || comp->maxErrDiff() > errtol || comp->chiDiff() > errtol){
+      cout << KTRAJ::trajName() << " filter " << name << " doesn't agree with the fit" << endl;
+      status = -1;
+    }
+  }
+  cout << KTRAJ::trajName() << " " << nstate << " events with hit states inconsistent with the filter, max hit time difference " << maxdt << " ns" << endl;
+  if(nstate > 0)status = -3;
+  if(nfail > nevents/20){
+    cout << KTRAJ::trajName() << " " << nfail << " failed fits or filters" << endl;
+    status = -2;
+  }
+  return status;
+}
+
+int main(int argc, char **argv) {
+  int opt;
+  unsigned nevents(200), niter(3), iseed(1234);
+  double seedsmear(1.0), tol(0.25), errtol(0.1), outlier(3.0), maxout(0.05), ttol(0.1);
+  string sfile("Schedule.txt");
+  int status(0);
+
+  static struct option long_options[] = {
+    {"nevents",     required_argument, 0, 'n'  },
+    {"seedsmear",     required_argument, 0, 's'  },
+    {"niter",     required_argument, 0, 'i'  },
+    {"seed",     required_argument, 0, 'S'  },
+    {"tol",     required_argument, 0, 't'  },
+    {"errtol",     required_argument, 0, 'e'  },
+    {"outlier",     required_argument, 0, 'o'  },
+    {"maxout",     required_argument, 0, 'm'  },
+    {"ttol",     required_argument, 0, 'T'  },
+    {"Schedule",     required_argument, 0, 'u'  },
+    {NULL, 0,0,0}
+  };
+
+  int long_index =0;
+  while ((opt = getopt_long_only(argc, argv,"",
+	  long_options, &long_index )) != -1) {
+    switch (opt) {
+      case 'n' : nevents = atoi(optarg);
+		 break;
+      case 's' : seedsmear = atof(optarg);
+		 break;
+      case 'i' : niter = atoi(optarg);
+		 break;
+      case 'S' : iseed = atoi(optarg);
+		 break;
+      case 't' : tol = atof(optarg);
+		 break;
+      case 'e' : errtol = atof(optarg);
+		 break;
+      case 'o' : outlier = atof(optarg);
+		 break;
+      case 'm' : maxout = atof(optarg);
+		 break;
+      case 'T' : ttol = atof(optarg);
+		 break;
+      case 'u' : sfile = string(optarg);
+		 break;
+      default: print_usage();
+	       exit(EXIT_FAILURE);
+    }
+  }
+  Config config;
+  if(!KKTest::toyConfig(config,sfile))return -1;
+  UniformBFieldMap bfield(1.0);
+  int lhstatus = testFilter<LoopHelix>(config, bfield, seedsmear, niter, nevents, iseed, tol, errtol, outlier, maxout, ttol);
+  int chstatus = testFilter<CentralHelix>(config, bfield, seedsmear, niter, nevents, iseed, tol, errtol, outlier, maxout, ttol);
+  status = std::min(lhstatus,chstatus);
+  cout << "Exiting with status " << status << endl;
+  return status;
+}
@@ -300,6 +300,29 @@ int test(int argc, char **argv) {
       return -2;
     }
   }
+  // test the fused evaluation against the individual functions
+  for(int istep=0;istep<10;istep++){
+    ttime = lhel.range().begin() + istep*tstp;
+    auto eval = lhel.evaluate(ttime);
+    bool evalok = (eval.pos_ - lhel.position3(ttime)).R() < 1e-9 && (eval.velocity() - lhel.velocity(ttime)).R() < 1e-9;
+    for(int idir=0;idir<MomBasis::ndir;idir++){
+      auto tdir = static_cast<MomBasis::Direction>(idir);
+      evalok &= (eval.direction(tdir) - lhel.direction(ttime,tdir)).R() < 1e-9;
+      DVEC dmd = eval.momDeriv(tdir) - lhel.momDeriv(ttime,tdir);
+      evalok &= sqrt(ROOT::Math::Dot(dmd,dmd)) < 1e-9;
+    }
+    evalok &= (eval.momentum3() - lhel.momentum3(ttime)).R() < 1e-9;
+    DVDP dxdp = eval.dXdP_ - lhel.dXdPar(ttime);
+    DVDP dmdp = eval.dMdP_ - lhel.dMdPar(ttime);
+    for(size_t ipar=0;ipar < NParams();ipar++){
+      evalok &= fabs(dxdp(0,ipar)) + fabs(dxdp(1,ipar)) + fabs(dxdp(2,ipar)) < 1e-9;
+      evalok &= fabs(dmdp(0,ipar)) + fabs(dmdp(1,ipar)) + fabs(dmdp(2,ipar)) < 1e-9;
+    }
+    if(!evalok){
+      cout << "Fused evaluation check failed at time " << ttime << endl;
+      return -3;
+    }
+  }
 
   std::string tfname = KTRAJ::trajName() + ".root";
   cout << "Saving canvas to " << title << endl;
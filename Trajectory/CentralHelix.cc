@@ -3,6 +3,7 @@
 #include "Math/AxisAngle.h"
 #include <math.h>
 #include <stdexcept>
+#include <algorithm>
 
 using namespace std;
 using namespace ROOT::Math;
@@ -35,12 +36,10 @@ namespace KinKal {
     // Transform into the system where Z is along the Bfield.  This is a pure rotation about the origin
     VEC4 pos(pos0);
     MOM4 mom(mom0);
-    g2l_ = Rotation3D(AxisAngle(VEC3(sin(bnom_.Phi()),-cos(bnom_.Phi()),0.0),bnom_.Theta()));
+    setRotations();
     if(fabs(g2l_(bnom_).Theta()) > 1.0e-6)throw invalid_argument("Rotation Error");
     pos = g2l_(pos);
     mom = g2l_(mom);
-    // create inverse rotation; this moves back into the original coordinate system
-    l2g_ = g2l_.Inverse();
     // kinematic to geometric conversion
     double radToMom = BFieldUtils::cbar()*charge_*bnom_.R();
     double momToRad = 1.0/radToMom;
@@ -51,6 +50,7 @@ namespace KinKal {
     double amsign = sign();
     param(omega_) = amsign/radius;
     param(tanDip_) = mom.Z()/pt; 
+    setInvariants();
 // vector pointing to the circle center from the measurement point; this is perp to the transverse momentum
     double phimom = atan2(mom.Y(),mom.X());
     double phirm = phimom + amsign*M_PI_2;
@@ -76,6 +76,7 @@ namespace KinKal {
     param(z0_) = z0 - nwind*deltaz;
     // t0, also correcting for winding
     param(t0_) = pos.T() -(dphi + 2*M_PI*nwind)/Omega();
+    setInvariants();
     // test
     auto testpos = position3(pos0.T());
     auto testmom = momentum3(pos0.T());
@@ -100,29 +101,52 @@ namespace KinKal {
   void CentralHelix::setBNom(double time, VEC3 const& bnom) {
     // adjust the parameters for the change in bnom
     mbar_ *= bnom_.R()/bnom.R();
+    setInvariants();
     pars_.parameters() += dPardB(time,bnom);
+    setInvariants();
     bnom_ = bnom;
     // adjust rotations to global space
-    g2l_ = Rotation3D(AxisAngle(VEC3(sin(bnom_.Phi()),-cos(bnom_.Phi()),0.0),bnom_.Theta()));
-    l2g_ = g2l_.Inverse();
+    setRotations();
+  }
+
+  void CentralHelix::setInvariants() {
+    cosdip_ = 1./sqrt(1.+ tanDip() * tanDip() );
+    pbar_ = 1./ (omega() * cosdip_ );
+    ebar_ = sqrt(pbar_*pbar_ + mbar_ * mbar_);
+    Omega_ = Q()*CLHEP::c_light/energy();
+    sphi0_ = sin(phi0());
+    cphi0_ = cos(phi0());
+  }
+
+  void CentralHelix::setRotations() {
+    // the local coordinate system has z along bnom; when that is already the case no rotation is needed
+    aligned_ = bnom_.X() == 0.0 && bnom_.Y() == 0.0 && bnom_.Z() > 0.0;
+    if(aligned_){
+      g2l_ = l2g_ = Rotation3D();
+    } else {
+      g2l_ = Rotation3D(AxisAngle(VEC3(sin(bnom_.Phi()),-cos(bnom_.Phi()),0.0),bnom_.Theta()));
+      l2g_ = g2l_.Inverse();
+    }
   }
 
   CentralHelix::CentralHelix(CentralHelix const& other, VEC3 const& bnom, double trot) : CentralHelix(other) {
     mbar_ *= bnom_.R()/bnom.R();
     bnom_ = bnom;
     pars_.parameters() += other.dPardB(trot,bnom);
-    g2l_ = Rotation3D(AxisAngle(VEC3(sin(bnom_.Phi()),-cos(bnom_.Phi()),0.0),bnom_.Theta()));
-    l2g_ = g2l_.Inverse();
+    setInvariants();
+    setRotations();
   }
 
   CentralHelix::CentralHelix(Parameters const &pdata, double mass, int charge, double bnom, TimeRange const& range) : trange_(range),  pars_(pdata), mass_(mass), charge_(charge), bnom_(VEC3(0.0,0.0,bnom)){
     // compute kinematic cache
     double momToRad = 1.0/(BFieldUtils::cbar()*charge_*bnom);
     mbar_ = -mass_ * momToRad;
+    setInvariants();
+    setRotations();
   }
 
   CentralHelix::CentralHelix(Parameters const &pdata, CentralHelix const& other) : CentralHelix(other) {
-    pars_ = pdata;
+    setParams(pdata);
   }
 
   CentralHelix::CentralHelix(ParticleState const& pstate, VEC3 const& bnom, TimeRange const& range) :
@@ -149,7 +173,7 @@ namespace KinKal {
   }
 
   VEC3 CentralHelix::position3(double time) const {
-    return l2g_(localPosition(time));
+    return toGlobal(localPosition(time));
   } 
 
   VEC3 CentralHelix::localPosition(double time) const
@@ -157,8 +181,8 @@ namespace KinKal {
     double phit = phi(time);
     double cphit = cos(phit);
     double sphit = sin(phit);
-    double sphi0 = sin(phi0());
-    double cphi0 = cos(phi0());
+    double sphi0 = sphi0_;
+    double cphi0 = cphi0_;
     double rho = 1.0/omega();
 
     return rho*VEC3((sphit - sphi0),  -(cphit - cphi0), tanDip()*(phit-phi0())) +
@@ -186,7 +210,85 @@ namespace KinKal {
   }
 
   VEC3 CentralHelix::direction(double time, MomBasis::Direction mdir) const {
-    return l2g_(localDirection(time,mdir));
+    return toGlobal(localDirection(time,mdir));
+  }
+
+  TrajectoryEval CentralHelix::evaluate(double time, unsigned content) const {
+    TrajectoryEval eval;
+    eval.time_ = time;
+    // shared phase, trigonometry and kinematics
+    double cosdip = cosDip();
+    double sindip = tanDip()*cosdip;
+    double dp = dphi(time);
+    double phit = dp + phi0();
+    double sphit = sin(phit);
+    double cphit = cos(phit);
+    double sphi0 = sphi0_;
+    double cphi0 = cphi0_;
+    double rho = 1.0/omega();
+    eval.pos_ = toGlobal(VEC3(rho*(sphit - sphi0) - d0()*sphi0, -rho*(cphit - cphi0) + d0()*cphi0, rho*tanDip()*dp + z0()));
+    VEC3 ldir(cosdip*cphit, cosdip*sphit, sindip);
+    eval.dirs_[MomBasis::momdir_] = toGlobal(ldir);
+    eval.speed_ = speed();
+    eval.mom_ = momentum();
+    if(content & TrajectoryEval::basis){
+      eval.dirs_[MomBasis::perpdir_] = toGlobal(VEC3(-sindip*cphit, -sindip*sphit, cosdip));
+      eval.dirs_[MomBasis::phidir_] = toGlobal(VEC3(-sphit, cphit, 0.0));
+    }
+    if(content & TrajectoryEval::dXdPar) eval.dXdP_ = globalDeriv(dXdParLoc(dp,sphit,cphit,sphi0,cphi0));
+    if(content & (TrajectoryEval::dPardM|TrajectoryEval::dMdPar)){
+      VEC3 lmom = betaGamma()*mass()*ldir;
+      if(content & TrajectoryEval::dPardM) eval.dPdM_ = globalDeriv(dPardMLoc(time,lmom,sphi0,cphi0));
+      if(content & TrajectoryEval::dMdPar) eval.dMdP_ = globalDeriv(dMdParLoc(dp,sphit,cphit,lmom));
+    }
+    return eval;
+  }
+
+  void CentralHelix::positions(double const* times, size_t ntimes, VEC3* pos) const {
+    constexpr size_t nblock(64);
+    double phit[nblock], sphit[nblock], cphit[nblock];
+    double rho = 1.0/omega();
+    VEC3 pos0(- d0()*sphi0_, d0()*cphi0_, z0());
+    for(size_t istart=0; istart < ntimes; istart += nblock){
+      size_t nt = std::min(nblock,ntimes-istart);
+      for(size_t it=0; it < nt; it++) phit[it] = phi(times[istart+it]);
+      for(size_t it=0; it < nt; it++){
+	sphit[it] = sin(phit[it]);
+	cphit[it] = cos(phit[it]);
+      }
+      for(size_t it=0; it < nt; it++)
+	pos[istart+it] = toGlobal(rho*VEC3((sphit[it] - sphi0_),  -(cphit[it] - cphi0_), tanDip()*(phit[it]-phi0())) + pos0);
+    }
+  }
+
+  void CentralHelix::directions(double const* times, size_t ntimes, VEC3* dirs, MomBasis::Direction mdir) const {
+    if(mdir != MomBasis::perpdir_ && mdir != MomBasis::phidir_ && mdir != MomBasis::momdir_)throw std::invalid_argument("Invalid direction");
+    constexpr size_t nblock(64);
+    double sphit[nblock], cphit[nblock];
+    double cosdip = cosDip();
+    double sindip = sinDip();
+    for(size_t istart=0; istart < ntimes; istart += nblock){
+      size_t nt = std::min(nblock,ntimes-istart);
+      for(size_t it=0; it < nt; it++){
+	double phival = phi(times[istart+it]);
+	sphit[it] = sin(phival);
+	cphit[it] = cos(phival);
+      }
+      for(size_t it=0; it < nt; it++){
+	VEC3 ldir;
+	switch ( mdir ) {
+	  case MomBasis::perpdir_:
+	    ldir = VEC3(-sindip * cphit[it], -sindip * sphit[it], cosdip);
+	    break;
+	  case MomBasis::phidir_:
+	    ldir = VEC3(-sphit[it], cphit[it], 0.0);
+	    break;
+	  default:
+	    ldir = VEC3(cosdip * cphit[it], cosdip* sphit[it], sindip);
+	}
+	dirs[istart+it] = toGlobal(ldir);
+      }
+    }
   }
 
   VEC3 CentralHelix::localDirection(double time,MomBasis::Direction mdir) const
@@ -210,15 +312,18 @@ namespace KinKal {
   }
   
   DPDV CentralHelix::dPardMLoc(double time) const {
-    auto locmom = localMomentum(time);
+    return dPardMLoc(time,localMomentum(time),sphi0_,cphi0_);
+  }
+
+  DPDV CentralHelix::dPardMLoc(double time, VEC3 const& locmom, double sphi0, double cphi0) const {
     double pt2 = locmom.perp2();
     double pt = sqrt(pt2);
     double fx = locmom.X()/pt2;
     double fy = locmom.Y()/pt2;
     double invqval = 1.0/Q();
-    double cphi0 = cos(phi0());
-    double sphi0 = sin(phi0());
-    double invrc = 1.0/sqrt(center().perp2());
+    double rcval = rc();
+    VEC3 cent(rcval*sphi0, -rcval*cphi0, 0.0);
+    double invrc = 1.0/sqrt(cent.perp2());
     double omval = Omega();
     double inve = 1.0/energy();
     double dt = time-t0();
@@ -227,9 +332,9 @@ namespace KinKal {
     SVEC3 domega_dM (-omega()*fx, -omega()*fy,0.0);
     SVEC3 dtanDip_dM (-tanDip()*fx, -tanDip()*fy,1.0/pt);
     SVEC3 dphi0_dM = sign()*invrc*invqval*SVEC3(-sphi0,cphi0,0.0);
-    SVEC3 dd0_dM = invqval*(sign()*invrc*SVEC3( center().Y(), -center().X(), 0.0) -
+    SVEC3 dd0_dM = invqval*(sign()*invrc*SVEC3( cent.Y(), -cent.X(), 0.0) -
      (1.0/pt)*SVEC3(locmom.X(),locmom.Y(), 0.0));
-    SVEC3 dt0_dM = -invqval*inve*invc*dphi(time)*SVEC3(locmom.X(), locmom.Y(), locmom.Z()) -
+    SVEC3 dt0_dM = -invqval*inve*invc*omval*dt*SVEC3(locmom.X(), locmom.Y(), locmom.Z()) -
       (1.0/omval)*(SVEC3(-fy,fx,0) - dphi0_dM);
     SVEC3 dz0_dM = locmom.Z()*inve*inve*inve*CLHEP::c_light*dt*SVEC3(locmom.X(), locmom.Y(), locmom.Z()) + 
       locmom.Z()*inve*CLHEP::c_light*dt0_dM -
@@ -248,21 +353,21 @@ namespace KinKal {
 
   DPDV CentralHelix::dPardM(double time) const {
     // now rotate these into local space
-    RMAT g2lmat;
-    g2l_.GetRotationMatrix(g2lmat);
-    return dPardMLoc(time)*g2lmat;
+    return globalDeriv(dPardMLoc(time));
   }
 
   DVDP CentralHelix::dMdPar(double time) const {
+    double dp = dphi(time);
+    double ang = phi0()+dp;
+    // now rotate these into global space
+    return globalDeriv(dMdParLoc(dp,sin(ang),cos(ang),localMomentum(time)));
+  }
+
+  DVDP CentralHelix::dMdParLoc(double dp, double sang, double cang, VEC3 const& lmom) const {
     double cDip = cosDip();
 //    double sDip = tanDip()*cDip;
     double factor = Q()/omega();
-    double dp = dphi(time);
-    double ang = phi0()+dp;
-    double cang = cos(ang);
-    double sang = sin(ang);
     double bta = beta();
-    auto lmom = localMomentum(time);
     SVEC3 momv(lmom.X(),lmom.Y(),lmom.Z());
     SVEC3 momperpv(-lmom.Y(), lmom.X(),0.0);
 
@@ -279,16 +384,13 @@ namespace KinKal {
     dMdP.Place_in_col(dM_dtanDip,0,tanDip_);
     dMdP.Place_in_col(dM_dz0,0,z0_);
     dMdP.Place_in_col(dM_dt0,0,t0_);
-    // now rotate these into global space
-    RMAT l2gmat;
-    l2g_.GetRotationMatrix(l2gmat);
-    return l2gmat*dMdP;
+    return dMdP;
   }
 
   DPDV CentralHelix::dPardXLoc(double time) const {
     double invrc = 1.0/sqrt(center().perp2());
-    double cphi0 = cos(phi0());
-    double sphi0 = sin(phi0());
+    double cphi0 = cphi0_;
+    double sphi0 = sphi0_;
 
     SVEC3 domega_dX (0,0,0);
     SVEC3 dtanDip_dX (0,0,0);
@@ -309,14 +411,16 @@ namespace KinKal {
 
   DVDP CentralHelix::dXdPar(double time) const {
     // first find the derivatives wrt local cartesian coordinates
-    // euclidean space is row, parameter space is column
     double dp = dphi(time);
     double phit = dp+phi0();
+    auto dXdP = dXdParLoc(dp,sin(phit),cos(phit),sphi0_,cphi0_);
+    // now rotate these into global space
+    return globalDeriv(dXdP);
+  }
+
+  DVDP CentralHelix::dXdParLoc(double dp, double sphi, double cphi, double sphi0, double cphi0) const {
+    // euclidean space is row, parameter space is column
     double cDip = cosDip();
-    double sphi = sin(phit);
-    double cphi = cos(phit);
-    double sphi0 = sin(phi0());
-    double cphi0 = cos(phi0());
     double bta = beta();
     double invom = 1.0/omega();
 
@@ -333,17 +437,12 @@ namespace KinKal {
     dXdP.Place_in_col(dX_dz0,0,z0_);
     dXdP.Place_in_col(dX_dtanDip,0,tanDip_);
     dXdP.Place_in_col(dX_dt0,0,t0_);
-    // now rotate these into global space
-    RMAT l2gmat;
-    l2g_.GetRotationMatrix(l2gmat);
-    return l2gmat*dXdP;
+    return dXdP;
   }
 
   DPDV CentralHelix::dPardX(double time) const {
     // rotate into local space
-    RMAT g2lmat;
-    g2l_.GetRotationMatrix(g2lmat);
-    return dPardXLoc(time)*g2lmat;
+    return globalDeriv(dPardXLoc(time));
   }
 
   DVEC CentralHelix::momDeriv(double time, MomBasis::Direction mdir) const
@@ -410,7 +509,7 @@ namespace KinKal {
 
   DVEC CentralHelix::dPardB(double time, VEC3 const& BPrime) const {
   // rotate Bfield difference into local coordinate system
-    VEC3 dB = g2l_(BPrime-bnom_);
+    VEC3 dB = toLocal(BPrime-bnom_);
     // find the parameter change due to BField magnitude change using component parallel to the local nominal Bfield (always along z)
     DVEC retval = dPardB(time)*dB.Z();
     // find the change in (local) position and momentum due to the rotation implied by the B direction change
@@ -13,6 +13,7 @@
 #include "KinKal/General/ParticleState.hh"
 #include "KinKal/General/MomBasis.hh"
 #include "KinKal/General/PhysicalConstants.h"
+#include "KinKal/Trajectory/TrajectoryEval.hh"
 #include "Math/Rotation3D.h"
 #include <vector>
 #include <string>
@@ -58,6 +59,12 @@ namespace KinKal {
       VEC3 momentum3(double time) const;
       VEC3 velocity(double time) const;
       VEC3 direction(double time, MomBasis::Direction mdir= MomBasis::momdir_) const;
+      // evaluate the position, direction basis, velocity and derivatives together; content is a combination of TrajectoryEval::Content flags
+      TrajectoryEval evaluate(double time, unsigned content=TrajectoryEval::all) const;
+      // positions and momentum basis directions at a batch of times, written to output arrays of the same length.
+      // These share the time-independent terms, and process the times in blocks so that the phase and trig loops vectorize
+      void positions(double const* times, size_t ntimes, VEC3* pos) const;
+      void directions(double const* times, size_t ntimes, VEC3* dirs, MomBasis::Direction mdir=MomBasis::momdir_) const;
       // scalar momentum and energy in MeV/c units
       double momentum(double time=0) const  { return fabs(mass_ * pbar() / mbar_); }
       double momentumVariance(double time=0) const;
@@ -80,7 +87,10 @@ namespace KinKal {
       // named parameter accessors
       double paramVal(size_t index) const { return pars_.parameters()[index]; }
       Parameters const &params() const { return pars_; }
-      Parameters &params() { return pars_; }
+      // parameters can only be changed through these, so that the cached invariants stay consistent
+      void setParams(Parameters const& pars) { pars_ = pars; setInvariants(); }
+      void setParameters(DVEC const& pvec) { pars_.parameters() = pvec; setInvariants(); }
+      void setCovariance(DMAT const& pcov) { pars_.covariance() = pcov; } // the covariance doesn't affect the invariants
       double d0() const { return paramVal(d0_); }
       double phi0() const { return paramVal(phi0_); }
       double omega() const { return paramVal(omega_); } // rotational velocity, sign set by magnetic force
@@ -91,24 +101,24 @@ namespace KinKal {
       ParticleState state(double time) const {  return ParticleState(position4(time),momentum4(time),charge()); }
       ParticleStateEstimate stateEstimate(double time) const;
 
-      // simple functions
+      // simple functions; the invariants are cached
       double sign() const { return copysign(1.0,mbar_); } // combined bending sign including Bz and charge
-      double pbar() const { return 1./ (omega() * cosDip() ); } // momentum in mm
-      double ebar() const { return sqrt(pbar()*pbar() + mbar_ * mbar_); } // energy in mm
-      double cosDip() const { return 1./sqrt(1.+ tanDip() * tanDip() ); }
+      double pbar() const { return pbar_; } // momentum in mm
+      double ebar() const { return ebar_; } // energy in mm
+      double cosDip() const { return cosdip_; }
       double sinDip() const { return tanDip()*cosDip(); }
       double mbar() const { return mbar_; } // mass in mm; includes charge information!
       double Q() const { return mass_/mbar_; } // reduced charge
       double beta() const { return fabs(pbar()/ebar()); } // relativistic beta
       double gamma() const { return fabs(ebar()/mbar_); } // relativistic gamma
       double betaGamma() const { return fabs(pbar()/mbar_); } // relativistic betagamma
-      double Omega() const { return Q()*CLHEP::c_light/energy(); } // true angular velocity
+      double Omega() const { return Omega_; } // true angular velocity
       double dphi(double t) const { return Omega()*(t - t0()); } // rotation WRT 0 at a given time
       double phi(double t) const { return dphi(t) + phi0(); } // absolute azimuth at a given time
       double ztime(double zpos) const { return t0() + zpos*omega()/(Omega()*tanDip()); } // time the particle reaches given z value
       double rc() const { return -1.0/omega() - d0(); }
       double bendRadius() const { return fabs(1.0/omega()); }
-      VEC3 center() const { return VEC3(rc()*sin(phi0()), -rc()*cos(phi0()), 0.0); } // circle center (2d)
+      VEC3 center() const { return VEC3(rc()*sphi0_, -rc()*cphi0_, 0.0); } // circle center (2d)
       VEC3 const &bnom(double time=0.0) const { return bnom_; }
       double bnomR() const { return bnom_.R(); }
       DPDV dPardX(double time) const; 
@@ -131,6 +141,7 @@ namespace KinKal {
 	pars_.parameters()[d0_] *= -1.0;
 	pars_.parameters()[phi0_] += M_PI;
 	pars_.parameters()[t0_] *= -1.0;
+	setInvariants();
       }
       //
     private :
@@ -138,8 +149,30 @@ namespace KinKal {
       VEC3 localMomentum(double time) const;
       VEC3 localPosition(double time) const;
       DPDV dPardMLoc(double time) const; // return the derivative of the parameters WRT the local (unrotated) momentum vector
+      // the same local derivatives given the local momentum and the precomputed phase trigonometry
+      DPDV dPardMLoc(double time, VEC3 const& locmom, double sphi0, double cphi0) const;
+      DVDP dXdParLoc(double dp, double sphi, double cphi, double sphi0, double cphi0) const; // derivative of the local position WRT the parameters
+      DVDP dMdParLoc(double dp, double sphi, double cphi, VEC3 const& locmom) const; // derivative of the local momentum WRT the parameters
       DPDV dPardXLoc(double time) const;
       PSMAT dPardStateLoc(double time) const; // derivative of parameters WRT local state
+      void setInvariants(); // update the cached invariants; must be called after any change to the parameters or mbar
+      void setRotations(); // set the rotations between local and global coordinates from bnom
+      // rotate local vectors and derivatives to global coordinates and back.  These skip the rotation when bnom is along +z,
+      // where the local and global coordinates are the same
+      VEC3 toGlobal(VEC3 const& lvec) const { return aligned_ ? lvec : l2g_(lvec); }
+      VEC3 toLocal(VEC3 const& gvec) const { return aligned_ ? gvec : g2l_(gvec); }
+      DVDP globalDeriv(DVDP const& dvdp) const {
+	if(aligned_)return dvdp;
+	RMAT l2gmat;
+	l2g_.GetRotationMatrix(l2gmat);
+	return l2gmat*dvdp;
+      }
+      DPDV globalDeriv(DPDV const& dpdv) const {
+	if(aligned_)return dpdv;
+	RMAT g2lmat;
+	g2l_.GetRotationMatrix(g2lmat);
+	return dpdv*g2lmat;
+      }
       TimeRange trange_;
       Parameters pars_; // parameters
       double mass_;  // in units of MeV/c^2
@@ -147,12 +180,13 @@ namespace KinKal {
       double mbar_;  // reduced mass in units of mm, computed from the mass and nominal field
       VEC3 bnom_;    // nominal BField vector, from the map
       ROOT::Math::Rotation3D l2g_, g2l_; // rotations between local and global coordinates
+      bool aligned_; // bnom is along +z, so the rotations are the identity
+      double cosdip_, pbar_, ebar_, Omega_, sphi0_, cphi0_; // cached invariants, derived from the parameters and mbar
       const static std::vector<std::string> paramTitles_;
       const static std::vector<std::string> paramNames_;
       const static std::vector<std::string> paramUnits_;
       const static std::string trajName_;
-      // DO NOT CACHE ANYTHING that depends on parameters.  it will break the parameter-based constructors
-      // non-const accessors
+      // non-const accessors; setInvariants must be called after using these
       double &param(size_t index) { return pars_.parameters()[index]; }
   };
   std::ostream& operator <<(std::ostream& ost, CentralHelix const& hhel);
@@ -7,6 +7,8 @@
 //  Used as part of the kinematic Kalman fit
 //
 #include "KinKal/Trajectory/ClosestApproachData.hh"
+#include "KinKal/Trajectory/TrajectoryEval.hh"
+#include "KinKal/General/FitProfile.hh"
 #include <iostream>
 #include <ostream>
 
@@ -25,9 +27,10 @@ namespace KinKal {
       // construct from the particle and sensor trajectories; TCA is computed on construction, given a hint as to where
       // to start looking, which disambiguates functions with multiple solutions
       // default precision = ~3um along the particle trajectory (assuming speed of light)
-      ClosestApproach(KTRAJ const& ktraj, STRAJ const& straj, CAHint const& hint, double precision);
+      // the calculation is unconverged if the precision isn't reached within maxiter iterations
+      ClosestApproach(KTRAJ const& ktraj, STRAJ const& straj, CAHint const& hint, double precision, unsigned maxiter=100);
       // construct without a hint: TCA isn't calculated, state is invalid
-      ClosestApproach(KTRAJ const& ptraj, STRAJ const& straj, double precision);
+      ClosestApproach(KTRAJ const& ptraj, STRAJ const& straj, double precision, unsigned maxiter=100);
       // accessors
       ClosestApproachData const& tpData() const { return tpdata_; }
       KTRAJ const& particleTraj() const { return ktraj_; }
@@ -37,6 +40,7 @@ namespace KinKal {
       DVEC const& dTdP() const { return dTdP_; }
       bool inRange() const { return particleTraj().inRange(particleToca()) && sensorTraj().inRange(sensorToca()); }
       double precision() const { return precision_; }
+      unsigned maxIterations() const { return maxiter_; }
       void print(std::ostream& ost=std::cout,int detail=0) const;
     // forward the data payload interface.
       ClosestApproachData::TPStat status() const { return tpdata_.status_; }
@@ -59,6 +63,7 @@ namespace KinKal {
       void findTCA(CAHint const& hint);
     private:
       double precision_; // precision used to define convergence
+      unsigned maxiter_; // maximum number of iterations
       ClosestApproachData tpdata_; // data payload of CA calculation
       KTRAJ const& ktraj_; // kinematic particle trajectory
       STRAJ const& straj_; // sensor trajectory
@@ -67,11 +72,11 @@ namespace KinKal {
       DVEC dTdP_; // derivative of TOCA WRT Parameters
   };
 
-  template<class KTRAJ, class STRAJ> ClosestApproach<KTRAJ,STRAJ>::ClosestApproach(KTRAJ const& ktraj, STRAJ const& straj, double prec) : 
-    precision_(prec),ktraj_(ktraj), straj_(straj) {}
+  template<class KTRAJ, class STRAJ> ClosestApproach<KTRAJ,STRAJ>::ClosestApproach(KTRAJ const& ktraj, STRAJ const& straj, double prec, unsigned maxiter) : 
+    precision_(prec), maxiter_(maxiter), ktraj_(ktraj), straj_(straj) {}
 
   template<class KTRAJ, class STRAJ> ClosestApproach<KTRAJ,STRAJ>::ClosestApproach(KTRAJ const& ktraj, STRAJ const& straj, CAHint const& hint,
-  double prec) : ClosestApproach(ktraj,straj,prec) {
+  double prec, unsigned maxiter) : ClosestApproach(ktraj,straj,prec,maxiter) {
     findTCA(hint);
   }
 
@@ -81,18 +86,18 @@ namespace KinKal {
     // initialize TOCA using hints
     tpdata_.partCA_.SetE(hint.particleToca_);
     tpdata_.sensCA_.SetE(hint.sensorToca_);
-    static const unsigned maxiter=100; // don't allow infinite iteration.  This should be a parameter FIXME!
     unsigned niter(0);
     // speed doesn't change
     double pspeed = ktraj_.speed(particleToca());
     double sspeed = straj_.speed(sensorToca());
     // iterate until change in TOCA is less than precision
     double dptoca(std::numeric_limits<double>::max()), dstoca(std::numeric_limits<double>::max());
-    while(tpdata_.usable() && (fabs(dptoca) > precision() || fabs(dstoca) > precision()) && niter++ < maxiter) { 
+    while(tpdata_.usable() && (fabs(dptoca) > precision() || fabs(dstoca) > precision()) && niter++ < maxiter_) { 
       // find positions and directions at the current TOCA estimate
-      tpdata_.partCA_ = ktraj_.position4(tpdata_.particleToca());
+      auto peval = ktraj_.evaluate(particleToca(),TrajectoryEval::kinematics);
+      tpdata_.partCA_ = peval.position4();
       tpdata_.sensCA_ = straj_.position4(tpdata_.sensorToca());
-      tpdata_.pdir_ = ktraj_.direction(particleToca());
+      tpdata_.pdir_ = peval.direction();
       tpdata_.sdir_ = straj_.direction(sensorToca());
       VEC3 dpos = sensorPoca().Vect()-particlePoca().Vect();
       // dot products
@@ -113,16 +118,18 @@ namespace KinKal {
       tpdata_.sensCA_.SetE(sensorToca()+dstoca);
     }
     if(tpdata_.status_ != ClosestApproachData::pocafailed){
-      if(niter < maxiter)
+      if(niter < maxiter_)
 	tpdata_.status_ = ClosestApproachData::converged;
       else
 	tpdata_.status_ = ClosestApproachData::unconverged;
       // need to add divergence and oscillation tests FIXME!
     }
-    // final update
-    tpdata_.partCA_ = ktraj_.position4(tpdata_.particleToca());
+    KINKAL_PROFILE_TCA(niter,tpdata_.status_ == ClosestApproachData::converged);
+    // final update, including the position derivatives
+    auto peval = ktraj_.evaluate(particleToca(),TrajectoryEval::dXdPar);
+    tpdata_.partCA_ = peval.position4();
     tpdata_.sensCA_ = straj_.position4(tpdata_.sensorToca());
-    tpdata_.pdir_ = ktraj_.direction(particleToca());
+    tpdata_.pdir_ = peval.direction();
     tpdata_.sdir_ = straj_.direction(sensorToca());
     // fill the rest of the state
     if(usable()){
@@ -133,9 +140,8 @@ namespace KinKal {
       VEC3 dvechat = dvec.Unit();
       // now variances due to the particle trajectory parameter covariance
       // for DOCA, project the spatial position derivative along the delta-CA direction
-      DVDP dxdp = ktraj_.dXdPar(particleToca());
       SVEC3 dv(dvechat.X(),dvechat.Y(),dvechat.Z());
-      dDdP_ = -dv*dxdp;
+      dDdP_ = -dv*peval.dXdP_;
       dTdP_[KTRAJ::t0Index()] = -1.0;  // TOCA is 100% anti-correlated with the (mandatory) t0 component.
       // project the parameter covariance onto DOCA and TOCA
       tpdata_.docavar_ = ROOT::Math::Similarity(dDdP(),ktraj_.params().covariance());
@@ -96,6 +96,19 @@ namespace KinKal {
     return (pos0() + flightLength(time) * direction());
   }
 
+  void KinematicLine::positions(double const* times, size_t ntimes, VEC3* pos) const {
+    // the reference position and direction are time-independent
+    VEC3 p0 = pos0();
+    VEC3 dir = direction();
+    for(size_t it=0; it < ntimes; it++) pos[it] = p0 + flightLength(times[it])*dir;
+  }
+
+  void KinematicLine::directions(double const* times, size_t ntimes, VEC3* dirs, MomBasis::Direction mdir) const {
+    if(ntimes == 0)return;
+    VEC3 dir = direction(times[0],mdir);
+    for(size_t it=0; it < ntimes; it++) dirs[it] = dir;
+  }
+
   VEC4 KinematicLine::position4(double time) const {
     VEC3 temp = position3(time);
     return VEC4(temp.X(), temp.Y(), temp.Z(), time);
@@ -146,6 +159,24 @@ namespace KinKal {
     }
   }
 
+  TrajectoryEval KinematicLine::evaluate(double time, unsigned content) const {
+    // the line kinematics are time-independent, so there is little to share
+    TrajectoryEval eval;
+    eval.time_ = time;
+    eval.dirs_[MomBasis::momdir_] = direction();
+    eval.speed_ = speed();
+    eval.mom_ = mom();
+    eval.pos_ = pos0() + (time-t0())*eval.speed_*eval.dirs_[MomBasis::momdir_];
+    if(content & TrajectoryEval::basis){
+      eval.dirs_[MomBasis::perpdir_] = direction(time,MomBasis::perpdir_);
+      eval.dirs_[MomBasis::phidir_] = direction(time,MomBasis::phidir_);
+    }
+    if(content & TrajectoryEval::dXdPar) eval.dXdP_ = dXdPar(time);
+    if(content & TrajectoryEval::dPardM) eval.dPdM_ = dPardM(time);
+    if(content & TrajectoryEval::dMdPar) eval.dMdP_ = dMdPar(time);
+    return eval;
+  }
+
   PSMAT KinematicLine::dPardState(double time) const{
   // aggregate state from separate X and M derivatives; parameter space is row
     DPDV dPdX = dPardX(time);
@@ -11,6 +11,7 @@
 #include "KinKal/General/Parameters.hh"
 #include "KinKal/General/TimeRange.hh"
 #include "KinKal/General/Vectors.hh"
+#include "KinKal/Trajectory/TrajectoryEval.hh"
 #include "Math/Rotation3D.h"
 #include <stdexcept>
 #include <vector>
@@ -68,7 +69,10 @@ class KinematicLine {
     // named parameter accessors
     double paramVal(size_t index) const { return pars_.parameters()[index]; }
     Parameters const &params() const { return pars_; }
-    Parameters &params() { return pars_; }
+    // parameters are changed through these, consistent with the helix trajectories
+    void setParams(Parameters const& pars) { pars_ = pars; }
+    void setParameters(DVEC const& pvec) { pars_.parameters() = pvec; }
+    void setCovariance(DMAT const& pcov) { pars_.covariance() = pcov; }
     double d0() const { return paramVal(d0_); }
     double phi0() const { return paramVal(phi0_); }
     double z0() const { return paramVal(z0_); }
@@ -102,6 +106,9 @@ class KinematicLine {
     double speed(double t) const { return speed(); }
 
     VEC3 position3(double time) const;
+    // positions and momentum basis directions at a batch of times, written to output arrays of the same length
+    void positions(double const* times, size_t ntimes, VEC3* pos) const;
+    void directions(double const* times, size_t ntimes, VEC3* dirs, MomBasis::Direction mdir=MomBasis::momdir_) const;
     VEC4 position4(double time) const;
 
     VEC3 velocity(double time) const { return direction() * speed(); }
@@ -110,6 +117,8 @@ class KinematicLine {
 
     // local momentum direction basis
     VEC3 direction(double time, MomBasis::Direction mdir = MomBasis::momdir_) const;
+    // evaluate the position, direction basis, velocity and derivatives together; content is a combination of TrajectoryEval::Content flags
+    TrajectoryEval evaluate(double time, unsigned content=TrajectoryEval::all) const;
     // momentum change derivatives; this is required to instantiate a KalTrk
     DVEC momDeriv(double time, MomBasis::Direction mdir) const;
 
@@ -3,6 +3,7 @@
 #include "Math/AxisAngle.h"
 #include <cmath>
 #include <stdexcept>
+#include <algorithm>
 
 using namespace std;
 using namespace ROOT::Math;
@@ -35,13 +36,11 @@ namespace KinKal {
     // The transform is a pure rotation about the origin
     VEC4 pos(pos0);
     MOM4 mom(mom0);
-    g2l_ = Rotation3D(AxisAngle(VEC3(sin(bnom_.Phi()),-cos(bnom_.Phi()),0.0),bnom_.Theta()));
+    setRotations();
     if(fabs(g2l_(bnom_).Theta()) > 1.0e-6)throw invalid_argument("Rotation Error");
     // to convert global vectors into parameters they must first be rotated into the local system.
     pos = g2l_(pos);
     mom = g2l_(mom);
-    // create inverse rotation; this moves back into the global coordinate system
-    l2g_ = g2l_.Inverse();
     // compute some simple useful parameters
     double pt = mom.Pt(); 
     double phibar = mom.Phi();
@@ -53,6 +52,7 @@ namespace KinKal {
     param(rad_) = -pt*momToRad;
     // longitudinal wavelength
     param(lam_) = -mom.Z()*momToRad;
+    setInvariants();
     // time at z=0
     double om = omega();
     param(t0_) = pos.T() - pos.Z()/(om*lam());
@@ -75,11 +75,29 @@ namespace KinKal {
   void LoopHelix::setBNom(double time, VEC3 const& bnom) {
     // adjust the parameters for the change in bnom
     mbar_ *= bnom_.R()/bnom.R();
+    setInvariants();
     pars_.parameters() += dPardB(time,bnom);
+    setInvariants();
     bnom_ = bnom;
     // adjust rotations to global space
-    g2l_ = Rotation3D(AxisAngle(VEC3(sin(bnom_.Phi()),-cos(bnom_.Phi()),0.0),bnom_.Theta()));
-    l2g_ = g2l_.Inverse();
+    setRotations();
+  }
+
+  void LoopHelix::setInvariants() {
+    pbar_ = sqrt(pbar2());
+    ebar_ = sqrt(ebar2());
+    omega_ = CLHEP::c_light*sign()/ebar_;
+  }
+
+  void LoopHelix::setRotations() {
+    // the local coordinate system has z along bnom; when that is already the case no rotation is needed
+    aligned_ = bnom_.X() == 0.0 && bnom_.Y() == 0.0 && bnom_.Z() > 0.0;
+    if(aligned_){
+      g2l_ = l2g_ = Rotation3D();
+    } else {
+      g2l_ = Rotation3D(AxisAngle(VEC3(sin(bnom_.Phi()),-cos(bnom_.Phi()),0.0),bnom_.Theta()));
+      l2g_ = g2l_.Inverse();
+    }
   }
 
   LoopHelix::LoopHelix(LoopHelix const& other, VEC3 const& bnom, double tref) : LoopHelix(other) {
@@ -87,7 +105,7 @@ namespace KinKal {
   }
 
   LoopHelix::LoopHelix( Parameters const& pdata, LoopHelix const& other) : LoopHelix(other) {
-    pars_ = pdata;
+    setParams(pdata);
   }
 
   LoopHelix::LoopHelix( Parameters const& pars, double mass, int charge, VEC3 const& bnom, TimeRange const& trange ) : 
@@ -95,9 +113,9 @@ namespace KinKal {
     double momToRad = 1.0/(BFieldUtils::cbar()*charge_*bnom_.R());
     // set reduced mass
     mbar_ = -mass_*momToRad;
+    setInvariants();
     // set the transforms
-    g2l_ = Rotation3D(AxisAngle(VEC3(sin(bnom_.Phi()),-cos(bnom_.Phi()),0.0),bnom_.Theta()));
-    l2g_ = g2l_.Inverse();
+    setRotations();
   }
 
   LoopHelix::LoopHelix(ParticleState const& pstate, VEC3 const& bnom, TimeRange const& range) :
@@ -123,7 +141,7 @@ namespace KinKal {
   }
 
   VEC3 LoopHelix::position3(double time) const {
-    return l2g_(localPosition(time));
+    return toGlobal(localPosition(time));
   } 
 
   MOM4 LoopHelix::momentum4(double time) const{
@@ -165,7 +183,77 @@ namespace KinKal {
   } 
 
   VEC3 LoopHelix::direction(double time, MomBasis::Direction mdir) const {
-    return l2g_(localDirection(time,mdir));
+    return toGlobal(localDirection(time,mdir));
+  }
+
+  TrajectoryEval LoopHelix::evaluate(double time, unsigned content) const {
+    TrajectoryEval eval;
+    eval.time_ = time;
+    // shared phase, trigonometry and kinematics
+    double pb = pbar();
+    double eb = ebar();
+    double dt = time-t0();
+    double dphi = omega()*dt;
+    double phival = dphi + phi0();
+    double sphi = sin(phival);
+    double cphi = cos(phival);
+    double invpb = sign()/pb;
+    eval.pos_ = toGlobal(VEC3(cx() + rad()*sphi, cy() - rad()*cphi, dphi*lam()));
+    eval.dirs_[MomBasis::momdir_] = toGlobal(VEC3(rad()*cphi*invpb, rad()*sphi*invpb, lam()*invpb));
+    eval.speed_ = CLHEP::c_light*pb/eb;
+    eval.mom_ = fabs(mass_*pb/mbar_);
+    if(content & TrajectoryEval::basis){
+      eval.dirs_[MomBasis::perpdir_] = toGlobal(VEC3(lam()*cphi*invpb, lam()*sphi*invpb, -rad()*invpb));
+      eval.dirs_[MomBasis::phidir_] = toGlobal(VEC3(-sphi, cphi, 0.0));
+    }
+    if(content & TrajectoryEval::dXdPar) eval.dXdP_ = globalDeriv(dXdParLoc(dphi,sphi,cphi));
+    if(content & TrajectoryEval::dPardM) eval.dPdM_ = globalDeriv(dPardMLoc(dt,dphi,sphi,cphi));
+    if(content & TrajectoryEval::dMdPar) eval.dMdP_ = globalDeriv(dMdParLoc(dphi,sphi,cphi));
+    return eval;
+  }
+
+  void LoopHelix::positions(double const* times, size_t ntimes, VEC3* pos) const {
+    constexpr size_t nblock(64);
+    double dphi[nblock], sphi[nblock], cphi[nblock];
+    for(size_t istart=0; istart < ntimes; istart += nblock){
+      size_t nt = std::min(nblock,ntimes-istart);
+      for(size_t it=0; it < nt; it++) dphi[it] = omega()*(times[istart+it]-t0());
+      for(size_t it=0; it < nt; it++){
+	double phival = dphi[it] + phi0();
+	sphi[it] = sin(phival);
+	cphi[it] = cos(phival);
+      }
+      for(size_t it=0; it < nt; it++) pos[istart+it] = toGlobal(VEC3(cx() + rad()*sphi[it], cy() - rad()*cphi[it], dphi[it]*lam()));
+    }
+  }
+
+  void LoopHelix::directions(double const* times, size_t ntimes, VEC3* dirs, MomBasis::Direction mdir) const {
+    if(mdir != MomBasis::perpdir_ && mdir != MomBasis::phidir_ && mdir != MomBasis::momdir_)throw invalid_argument("Invalid direction");
+    constexpr size_t nblock(64);
+    double sphi[nblock], cphi[nblock];
+    double invpb = sign()/pbar();
+    for(size_t istart=0; istart < ntimes; istart += nblock){
+      size_t nt = std::min(nblock,ntimes-istart);
+      for(size_t it=0; it < nt; it++){
+	double phival = phi(times[istart+it]);
+	sphi[it] = sin(phival);
+	cphi[it] = cos(phival);
+      }
+      for(size_t it=0; it < nt; it++){
+	VEC3 ldir;
+	switch ( mdir ) {
+	  case MomBasis::perpdir_:
+	    ldir = VEC3( lam()*cphi[it]*invpb,lam()*sphi[it]*invpb,-rad()*invpb);
+	    break;
+	  case MomBasis::phidir_:
+	    ldir = VEC3(-sphi[it],cphi[it],0.0);
+	    break;
+	  default:
+	    ldir = VEC3( rad()*cphi[it]*invpb,rad()*sphi[it]*invpb,lam()*invpb);
+	}
+	dirs[istart+it] = toGlobal(ldir);
+      }
+    }
   }
 
   // derivatives of parameters WRT momentum projected along the given momentum basis direction 
@@ -193,13 +281,14 @@ namespace KinKal {
   }
 
   DPDV LoopHelix::dPardMLoc(double time) const {
-    // euclidean space is column, parameter space is row
-    double omval = omega();
     double dt = time-t0();
-    double dphi = omval*dt;
+    double dphi = omega()*dt;
     double phival = dphi + phi0();
-    double sphi = sin(phival);
-    double cphi = cos(phival);
+    return dPardMLoc(dt,dphi,sin(phival),cos(phival));
+  }
+
+  DPDV LoopHelix::dPardMLoc(double dt, double dphi, double sphi, double cphi) const {
+    // euclidean space is column, parameter space is row
     double inve2 = 1.0/ebar2();
     SVEC3 T2(-sphi,cphi,0.0);
     SVEC3 dR_dM(cphi,sphi,0.0);
@@ -222,16 +311,12 @@ namespace KinKal {
 
   DPDV LoopHelix::dPardX(double time) const {
 // rotate into local space
-    RMAT g2lmat;
-    g2l_.GetRotationMatrix(g2lmat);
-    return dPardXLoc(time)*g2lmat;
+    return globalDeriv(dPardXLoc(time));
   }
 
   DPDV LoopHelix::dPardM(double time) const {
 // now rotate these into local space
-    RMAT g2lmat;
-    g2l_.GetRotationMatrix(g2lmat);
-    return dPardMLoc(time)*g2lmat;
+    return globalDeriv(dPardMLoc(time));
   }
 
   DVEC LoopHelix::dPardB(double time) const {
@@ -248,7 +333,7 @@ namespace KinKal {
 
   DVEC LoopHelix::dPardB(double time, VEC3 const& BPrime) const {
   // rotate new B field difference into local coordinate system
-    VEC3 dB = g2l_(BPrime-bnom_);
+    VEC3 dB = toLocal(BPrime-bnom_);
     // find the parameter change due to BField magnitude change usng component parallel to the local nominal Bfield (always along z)
     DVEC retval = dPardB(time)*dB.Z();
     // find the change in (local) position and momentum due to the rotation implied by the B direction change
@@ -267,13 +352,16 @@ namespace KinKal {
 
   DVDP LoopHelix::dXdPar(double time) const {
     // first find the derivatives wrt local cartesian coordinates
+    double dphi = omega()*(time-t0());
+    double phival = dphi + phi0();
+    auto dXdP = dXdParLoc(dphi,sin(phival),cos(phival));
+// now rotate these into global space
+    return globalDeriv(dXdP);
+  }
+
+  DVDP LoopHelix::dXdParLoc(double dphi, double sphi, double cphi) const {
     // euclidean space is row, parameter space is column
     double omval = omega();
-    double dt = time-t0();
-    double dphi = omval*dt;
-    double phival = dphi + phi0();
-    double sphi = sin(phival);
-    double cphi = cos(phival);
     double inve2 = 1.0/ebar2();
     SVEC3 T2(-sphi,cphi,0.0);
     SVEC3 T3(cphi,sphi,0.0);
@@ -292,19 +380,18 @@ namespace KinKal {
     dXdP.Place_in_col(dX_dCy,0,cy_);
     dXdP.Place_in_col(dX_dphi0,0,phi0_);
     dXdP.Place_in_col(dX_dt0,0,t0_);
-// now rotate these into global space
-    RMAT l2gmat;
-    l2g_.GetRotationMatrix(l2gmat);
-    return l2gmat*dXdP;
+    return dXdP;
   }
 
   DVDP LoopHelix::dMdPar(double time) const {
-    double omval = omega();
-    double dt = time-t0();
-    double dphi = omval*dt;
+    double dphi = omega()*(time-t0());
     double phival = dphi + phi0();
-    double sphi = sin(phival);
-    double cphi = cos(phival);
+// rotate the local derivatives into global space
+    return globalDeriv(dMdParLoc(dphi,sin(phival),cos(phival)));
+  }
+
+  DVDP LoopHelix::dMdParLoc(double dphi, double sphi, double cphi) const {
+    double omval = omega();
     double inve2 = 1.0/ebar2();
     SVEC3 T2(-sphi,cphi,0.0);
     SVEC3 T3(cphi,sphi,0.0);
@@ -319,10 +406,7 @@ namespace KinKal {
     dMdP.Place_in_col(dM_dphi0,0,phi0_);
     dMdP.Place_in_col(dM_dt0,0,t0_);
     dMdP *= Q(); // scale to momentum
-// now rotate these into global space
-    RMAT l2gmat;
-    l2g_.GetRotationMatrix(l2gmat);
-    return l2gmat*dMdP;
+    return dMdP;
   }
 
   PSMAT LoopHelix::dPardStateLoc(double time) const{
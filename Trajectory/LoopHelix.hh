@@ -13,6 +13,7 @@
 #include "KinKal/General/MomBasis.hh"
 #include "KinKal/General/ParticleState.hh"
 #include "KinKal/General/PhysicalConstants.h"
+#include "KinKal/Trajectory/TrajectoryEval.hh"
 #include "Math/Rotation3D.h"
 #include <vector>
 #include <string>
@@ -67,12 +68,21 @@ namespace KinKal {
       double momentumVariance(double time=0) const;
       double energy(double time=0) const  { return  fabs(mass_*ebar()/mbar_); }
       VEC3 direction(double time, MomBasis::Direction mdir= MomBasis::momdir_) const;
+      // evaluate the position, direction basis, velocity and derivatives together; content is a combination of TrajectoryEval::Content flags
+      TrajectoryEval evaluate(double time, unsigned content=TrajectoryEval::all) const;
+      // positions and momentum basis directions at a batch of times, written to output arrays of the same length.
+      // These share the time-independent terms, and process the times in blocks so that the phase and trig loops vectorize
+      void positions(double const* times, size_t ntimes, VEC3* pos) const;
+      void directions(double const* times, size_t ntimes, VEC3* dirs, MomBasis::Direction mdir=MomBasis::momdir_) const;
       double mass() const { return mass_;} // mass 
       int charge() const { return charge_;} // charge in proton charge units
       double paramVal(size_t index) const { return pars_.parameters()[index]; }
       double paramVar(size_t index) const { return pars_.covariance()(index,index); }
       Parameters const& params() const { return pars_; }
-      Parameters& params() { return pars_; }
+      // parameters can only be changed through these, so that the cached invariants stay consistent
+      void setParams(Parameters const& pars) { pars_ = pars; setInvariants(); }
+      void setParameters(DVEC const& pvec) { pars_.parameters() = pvec; setInvariants(); }
+      void setCovariance(DMAT const& pcov) { pars_.covariance() = pcov; } // the covariance doesn't affect the invariants
       // named parameter accessors
       double rad() const { return paramVal(rad_); }
       double lam() const { return paramVal(lam_); }
@@ -83,16 +93,16 @@ namespace KinKal {
       // express fit results as a state vector (global coordinates)
       ParticleState state(double time) const { return ParticleState(position4(time),momentum4(time),charge()); }
       ParticleStateEstimate stateEstimate(double time) const;
-      // simple functions; these can be cached if they cause performance problems
+      // simple functions; the invariants are cached
       double sign() const { return copysign(1.0,mbar_); } // combined bending sign including Bz and charge
-      double pbar2() const { return  rad()*rad() + lam()*lam(); } 
-      double pbar() const { return  sqrt(pbar2()); } // momentum in mm
+      double pbar2() const { return  rad()*rad() + lam()*lam(); }
+      double pbar() const { return  pbar_; } // momentum in mm
       double ebar2() const { return  pbar2() + mbar_*mbar_; }
-      double ebar() const { return  sqrt(ebar2()); } // energy in mm
+      double ebar() const { return  ebar_; } // energy in mm
       double mbar() const { return mbar_; } // mass in mm; includes charge information!
       double Q() const { return mass_/mbar_; } // reduced charge
-      double omega() const { return CLHEP::c_light*sign()/ ebar(); } // rotational velocity, sign set by magnetic force
-      double beta() const { return pbar()/ebar(); } // relativistic beta
+      double omega() const { return omega_; } // rotational velocity, sign set by magnetic force
+      double beta() const { return pbar_/ebar_; } // relativistic beta
       double gamma() const { return fabs(ebar()/mbar_); } // relativistic gamma
       double betaGamma() const { return fabs(pbar()/mbar_); } // relativistic betagamma
       double dphi(double t) const { return omega()*(t - t0()); }
@@ -106,6 +116,7 @@ namespace KinKal {
 	mbar_ *= -1.0;
 	charge_ *= -1;
 	pars_.parameters()[t0_] *= -1.0;
+	setInvariants();
       }
       // functions related to euclidean space to parameter space derivatives
       DPDV dPardX(double time) const; // return the derivative of the parameters WRT the (global) position vector
@@ -126,7 +137,29 @@ namespace KinKal {
       VEC3 localPosition(double time) const;
       DPDV dPardXLoc(double time) const; // return the derivative of the parameters WRT the local (unrotated) position vector
       DPDV dPardMLoc(double time) const; // return the derivative of the parameters WRT the local (unrotated) momentum vector
+      // the same local derivatives given the precomputed phase and its trigonometry
+      DPDV dPardMLoc(double dt, double dphi, double sphi, double cphi) const;
+      DVDP dXdParLoc(double dphi, double sphi, double cphi) const; // derivative of the local position WRT the parameters
+      DVDP dMdParLoc(double dphi, double sphi, double cphi) const; // derivative of the local momentum WRT the parameters
       PSMAT dPardStateLoc(double time) const; // derivative of parameters WRT local state
+      void setInvariants(); // update the cached invariants; must be called after any change to the parameters or mbar
+      void setRotations(); // set the rotations between local and global coordinates from bnom
+      // rotate local vectors and derivatives to global coordinates and back.  These skip the rotation when bnom is along +z,
+      // where the local and global coordinates are the same
+      VEC3 toGlobal(VEC3 const& lvec) const { return aligned_ ? lvec : l2g_(lvec); }
+      VEC3 toLocal(VEC3 const& gvec) const { return aligned_ ? gvec : g2l_(gvec); }
+      DVDP globalDeriv(DVDP const& dvdp) const {
+	if(aligned_)return dvdp;
+	RMAT l2gmat;
+	l2g_.GetRotationMatrix(l2gmat);
+	return l2gmat*dvdp;
+      }
+      DPDV globalDeriv(DPDV const& dpdv) const {
+	if(aligned_)return dpdv;
+	RMAT g2lmat;
+	g2l_.GetRotationMatrix(g2lmat);
+	return dpdv*g2lmat;
+      }
 
       TimeRange trange_;
       Parameters pars_; // parameters
@@ -135,11 +168,13 @@ namespace KinKal {
       double mbar_;  // reduced mass in units of mm, computed from the mass and nominal field
       VEC3 bnom_; // nominal BField, in global coordinate system
       ROOT::Math::Rotation3D l2g_, g2l_; // rotations between local and global coordinates 
+      bool aligned_; // bnom is along +z, so the rotations are the identity
+      double pbar_, ebar_, omega_; // cached invariants, derived from the parameters and mbar
       const static std::vector<std::string> paramTitles_;
       const static std::vector<std::string> paramNames_;
       const static std::vector<std::string> paramUnits_;
       const static std::string trajName_;
-      // non-const accessors
+      // non-const accessors; setInvariants must be called after using these
       double& param(size_t index) { return pars_.parameters()[index]; }
  };
   std::ostream& operator <<(std::ostream& ost, LoopHelix const& lhel);
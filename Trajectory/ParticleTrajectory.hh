@@ -2,11 +2,18 @@
 #define KinKal_ParticleTrajectory_hh
 //
 //  Particle trajectory, based on a piecewise trajectory with kinematic information, templated on a simple kinetic trajectory (KTRAJ)
-//  used as part of the kinematic kalman fit
+//  used as part of the kinematic kalman fit.
+//  This also provides extrapolation to batches of times or surfaces, for use outside the fit
 //
 #include "KinKal/Trajectory/PiecewiseTrajectory.hh"
+#include "KinKal/Trajectory/TrajectoryEval.hh"
 #include "KinKal/General/ParticleState.hh"
+#include "KinKal/General/PhysicalConstants.h"
 #include <stdexcept>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
 namespace KinKal {
 
   template <class KTRAJ> class ParticleTrajectory : public PiecewiseTrajectory<KTRAJ> {
@@ -17,6 +24,7 @@ namespace KinKal {
       // construct from an initial piece, which also provides kinematic information
       ParticleTrajectory(KTRAJ const& piece) : PTTRAJ(piece) {}
       ParticleTrajectory() : PTTRAJ() {}
+      explicit ParticleTrajectory(std::pmr::memory_resource* mres) : PTTRAJ(mres) {}
       //  append and prepend to check mass and charge consistency
       void append(KTRAJ const& newpiece, bool allowremove=false)  {
 	if(PTTRAJ::pieces().size() > 0){
@@ -35,12 +43,181 @@ namespace KinKal {
       double momentum(double time) const  { return PTTRAJ::nearestPiece(time).momentum(time); }
       double momentumVariance(double time) const  { return PTTRAJ::nearestPiece(time).momentumVariance(time); }
       double energy(double time) const  { return PTTRAJ::nearestPiece(time).energy(time); }
+      TrajectoryEval evaluate(double time, unsigned content=TrajectoryEval::all) const { return PTTRAJ::nearestPiece(time).evaluate(time,content); }
       double mass() const { return PTTRAJ::front().mass(); } // this will throw for empty
       double charge() const { return PTTRAJ::front().charge(); } // this will throw for empty 
       VEC3 const& bnom(double time) const { return PTTRAJ::nearestPiece(time).bnom(); }
       ParticleState state(double time) const { return PTTRAJ::nearestPiece(time).state(time); }
       ParticleStateEstimate stateEstimate(double time) const { return PTTRAJ::nearestPiece(time).stateEstimate(time); }
+      // extrapolation.  State estimates at a batch of times; the times are processed in order so that the pieces are scanned once.
+      // The piece and its parameter covariance are looked up once per piece, and the state and its derivatives WRT the parameters
+      // come from a single evaluation per distinct time
+      std::vector<ParticleStateEstimate> stateEstimates(std::vector<double> const& times) const;
+      // result of a surface crossing search
+      struct Crossing {
+	bool found_ = false; // was the surface crossed within the trajectory range
+	double time_ = 0.0; // crossing time
+	ParticleStateEstimate state_; // state (with covariance) at the crossing
+      };
+      // find the first crossing of each surface, searching from tstart in the given time direction.  The positions are evaluated once per step for
+      // all the surfaces.  Steps are limited to 1 radian of bending, so a surface which is touched without being crossed within a step can be missed.
+      // Precision is on the crossing time.  SURF must provide distance(VEC3) and gradient(VEC3), see Surface.hh
+      template <class SURF> std::vector<Crossing> crossings(std::vector<SURF> const& surfs, double tstart, TimeDir tdir, double precision=1.0e-6) const;
+      // same for a single surface
+      template <class SURF> Crossing crossing(SURF const& surf, double tstart, TimeDir tdir, double precision=1.0e-6) const {
+	return crossings(std::vector<SURF>(1,surf),tstart,tdir,precision).front(); }
+      // find the crossing of a surface nearest to a time estimate using Newton steps, moving between pieces as needed.  This is the fast
+      // path for sensors with a good time estimate: for a plane perpendicular to the nominal field a helix converges in a single step.
+      // The time is updated in place, and the index of the piece the crossing was found on is returned in ipiece.  A surface in the gap of
+      // a position discontinuity between pieces is crossed by extrapolating the piece the search started from.
+      // false is returned if the steps don't converge
+      template <class SURF> bool localCrossing(SURF const& surf, double& time, size_t& ipiece, double precision=1.0e-6, unsigned maxiter=10) const;
+    private:
+      // refine a crossing bracketed by times ta and tb on a single piece
+      template <class SURF> double refine(KTRAJ const& piece, SURF const& surf, double ta, double fa, double tb, double fb, double precision) const;
   };
+
+  template <class KTRAJ> std::vector<ParticleStateEstimate> ParticleTrajectory<KTRAJ>::stateEstimates(std::vector<double> const& times) const {
+    std::vector<ParticleStateEstimate> states(times.size());
+    if(times.size() == 0)return states;
+    std::vector<size_t> order(times.size());
+    std::iota(order.begin(),order.end(),0);
+    // times are usually already ordered (hits, crossings), in which case the sort is skipped
+    if(!std::is_sorted(times.begin(),times.end()))
+      std::sort(order.begin(),order.end(),[&times](size_t i1, size_t i2){ return times[i1] < times[i2]; });
+    // same piece selection as nearestIndex, but incremental
+    size_t ipiece = PTTRAJ::nearestIndex(times[order.front()]);
+    KTRAJ const* piece = &PTTRAJ::piece(ipiece);
+    DMAT const* pcov = &piece->params().covariance();
+    auto estimate = [&piece,&pcov](double time) {
+      auto eval = piece->evaluate(time,TrajectoryEval::dXdPar|TrajectoryEval::dMdPar);
+      return ParticleStateEstimate(ParticleState(eval.pos_,eval.momentum3(),time,piece->mass(),piece->charge()),
+	  ROOT::Math::Similarity(eval.dStatedPar(),*pcov));
+    };
+    size_t iprev = order.front();
+    states[iprev] = estimate(times[iprev]);
+    for(auto iorder = std::next(order.begin()); iorder != order.end(); ++iorder){
+      double time = times[*iorder];
+      size_t jpiece = ipiece;
+      while(jpiece+1 < PTTRAJ::pieces().size() && time > PTTRAJ::piece(jpiece).range().end()) jpiece++;
+      if(jpiece == ipiece && time == times[iprev])
+	states[*iorder] = states[iprev];
+      else {
+	if(jpiece != ipiece){
+	  piece = &PTTRAJ::piece(jpiece);
+	  pcov = &piece->params().covariance();
+	}
+	states[*iorder] = estimate(time);
+      }
+      ipiece = jpiece;
+      iprev = *iorder;
+    }
+    return states;
+  }
+
+  template <class KTRAJ> template <class SURF> std::vector<typename ParticleTrajectory<KTRAJ>::Crossing> ParticleTrajectory<KTRAJ>::crossings(
+      std::vector<SURF> const& surfs, double tstart, TimeDir tdir, double precision) const {
+    std::vector<Crossing> xings(surfs.size());
+    if(surfs.size() == 0)return xings;
+    if(tdir != TimeDir::forwards && tdir != TimeDir::backwards) throw std::invalid_argument("Invalid direction");
+    double tsign = tdir == TimeDir::forwards ? 1.0 : -1.0;
+    double tend = tdir == TimeDir::forwards ? PTTRAJ::range().end() : PTTRAJ::range().begin();
+    size_t ipiece = PTTRAJ::nearestIndex(tstart);
+    // distances at the start of each step
+    std::vector<double> dist(surfs.size());
+    VEC3 pos = PTTRAJ::piece(ipiece).position3(tstart);
+    for(size_t isurf=0; isurf < surfs.size(); isurf++) dist[isurf] = surfs[isurf].distance(pos);
+    size_t nfound(0);
+    double t1 = tstart;
+    while(nfound < surfs.size() && tsign*(tend-t1) > 0.0){
+      auto const& piece = PTTRAJ::piece(ipiece);
+      double tpend = tdir == TimeDir::forwards ? piece.range().end() : piece.range().begin();
+      // bending rate; the factor converts MeV/c to bend radius (mm) per Tesla.  This only limits the step
+      double omega = 1.0e-3*CLHEP::c_light*CLHEP::c_light*fabs(piece.charge()*piece.bnom().R())/piece.energy(t1);
+      double dt = omega > 0.0 ? 1.0/omega : fabs(tpend-t1);
+      double t2 = tsign*(tpend-t1) > dt ? t1 + tsign*dt : tpend;
+      pos = piece.position3(t2);
+      for(size_t isurf=0; isurf < surfs.size(); isurf++){
+	double d2 = surfs[isurf].distance(pos);
+	if(!xings[isurf].found_ && (dist[isurf] == 0.0 || dist[isurf]*d2 < 0.0)){
+	  xings[isurf].found_ = true;
+	  xings[isurf].time_ = dist[isurf] == 0.0 ? t1 : refine(piece,surfs[isurf],t1,dist[isurf],t2,d2,precision);
+	  nfound++;
+	}
+	dist[isurf] = d2;
+      }
+      t1 = t2;
+      // move to the next piece; the positions are continuous to the precision of the fit
+      if(t1 == tpend){
+	if(tdir == TimeDir::forwards && ipiece+1 < PTTRAJ::pieces().size()){
+	  t1 = PTTRAJ::piece(++ipiece).range().begin();
+	} else if (tdir == TimeDir::backwards && ipiece > 0){
+	  t1 = PTTRAJ::piece(--ipiece).range().end();
+	} else
+	  break;
+      }
+    }
+    // state estimates at all the crossings at once
+    std::vector<double> times;
+    times.reserve(nfound);
+    for(auto const& xing : xings) if(xing.found_)times.push_back(xing.time_);
+    auto states = stateEstimates(times);
+    auto istate = states.begin();
+    for(auto& xing : xings) if(xing.found_)xing.state_ = *istate++;
+    return xings;
+  }
+
+  template <class KTRAJ> template <class SURF> bool ParticleTrajectory<KTRAJ>::localCrossing(SURF const& surf, double& time, size_t& ipiece, double precision, unsigned maxiter) const {
+    ipiece = PTTRAJ::nearestIndex(time);
+    size_t ppiece = ipiece;
+    bool locked(false);
+    for(unsigned iter=0; iter < maxiter; iter++){
+      auto teval = PTTRAJ::piece(ipiece).evaluate(time,TrajectoryEval::kinematics);
+      double ddot = surf.gradient(teval.pos_).Dot(teval.velocity());
+      if(ddot == 0.0)return false;
+      double dt = -surf.distance(teval.pos_)/ddot;
+      time += dt;
+      if(fabs(dt) < precision)return true;
+      if(!locked){
+	size_t jpiece = PTTRAJ::nearestIndex(time);
+	// stepping back to the previous piece means the surface lies in the gap of a discontinuity: stay on the current piece
+	if(jpiece != ipiece && jpiece == ppiece)
+	  locked = true;
+	else {
+	  if(jpiece != ipiece)ppiece = ipiece;
+	  ipiece = jpiece;
+	}
+      }
+    }
+    return false;
+  }
+
+  template <class KTRAJ> template <class SURF> double ParticleTrajectory<KTRAJ>::refine(KTRAJ const& piece, SURF const& surf,
+      double ta, double fa, double tb, double fb, double precision) const {
+    static const unsigned maxiter=100;
+    // start with the linear interpolation, then use Newton steps from the analytic velocity, falling back to bisection if a step leaves the bracket
+    double time = ta - fa*(tb-ta)/(fb-fa);
+    unsigned niter(0);
+    while(niter++ < maxiter){
+      VEC3 pos = piece.position3(time);
+      double dist = surf.distance(pos);
+      if(dist == 0.0)break;
+      if(dist*fa > 0.0){
+	ta = time;
+	fa = dist;
+      } else {
+	tb = time;
+	fb = dist;
+      }
+      double ddot = surf.gradient(pos).Dot(piece.velocity(time));
+      double tnew = ddot != 0.0 ? time - dist/ddot : 0.5*(ta+tb);
+      if((tnew-ta)*(tnew-tb) > 0.0) tnew = 0.5*(ta+tb);
+      bool converged = fabs(tnew-time) < precision;
+      time = tnew;
+      if(converged)break;
+    }
+    return time;
+  }
 }
 #endif
 
@@ -5,15 +5,21 @@
 //
 #include "KinKal/Trajectory/ClosestApproach.hh"
 #include "KinKal/Trajectory/ParticleTrajectory.hh"
+#include "KinKal/General/PhysicalConstants.h"
 #include <ostream>
+#include <cmath>
 
 namespace KinKal {
   template<class KTRAJ, class STRAJ> class PiecewiseClosestApproach {
     public:
       using PKTRAJ = ParticleTrajectory<KTRAJ>;
       using KTCA = ClosestApproach<KTRAJ,STRAJ>;
-      // the constructor is the only non-inherited function
-      PiecewiseClosestApproach(PKTRAJ const& pktraj, STRAJ const& straj, CAHint const& hint, double precision);
+      // the constructor is the only non-inherited function.  If nloops > 0, the solutions starting up to nloops turns of the
+      // trajectory before and after the first solution are also found, and the one with the smallest DOCA is kept.  This protects
+      // against converging on the wrong loop of a looping trajectory, at the cost of 2*nloops extra TCA calculations.
+      // maxiter limits the TCA iterations on each piece, maxpiter the number of pieces tried
+      PiecewiseClosestApproach(PKTRAJ const& pktraj, STRAJ const& straj, CAHint const& hint, double precision, unsigned nloops=0,
+	  unsigned maxiter=100, unsigned maxpiter=10);
       // copy the TCA interface.  This is ugly and a maintenance burden, but avoids inheritance problems
       ClosestApproachData::TPStat status() const { return tpdata_.status(); }
       std::string const& statusName() const { return tpdata_.statusName(); }
@@ -39,9 +45,14 @@ namespace KinKal {
       DVEC const& dTdP() const { return dTdP_; }
       bool inRange() const { return particleTraj().inRange(particleToca()) && sensorTraj().inRange(sensorToca()); }
       double precision() const { return precision_; }
+      // time for the particle to complete one turn at the solution, 0 if it doesn't bend
+      double loopPeriod() const;
       void print(std::ostream& ost=std::cout,int detail=0) const;
     private:
+      void findPiece(CAHint const& hint); // iterate TCA over the pieces
+      void searchLoops(unsigned nloops); // compare solutions on neighboring loops
       double precision_; // precision used to define convergence
+      unsigned maxiter_, maxpiter_; // iteration limits
       ClosestApproachData tpdata_; // data payload of CA calculation
       PKTRAJ const& pktraj_;
       STRAJ const& straj_;
@@ -50,44 +61,87 @@ namespace KinKal {
       DVEC dTdP_;
   };
 
-  template<class KTRAJ, class STRAJ> PiecewiseClosestApproach<KTRAJ,STRAJ>::PiecewiseClosestApproach(PKTRAJ const& pktraj, STRAJ const& straj, CAHint const& hint, double prec) : precision_(prec), pktraj_(pktraj), straj_(straj) {
+  template<class KTRAJ, class STRAJ> PiecewiseClosestApproach<KTRAJ,STRAJ>::PiecewiseClosestApproach(PKTRAJ const& pktraj, STRAJ const& straj, CAHint const& hint,
+      double prec, unsigned nloops, unsigned maxiter, unsigned maxpiter) : precision_(prec), maxiter_(maxiter), maxpiter_(maxpiter),
+    pktraj_(pktraj), straj_(straj) {
+    findPiece(hint);
+    if(nloops > 0 && usable())searchLoops(nloops);
+  }
+
+  template<class KTRAJ, class STRAJ> void PiecewiseClosestApproach<KTRAJ,STRAJ>::findPiece(CAHint const& hint) {
     // iteratively find the nearest piece, and CA for that piece.  Start at hints if availalble, otherwise the middle
-    static const unsigned maxiter=10; // don't allow infinite iteration.  This should be a parameter FIXME!
     unsigned niter=0;
     size_t oldindex= pktraj_.pieces().size();
+    size_t olderindex = oldindex;
     pindex_ = pktraj_.nearestIndex(hint.particleToca_);
     // copy over the hint: it needs to evolve
     CAHint phint = hint;
+    // previous solution, used to resolve oscillations
+    ClosestApproachData oldtpdata;
+    DVEC olddDdP, olddTdP;
+    bool oscillating(false);
     // iterate until TCA is on the same piece
     do{
-      KTCA tpoca(pktraj_.piece(pindex_),straj,phint,prec);
-      // copy the state
+      KTCA tpoca(pktraj_.piece(pindex_),straj_,phint,precision_,maxiter_);
+      // copy the state, keeping the previous
+      oldtpdata = tpdata_;
+      olddDdP = dDdP_;
+      olddTdP = dTdP_;
       tpdata_ = tpoca.tpData();
       dDdP_ = tpoca.dDdP();
       dTdP_ = tpoca.dTdP();
-//      inrange = tpoca.inRange();
       // update the hint
       phint.particleToca_ = tpoca.particleToca();
       phint.sensorToca_ = tpoca.sensorToca();
       // update the piece (if needed)
+      olderindex = oldindex;
       oldindex = pindex_;
       pindex_ = pktraj_.nearestIndex(tpoca.particlePoca().T());
-    } while( pindex_ != oldindex && usable() && niter++ < maxiter);
-    // overwrite the status if we oscillated on the piece
-    if(tpdata_.status() == ClosestApproachData::converged && niter >= maxiter)
+      // returning to the previous piece means the solution is on a cusp between the pieces, where each piece's solution
+      // lies on the other piece.  Both are valid, keep the one with the smallest DOCA
+      oscillating = pindex_ != oldindex && pindex_ == olderindex;
+    } while( pindex_ != oldindex && !oscillating && usable() && niter++ < maxpiter_);
+    if(oscillating){
+      if(oldtpdata.usable() && fabs(oldtpdata.doca()) < fabs(tpdata_.doca())){
+	tpdata_ = oldtpdata;
+	dDdP_ = olddDdP;
+	dTdP_ = olddTdP;
+	pindex_ = olderindex;
+      } else
+	pindex_ = oldindex;
+    }
+    // overwrite the status if we failed to settle on a piece
+    if(tpdata_.status() == ClosestApproachData::converged && niter >= maxpiter_){
       tpdata_.status_ = ClosestApproachData::unconverged;
-    // should test explicitly for piece oscillation FIXME!
-    // test if the solution is on a cusp and if so, chose the one with the smallest DOCA TODO
-//    std::cout << "PTCA niter " << niter << " status " << status() << " in range " <<  inrange << std::endl;
-//    if(!inrange){
-//      auto const& piece = pktraj_.piece(pindex_);
-//      std::cout << "Out of range, TOCA = " << particleToca() << " range " << piece.range() 
-//      << " piece " << pindex_ << " nearest " << pktraj_.nearestIndex(particleToca())
-//      << " npieces " << pktraj_.pieces().size() << " full range " << pktraj_.range() 
-//      << std::endl;
-//    }
+      KINKAL_PROFILE_COUNT(FitProfile::tcaUnconverged,1);
+    }
+  }
+
+  template<class KTRAJ, class STRAJ> void PiecewiseClosestApproach<KTRAJ,STRAJ>::searchLoops(unsigned nloops) {
+    // candidate solutions are one turn apart
+    double period = loopPeriod();
+    if(period <= 0.0)return;
+    double ptoca = particleToca();
+    CAHint lhint(ptoca,sensorToca());
+    for(int iloop = -int(nloops); iloop <= int(nloops); iloop++){
+      lhint.particleToca_ = ptoca + iloop*period;
+      if(iloop == 0 || !pktraj_.range().inRange(lhint.particleToca_))continue;
+      PiecewiseClosestApproach ltpoca(pktraj_,straj_,lhint,precision_,0,maxiter_,maxpiter_);
+      if(ltpoca.usable() && fabs(ltpoca.doca()) < fabs(doca())){
+	tpdata_ = ltpoca.tpData();
+	dDdP_ = ltpoca.dDdP();
+	dTdP_ = ltpoca.dTdP();
+	pindex_ = ltpoca.particleTrajIndex();
+      }
+    }
+  }
+
+  template<class KTRAJ, class STRAJ> double PiecewiseClosestApproach<KTRAJ,STRAJ>::loopPeriod() const {
+    // the bending rate is computed as for ParticleTrajectory crossings
+    auto const& piece = pktraj_.piece(pindex_);
+    double omega = 1.0e-3*CLHEP::c_light*CLHEP::c_light*fabs(piece.charge()*piece.bnom().R())/piece.energy(particleToca());
+    return omega > 0.0 ? 2.0*M_PI/omega : 0.0;
   }
-  
 
   template<class KTRAJ, class STRAJ> void PiecewiseClosestApproach<KTRAJ,STRAJ>::print(std::ostream& ost,int detail) const {
     ost << "PiecewiseClosestApproach status " << statusName() << " Doca " << doca() << " +- " << sqrt(docaVar())
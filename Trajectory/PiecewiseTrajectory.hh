@@ -9,24 +9,33 @@
 #include "KinKal/General/MomBasis.hh"
 #include "KinKal/General/TimeRange.hh"
 #include <deque>
+#include <memory_resource>
 #include <ostream>
 #include <stdexcept>
 #include <typeinfo>
+#include <vector>
 
 namespace KinKal {
   template <class TTRAJ> class PiecewiseTrajectory {
     public:
-      using DTTRAJ = std::deque<TTRAJ>;
+      using DTTRAJ = std::pmr::deque<TTRAJ>; // pieces are allocated from a memory resource, by default the heap
       // forward calls to the pieces 
       void position3(VEC4& pos) const {nearestPiece(pos.T()).position3(pos); }
       VEC3 position3(double time) const { return nearestPiece(time).position3(time); }
       VEC3 velocity(double time) const { return nearestPiece(time).velocity(time); }
       double speed(double time) const { return nearestPiece(time).speed(time); }
       VEC3 direction(double time, MomBasis::Direction mdir=MomBasis::momdir_) const { return nearestPiece(time).direction(time,mdir); }
+      // positions and directions at a batch of times.  The pieces are walked incrementally from one time to the next, and consecutive
+      // times on the same piece are evaluated together, so this is most efficient for ordered times.  The output is resized to match
+      void positions(std::vector<double> const& times, std::vector<VEC3>& pos) const;
+      void directions(std::vector<double> const& times, std::vector<VEC3>& dirs, MomBasis::Direction mdir=MomBasis::momdir_) const;
       TimeRange range() const { return TimeRange(pieces_.front().range().begin(),pieces_.back().range().end()); }
       void setRange(TimeRange const& trange, bool trim=false);
 // construct without any content.  Any functions except append or prepend will throw in this state
       PiecewiseTrajectory() {}
+// construct empty, allocating the pieces from the given memory resource.  Note that copies use the default resource,
+// while assignment keeps the resource of the target
+      explicit PiecewiseTrajectory(std::pmr::memory_resource* mres) : pieces_(mres) {}
 // construct from an initial piece
       PiecewiseTrajectory(TTRAJ const& piece);
 // append or prepend a piece, at the time of the corresponding end of the new trajectory.  The last 
@@ -36,6 +45,8 @@ namespace KinKal {
       void append(TTRAJ const& newpiece, bool allowremove=false);
       void prepend(TTRAJ const& newpiece, bool allowremove=false);
       void add(TTRAJ const& newpiece, TimeDir tdir=TimeDir::forwards, bool allowremove=false);
+// remove all the pieces, keeping the memory resource
+      void clear() { pieces_.clear(); }
 // Find the piece associated with a particular time
       TTRAJ const& nearestPiece(double time) const { return pieces_[nearestIndex(time)]; }
       TTRAJ const& piece(size_t index) const { return pieces_[index]; }
@@ -50,6 +61,8 @@ namespace KinKal {
       void gaps(double& largest, size_t& ilargest, double& average) const;
       void print(std::ostream& ost, int detail) const ;
     private:
+      // call the function for each run of consecutive times that are on the same piece, with the piece and the start and length of the run
+      template <class FUNC> void pieceRuns(std::vector<double> const& times, FUNC func) const;
       DTTRAJ pieces_; // constituent pieces
   };
 
@@ -171,6 +184,37 @@ namespace KinKal {
     return retval;
   }
 
+  template <class TTRAJ> template <class FUNC> void PiecewiseTrajectory<TTRAJ>::pieceRuns(std::vector<double> const& times, FUNC func) const {
+    if(times.size() == 0)return;
+    // same piece selection as nearestIndex, but incremental.  A time is on the first piece whose range ends at or after it
+    size_t ipiece = nearestIndex(times.front());
+    size_t istart = 0;
+    for(size_t itime=1; itime < times.size(); itime++){
+      double time = times[itime];
+      size_t jpiece = ipiece;
+      while(jpiece+1 < pieces_.size() && time > pieces_[jpiece].range().end()) jpiece++;
+      while(jpiece > 0 && time <= pieces_[jpiece-1].range().end()) jpiece--;
+      if(jpiece != ipiece){
+	func(pieces_[ipiece],istart,itime-istart);
+	ipiece = jpiece;
+	istart = itime;
+      }
+    }
+    func(pieces_[ipiece],istart,times.size()-istart);
+  }
+
+  template <class TTRAJ> void PiecewiseTrajectory<TTRAJ>::positions(std::vector<double> const& times, std::vector<VEC3>& pos) const {
+    pos.resize(times.size());
+    pieceRuns(times,[&times,&pos](TTRAJ const& piece, size_t istart, size_t ntimes) {
+	piece.positions(times.data()+istart,ntimes,pos.data()+istart); });
+  }
+
+  template <class TTRAJ> void PiecewiseTrajectory<TTRAJ>::directions(std::vector<double> const& times, std::vector<VEC3>& dirs, MomBasis::Direction mdir) const {
+    dirs.resize(times.size());
+    pieceRuns(times,[&times,&dirs,mdir](TTRAJ const& piece, size_t istart, size_t ntimes) {
+	piece.directions(times.data()+istart,ntimes,dirs.data()+istart,mdir); });
+  }
+
   template <class TTRAJ> double PiecewiseTrajectory<TTRAJ>::gap(size_t ihigh) const {
     double retval(0.0);
     if(ihigh>0 && ihigh < pieces_.size()){
@@ -0,0 +1,49 @@
+#ifndef KinKal_Surface_hh
+#define KinKal_Surface_hh
+//
+//  Simple analytic surfaces, used to find where a trajectory crosses a detector boundary.
+//  Each surface provides the signed distance of a point from the surface, and the gradient of that distance
+//
+#include "KinKal/General/Vectors.hh"
+#include <ostream>
+
+namespace KinKal {
+  // infinite plane, defined by a point and the normal direction.  The distance is positive on the normal side
+  class Plane {
+    public:
+      Plane(VEC3 const& center, VEC3 const& norm) : center_(center), norm_(norm.Unit()) {}
+      VEC3 const& center() const { return center_; }
+      VEC3 const& normal() const { return norm_; }
+      double distance(VEC3 const& pos) const { return (pos-center_).Dot(norm_); }
+      VEC3 gradient(VEC3 const& pos) const { return norm_; }
+    private:
+      VEC3 center_; // point on the plane
+      VEC3 norm_; // unit normal
+  };
+
+  // infinite cylinder, defined by a point on the axis, the axis direction, and the radius.  The distance is positive outside
+  class Cylinder {
+    public:
+      Cylinder(VEC3 const& center, VEC3 const& axis, double radius) : center_(center), axis_(axis.Unit()), radius_(radius) {}
+      VEC3 const& center() const { return center_; }
+      VEC3 const& axis() const { return axis_; }
+      double radius() const { return radius_; }
+      double distance(VEC3 const& pos) const { return rvec(pos).R() - radius_; }
+      VEC3 gradient(VEC3 const& pos) const { return rvec(pos).Unit(); }
+    private:
+      VEC3 rvec(VEC3 const& pos) const { VEC3 dpos = pos-center_; return dpos - dpos.Dot(axis_)*axis_; } // radial vector from the axis
+      VEC3 center_; // point on the axis
+      VEC3 axis_; // unit axis direction
+      double radius_;
+  };
+
+  inline std::ostream& operator <<(std::ostream& ost, Plane const& plane) {
+    ost << "Plane center " << plane.center() << " normal " << plane.normal();
+    return ost;
+  }
+  inline std::ostream& operator <<(std::ostream& ost, Cylinder const& cyl) {
+    ost << "Cylinder center " << cyl.center() << " axis " << cyl.axis() << " radius " << cyl.radius();
+    return ost;
+  }
+}
+#endif
@@ -0,0 +1,41 @@
+#ifndef KinKal_TrajectoryEval_hh
+#define KinKal_TrajectoryEval_hh
+//
+//  Kinematic quantities of a particle trajectory evaluated together at a single time (see KTRAJ::evaluate).  The trajectory
+//  computes these sharing the phase, trigonometry and local to global rotation, which is cheaper than calling the separate
+//  position, direction, velocity and derivative functions at the same time.
+//
+#include "KinKal/General/Vectors.hh"
+#include "KinKal/General/MomBasis.hh"
+#include <array>
+namespace KinKal {
+  struct TrajectoryEval {
+    // optional content, as bit flags.  The position, momentum direction, speed and momentum magnitude are always evaluated
+    enum Content {kinematics=0, basis=1, dXdPar=2, dPardM=4, dMdPar=8, all=15};
+    double time_ = 0.0;
+    VEC3 pos_; // position
+    std::array<VEC3,MomBasis::ndir> dirs_; // momentum basis directions; only momdir_ is filled unless the basis is requested
+    double speed_ = 0.0; // speed (mm/ns)
+    double mom_ = 0.0; // momentum magnitude (MeV/c)
+    DVDP dXdP_; // derivative of the position WRT the parameters
+    DPDV dPdM_; // derivative of the parameters WRT the momentum vector
+    DVDP dMdP_; // derivative of the momentum vector WRT the parameters
+    VEC4 position4() const { return VEC4(pos_.X(),pos_.Y(),pos_.Z(),time_); }
+    VEC3 const& direction(MomBasis::Direction mdir=MomBasis::momdir_) const { return dirs_[mdir]; }
+    VEC3 velocity() const { return dirs_[MomBasis::momdir_]*speed_; }
+    VEC3 momentum3() const { return dirs_[MomBasis::momdir_]*mom_; }
+    // derivative of the global state WRT the parameters, as KTRAJ::dStatedPar.  Requires dXdPar and dMdPar content
+    PSMAT dStatedPar() const {
+      PSMAT dsdp;
+      dsdp.Place_at(dXdP_,0,0);
+      dsdp.Place_at(dMdP_,3,0);
+      return dsdp;
+    }
+    // parameter change for a fractional momentum change along a basis direction, as KTRAJ::momDeriv.  Requires basis and dPardM content
+    DVEC momDeriv(MomBasis::Direction mdir) const {
+      auto const& dir = dirs_[mdir];
+      return mom_*(dPdM_*SVEC3(dir.X(), dir.Y(), dir.Z()));
+    }
+  };
+}
+#endif